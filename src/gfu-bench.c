@@ -0,0 +1,848 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <stdlib.h>
+
+#include "gfu-common.h"
+#include "gfu-engine.h"
+
+/*
+ * Each benchmark is called until it has enough samples or has used up its
+ * time budget, with cheap calls batched so that one sample is long enough
+ * to time. Allocations are counted for the whole process, so the download
+ * numbers include the HTTP stand-in running in another thread.
+ */
+
+#define GFU_BENCH_SAMPLE_MIN_US		2000
+#define GFU_BENCH_SAMPLES_MIN		5
+#define GFU_BENCH_BUDGET_US		(2 * G_USEC_PER_SEC)
+
+typedef void (*GfuBenchFunc)		(gpointer	 user_data);
+
+static gint gfu_bench_samples = 100;
+
+#ifdef HAVE_LIBC_MALLOC
+/* GLib has no allocation hooks any more, so wrap the glibc entry points */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static gsize gfu_bench_allocs = 0;
+
+void *
+malloc (size_t size)
+{
+	g_atomic_pointer_add (&gfu_bench_allocs, 1);
+	return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+	g_atomic_pointer_add (&gfu_bench_allocs, 1);
+	return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+	g_atomic_pointer_add (&gfu_bench_allocs, 1);
+	return __libc_realloc (ptr, size);
+}
+
+static gboolean
+gfu_bench_allocs_get (gsize *allocs)
+{
+	*allocs = GPOINTER_TO_SIZE (g_atomic_pointer_get (&gfu_bench_allocs));
+	return TRUE;
+}
+#else
+static gboolean
+gfu_bench_allocs_get (gsize *allocs)
+{
+	*allocs = 0;
+	return FALSE;
+}
+#endif
+
+static gint
+gfu_bench_sample_compare_cb (gconstpointer a, gconstpointer b)
+{
+	gdouble tmp_a = *((const gdouble *) a);
+	gdouble tmp_b = *((const gdouble *) b);
+	return (tmp_a > tmp_b) - (tmp_a < tmp_b);
+}
+
+static gdouble
+gfu_bench_percentile (GArray *samples, guint pct)
+{
+	guint idx = (samples->len * pct + 99) / 100;
+	return g_array_index (samples, gdouble, MAX (idx, 1) - 1);
+}
+
+static const gchar *
+gfu_bench_format_time (gdouble us, gchar *buf, gsize bufsz)
+{
+	if (us < 1.f)
+		g_snprintf (buf, bufsz, "%.0fns", us * 1000);
+	else if (us < 1000.f)
+		g_snprintf (buf, bufsz, "%.1fµs", us);
+	else if (us < G_USEC_PER_SEC)
+		g_snprintf (buf, bufsz, "%.1fms", us / 1000);
+	else
+		g_snprintf (buf, bufsz, "%.2fs", us / G_USEC_PER_SEC);
+	return buf;
+}
+
+/* returns the allocations for each call, or -1 if they cannot be counted */
+static gdouble
+gfu_bench_run (const gchar *name, gsize bytes, GfuBenchFunc func, gpointer user_data)
+{
+	gchar buf[32];
+	gdouble allocs_per_call = -1.f;
+	gint64 elapsed;
+	gint64 start;
+	gint64 total = 0;
+	gsize allocs_end = 0;
+	gsize allocs_start = 0;
+	guint batch = 1;
+	guint64 calls = 0;
+	g_autoptr(GArray) samples = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	/* warm up, doubling the batch until a sample is long enough to time */
+	for (;;) {
+		start = g_get_monotonic_time ();
+		for (guint i = 0; i < batch; i++)
+			func (user_data);
+		elapsed = g_get_monotonic_time () - start;
+		if (elapsed >= GFU_BENCH_SAMPLE_MIN_US || batch >= G_MAXUINT / 2)
+			break;
+		batch *= 2;
+	}
+
+	/* sized up front, so that appending does not allocate */
+	samples = g_array_sized_new (FALSE, FALSE, sizeof(gdouble), gfu_bench_samples);
+	gfu_bench_allocs_get (&allocs_start);
+	while (samples->len < (guint) gfu_bench_samples &&
+	       (total < GFU_BENCH_BUDGET_US || samples->len < GFU_BENCH_SAMPLES_MIN)) {
+		gdouble us;
+		start = g_get_monotonic_time ();
+		for (guint i = 0; i < batch; i++)
+			func (user_data);
+		elapsed = g_get_monotonic_time () - start;
+		total += elapsed;
+		calls += batch;
+		us = (gdouble) elapsed / batch;
+		g_array_append_val (samples, us);
+	}
+	if (gfu_bench_allocs_get (&allocs_end))
+		allocs_per_call = (gdouble) (allocs_end - allocs_start) / calls;
+
+	/* one line each, so that runs can be diffed */
+	g_array_sort (samples, gfu_bench_sample_compare_cb);
+	g_string_append_printf (str, "%-36s", name);
+	g_string_append_printf (str, " p50 %-9s",
+				gfu_bench_format_time (gfu_bench_percentile (samples, 50), buf, sizeof(buf)));
+	g_string_append_printf (str, " p90 %-9s",
+				gfu_bench_format_time (gfu_bench_percentile (samples, 90), buf, sizeof(buf)));
+	g_string_append_printf (str, " p99 %-9s",
+				gfu_bench_format_time (gfu_bench_percentile (samples, 99), buf, sizeof(buf)));
+	if (bytes > 0 && total > 0) {
+		/* one byte each microsecond is one MB/s */
+		g_string_append_printf (str, " %9.1f MB/s", (gdouble) bytes * calls / total);
+	} else {
+		g_string_append_printf (str, " %14s", "");
+	}
+	if (allocs_per_call >= 0)
+		g_string_append_printf (str, " %10.1f allocs", allocs_per_call);
+	else
+		g_string_append (str, "  allocs unknown");
+	g_print ("%s\n", str->str);
+	return allocs_per_call;
+}
+
+/* descriptions */
+
+static void
+gfu_bench_xml_to_markup_cb (gpointer user_data)
+{
+	g_free (gfu_common_xml_to_markup ((const gchar *) user_data, NULL));
+}
+
+static gboolean
+gfu_bench_xml_to_markup (GError **error)
+{
+	const gchar *xml_short = "<p>This release fixes a problem where the device "
+				 "would not resume from suspend.</p>";
+	g_autoptr(GString) xml_long = g_string_new (NULL);
+
+	/* a big release with a changelog, as some vendors upload */
+	g_string_append (xml_long, "<p>This release adds the following features:</p><ul>");
+	for (guint i = 0; i < 20; i++)
+		g_string_append_printf (xml_long, "<li>Improve the <em>stability</em> of feature %u</li>", i);
+	g_string_append (xml_long, "</ul><p>This release fixes the following issues:</p><ol>");
+	for (guint i = 0; i < 20; i++)
+		g_string_append_printf (xml_long, "<li>Fix the <code>0x%04x</code> error code</li>", i);
+	g_string_append (xml_long, "</ol><p>Install this update using the &quot;Install&quot; button.</p>");
+
+	gfu_bench_run ("xml-to-markup/short", strlen (xml_short),
+		       gfu_bench_xml_to_markup_cb, (gpointer) xml_short);
+	gfu_bench_run ("xml-to-markup/long", xml_long->len,
+		       gfu_bench_xml_to_markup_cb, xml_long->str);
+	return TRUE;
+}
+
+/* the whole corpus in each call, as moving through the releases would */
+typedef struct {
+	GPtrArray	*xmls;
+	GHashTable	*descriptions;	/* xml : markup */
+} GfuBenchCorpusHelper;
+
+static void
+gfu_bench_corpus_convert_cb (gpointer user_data)
+{
+	GfuBenchCorpusHelper *helper = (GfuBenchCorpusHelper *) user_data;
+	for (guint i = 0; i < helper->xmls->len; i++)
+		g_free (gfu_common_xml_to_markup (g_ptr_array_index (helper->xmls, i), NULL));
+}
+
+static void
+gfu_bench_corpus_cached_cb (gpointer user_data)
+{
+	GfuBenchCorpusHelper *helper = (GfuBenchCorpusHelper *) user_data;
+	for (guint i = 0; i < helper->xmls->len; i++) {
+		const gchar *xml = g_ptr_array_index (helper->xmls, i);
+		if (g_hash_table_lookup (helper->descriptions, xml) != NULL)
+			continue;
+		g_hash_table_insert (helper->descriptions, g_strdup (xml),
+				     gfu_common_xml_to_markup (xml, NULL));
+	}
+}
+
+static gboolean
+gfu_bench_descriptions (GError **error)
+{
+	gsize bytes = 0;
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *fn = g_build_filename (GFU_BENCH_DATADIR, "descriptions.txt", NULL);
+	g_auto(GStrv) lines = NULL;
+	g_autoptr(GHashTable) descriptions = NULL;
+	g_autoptr(GPtrArray) xmls = g_ptr_array_new ();
+	GfuBenchCorpusHelper helper = { .xmls = xmls };
+
+	if (!g_file_get_contents (fn, &data, NULL, error))
+		return FALSE;
+	lines = g_strsplit (data, "\n", -1);
+	for (guint i = 0; lines[i] != NULL; i++) {
+		g_autofree gchar *markup = NULL;
+		if (lines[i][0] == '\0' || lines[i][0] == '#')
+			continue;
+
+		/* a bad corpus would only benchmark the error path */
+		markup = gfu_common_xml_to_markup (lines[i], error);
+		if (markup == NULL) {
+			g_prefix_error (error, "%s:%u: ", fn, i + 1);
+			return FALSE;
+		}
+		g_ptr_array_add (xmls, lines[i]);
+		bytes += strlen (lines[i]);
+	}
+	descriptions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	helper.descriptions = descriptions;
+
+	g_print ("%u descriptions, %" G_GSIZE_FORMAT " bytes\n", xmls->len, bytes);
+	gfu_bench_run ("descriptions/convert", bytes, gfu_bench_corpus_convert_cb, &helper);
+	gfu_bench_run ("descriptions/cached", bytes, gfu_bench_corpus_cached_cb, &helper);
+	return TRUE;
+}
+
+/* flags */
+
+typedef struct {
+	GString		*str;
+	guint64		 flags;
+	guint		 found;		/* so the lookups are not optimized out */
+} GfuBenchFlagsHelper;
+
+static void
+gfu_bench_device_flags_cb (gpointer user_data)
+{
+	GfuBenchFlagsHelper *helper = (GfuBenchFlagsHelper *) user_data;
+	g_string_truncate (helper->str, 0);
+	gfu_common_device_flags_to_strings (helper->str, helper->flags);
+}
+
+static void
+gfu_bench_release_flags_cb (gpointer user_data)
+{
+	GfuBenchFlagsHelper *helper = (GfuBenchFlagsHelper *) user_data;
+	g_string_truncate (helper->str, 0);
+	gfu_common_release_flags_to_strings (helper->str, helper->flags);
+}
+
+/* the same walk as the device details page */
+static void
+gfu_bench_device_flags_lookup_cb (gpointer user_data)
+{
+	GfuBenchFlagsHelper *helper = (GfuBenchFlagsHelper *) user_data;
+	for (guint64 tmp = helper->flags; tmp != 0; tmp &= tmp - 1) {
+		if (gfu_common_device_flag_get_info (GFU_FLAG_BIT (tmp)) != NULL)
+			helper->found++;
+	}
+}
+
+/* every flag the library knows the name of */
+static guint64
+gfu_bench_flags_known (const gchar *(*to_string) (guint64))
+{
+	guint64 flags = 0;
+	for (guint j = 0; j < 64; j++) {
+		const gchar *tmp = to_string ((guint64) 1 << j);
+		if (tmp != NULL && g_strcmp0 (tmp, "unknown") != 0)
+			flags |= (guint64) 1 << j;
+	}
+	return flags;
+}
+
+static gboolean
+gfu_bench_flags (GError **error)
+{
+	g_autoptr(GString) str = g_string_new (NULL);
+	GfuBenchFlagsHelper helper = { .str = str };
+
+	helper.flags = FWUPD_DEVICE_FLAG_INTERNAL |
+		       FWUPD_DEVICE_FLAG_UPDATABLE |
+		       FWUPD_DEVICE_FLAG_REQUIRE_AC |
+		       FWUPD_DEVICE_FLAG_SUPPORTED |
+		       FWUPD_DEVICE_FLAG_NEEDS_REBOOT;
+	gfu_bench_run ("device-flags/typical", 0, gfu_bench_device_flags_cb, &helper);
+	helper.flags = gfu_bench_flags_known (fwupd_device_flag_to_string);
+	gfu_bench_run ("device-flags/all", 0, gfu_bench_device_flags_cb, &helper);
+	gfu_bench_run ("device-flags/all/lookup", 0, gfu_bench_device_flags_lookup_cb, &helper);
+	helper.flags = FWUPD_RELEASE_FLAG_TRUSTED_PAYLOAD |
+		       FWUPD_RELEASE_FLAG_TRUSTED_METADATA |
+		       FWUPD_RELEASE_FLAG_IS_UPGRADE;
+	gfu_bench_run ("release-flags/typical", 0, gfu_bench_release_flags_cb, &helper);
+	helper.flags = gfu_bench_flags_known (fwupd_release_flag_to_string);
+	gfu_bench_run ("release-flags/all", 0, gfu_bench_release_flags_cb, &helper);
+	return TRUE;
+}
+
+/* GetDevices replies */
+
+static void
+gfu_bench_devices_filtered_cb (gpointer user_data)
+{
+	g_ptr_array_unref (gfu_common_device_array_from_variant ((GVariant *) user_data));
+}
+
+static void
+gfu_bench_devices_full_cb (gpointer user_data)
+{
+	g_ptr_array_unref (fwupd_device_array_from_variant ((GVariant *) user_data));
+}
+
+/* serialized by libfwupd like the daemon does, with one in ten updatable */
+static GVariant *
+gfu_bench_devices_reply_new (guint n_devices)
+{
+	GVariantBuilder builder;
+	g_autoptr(GVariant) tree = NULL;
+	g_autoptr(GBytes) blob = NULL;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	for (guint i = 0; i < n_devices; i++) {
+		g_autofree gchar *id = g_strdup_printf ("%040x", i);
+		g_autofree gchar *name = g_strdup_printf ("Device %u", i);
+		g_autoptr(FwupdDevice) dev = fwupd_device_new ();
+
+		fwupd_device_set_id (dev, id);
+		fwupd_device_set_name (dev, name);
+		fwupd_device_set_summary (dev, "A device enumerated by the daemon");
+		fwupd_device_set_vendor (dev, "Acme Corp");
+		fwupd_device_set_vendor_id (dev, "USB:0x1234");
+		fwupd_device_set_plugin (dev, "usb");
+		fwupd_device_set_version (dev, "1.2.3");
+		fwupd_device_set_created (dev, 1580000000);
+		fwupd_device_add_icon (dev, "computer");
+		fwupd_device_add_checksum (dev, id);
+		for (guint j = 0; j < 3; j++) {
+			g_autofree gchar *guid = g_strdup_printf ("%08x-0000-4000-8000-%012x", i, j);
+			fwupd_device_add_guid (dev, guid);
+		}
+		if (i % 10 == 0) {
+			fwupd_device_add_flag (dev, FWUPD_DEVICE_FLAG_UPDATABLE);
+			fwupd_device_add_flag (dev, FWUPD_DEVICE_FLAG_SUPPORTED);
+		} else {
+			fwupd_device_add_flag (dev, FWUPD_DEVICE_FLAG_INTERNAL);
+		}
+		g_variant_builder_add_value (&builder, fwupd_device_to_variant (dev));
+	}
+
+	/* a reply from the bus is serialized, rather than a tree of values */
+	tree = g_variant_ref_sink (g_variant_new ("(@aa{sv})", g_variant_builder_end (&builder)));
+	blob = g_variant_get_data_as_bytes (tree);
+	return g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("(aa{sv})"), blob, TRUE));
+}
+
+static gboolean
+gfu_bench_devices (GError **error)
+{
+	const guint sizes[] = { 50, 500 };
+
+	for (guint i = 0; i < G_N_ELEMENTS (sizes); i++) {
+		g_autofree gchar *name_filtered = g_strdup_printf ("get-devices/%u/filtered", sizes[i]);
+		g_autofree gchar *name_full = g_strdup_printf ("get-devices/%u/full", sizes[i]);
+		g_autoptr(GVariant) reply = gfu_bench_devices_reply_new (sizes[i]);
+
+		gfu_bench_run (name_filtered, g_variant_get_size (reply),
+			       gfu_bench_devices_filtered_cb, reply);
+		gfu_bench_run (name_full, g_variant_get_size (reply),
+			       gfu_bench_devices_full_cb, reply);
+	}
+	return TRUE;
+}
+
+/* the formatting done by each refresh of the device and release pages */
+
+typedef struct {
+	FwupdDevice	*device;
+	FwupdRelease	*release;
+	GHashTable	*descriptions;	/* xml : markup */
+	GString		*scratch;
+	gchar		*shown[16];	/* as the labels skip unchanged text */
+	guint		 shown_idx;
+} GfuBenchRefreshHelper;
+
+static void
+gfu_bench_refresh_show (GfuBenchRefreshHelper *helper, const gchar *text)
+{
+	g_assert (helper->shown_idx < G_N_ELEMENTS (helper->shown));
+	gfu_common_shown_update (&helper->shown[helper->shown_idx++], text);
+}
+
+static void
+gfu_bench_refresh_cb (gpointer user_data)
+{
+	GfuBenchRefreshHelper *helper = (GfuBenchRefreshHelper *) user_data;
+	GPtrArray *checks;
+	GString *attr = helper->scratch;
+	const gchar *markup;
+	const gchar *xml;
+	gchar buf[64];
+
+	helper->shown_idx = 0;
+
+	/* device */
+	gfu_bench_refresh_show (helper, fwupd_device_get_version (helper->device));
+	g_string_set_size (attr, 0);
+	g_string_append (attr, fwupd_device_get_vendor (helper->device));
+	g_string_append (attr, " (");
+	g_string_append (attr, fwupd_device_get_vendor_id (helper->device));
+	g_string_append_c (attr, ')');
+	gfu_bench_refresh_show (helper, attr->str);
+	g_snprintf (buf, sizeof(buf), "%u", fwupd_device_get_flashes_left (helper->device));
+	gfu_bench_refresh_show (helper, buf);
+	gfu_bench_refresh_show (helper,
+				gfu_common_seconds_to_string (fwupd_device_get_install_duration (helper->device),
+							      buf, sizeof(buf)));
+	g_string_set_size (attr, 0);
+	gfu_bench_refresh_show (helper,
+				gfu_common_device_flags_to_strings (attr, fwupd_device_get_flags (helper->device)));
+	g_string_set_size (attr, 0);
+	gfu_bench_refresh_show (helper,
+				gfu_common_array_join (attr, fwupd_device_get_guids (helper->device)));
+
+	/* release */
+	gfu_bench_refresh_show (helper, fwupd_release_get_version (helper->release));
+	g_string_set_size (attr, 0);
+	gfu_bench_refresh_show (helper,
+				gfu_common_array_join (attr, fwupd_release_get_categories (helper->release)));
+	g_string_set_size (attr, 0);
+	checks = fwupd_release_get_checksums (helper->release);
+	for (guint i = 0; i < checks->len; i++) {
+		if (i > 0)
+			g_string_append_c (attr, '\n');
+		gfu_common_checksum_format (attr, g_ptr_array_index (checks, i));
+	}
+	gfu_bench_refresh_show (helper, attr->str);
+#if FWUPD_CHECK_VERSION(1,3,2)
+	g_string_set_size (attr, 0);
+	gfu_bench_refresh_show (helper,
+				gfu_common_array_join (attr, fwupd_release_get_issues (helper->release)));
+#endif
+	xml = fwupd_release_get_description (helper->release);
+	markup = g_hash_table_lookup (helper->descriptions, xml);
+	if (markup == NULL) {
+		markup = gfu_common_xml_to_markup (xml, NULL);
+		g_hash_table_insert (helper->descriptions, g_strdup (xml), (gpointer) markup);
+	}
+	gfu_bench_refresh_show (helper, markup);
+	gfu_bench_refresh_show (helper,
+				gfu_common_format_size (fwupd_release_get_size (helper->release),
+							buf, sizeof(buf)));
+	g_string_set_size (attr, 0);
+	gfu_bench_refresh_show (helper,
+				gfu_common_release_flags_to_strings (attr, fwupd_release_get_flags (helper->release)));
+	gfu_bench_refresh_show (helper,
+				gfu_common_seconds_to_string (fwupd_release_get_install_duration (helper->release),
+							      buf, sizeof(buf)));
+}
+
+static gboolean
+gfu_bench_refresh (GError **error)
+{
+	gdouble allocs;
+	g_autoptr(FwupdDevice) device = fwupd_device_new ();
+	g_autoptr(FwupdRelease) release = fwupd_release_new ();
+	g_autoptr(GHashTable) descriptions = NULL;
+	g_autoptr(GString) scratch = g_string_sized_new (1024);
+	GfuBenchRefreshHelper helper = {
+		.device = device,
+		.release = release,
+		.scratch = scratch,
+	};
+
+	fwupd_device_set_version (device, "1.2.3");
+	fwupd_device_set_vendor (device, "Acme Corp");
+	fwupd_device_set_vendor_id (device, "USB:0x1234");
+	fwupd_device_set_flashes_left (device, 3);
+	fwupd_device_set_install_duration (device, 90);
+	fwupd_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fwupd_device_add_flag (device, FWUPD_DEVICE_FLAG_INTERNAL);
+	fwupd_device_add_flag (device, FWUPD_DEVICE_FLAG_NEEDS_REBOOT);
+	fwupd_device_add_guid (device, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	fwupd_device_add_guid (device, "f95c9218-acd3-5ded-a8a6-3d2c0b4e2b2b");
+	fwupd_release_set_version (release, "1.2.4");
+	fwupd_release_add_category (release, "X-System");
+	fwupd_release_add_checksum (release, "fc7ce3f6bc2a95fa0ef3c4b73b9e9226a9e72b1e");
+	fwupd_release_add_checksum (release, "f5ac4bc3d3d8d4bbdb6f3c5a66b82fb4fbd5e2f1a1e4c2cde0e37d4ecff7d2e8");
+#if FWUPD_CHECK_VERSION(1,3,2)
+	fwupd_release_add_issue (release, "CVE-2019-0001");
+	fwupd_release_add_issue (release, "CVE-2019-0002");
+#endif
+	fwupd_release_set_description (release, "<p>Fixes resume from suspend.</p>"
+						"<ul><li>Faster boot</li><li>Fewer crashes</li></ul>");
+	fwupd_release_set_size (release, 8 * 1024 * 1024);
+	fwupd_release_add_flag (release, FWUPD_RELEASE_FLAG_TRUSTED_PAYLOAD);
+	fwupd_release_add_flag (release, FWUPD_RELEASE_FLAG_IS_UPGRADE);
+	fwupd_release_set_install_duration (release, 120);
+	descriptions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	helper.descriptions = descriptions;
+
+	/* the first call is the cold one, which is allowed to allocate */
+	allocs = gfu_bench_run ("refresh/warm", 0, gfu_bench_refresh_cb, &helper);
+	for (guint i = 0; i < G_N_ELEMENTS (helper.shown); i++)
+		g_free (helper.shown[i]);
+
+	/* a window left open for weeks must not grow with each redraw */
+	if (allocs > 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "a warm refresh made %.2f allocations", allocs);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* cached payloads */
+
+typedef struct {
+	gchar		*fn;
+	gchar		*checksum;
+} GfuBenchFileHelper;
+
+static void
+gfu_bench_file_helper_free (GfuBenchFileHelper *helper)
+{
+	g_unlink (helper->fn);
+	g_free (helper->fn);
+	g_free (helper->checksum);
+	g_free (helper);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuBenchFileHelper, gfu_bench_file_helper_free)
+
+/* written a MiB at a time, so the largest file does not need the memory */
+static GfuBenchFileHelper *
+gfu_bench_file_new (const gchar *tmpdir, guint size_mib, GError **error)
+{
+	g_autofree guint8 *buf = g_malloc (1024 * 1024);
+	g_autofree gchar *basename = g_strdup_printf ("payload-%uMiB.cab", size_mib);
+	g_autoptr(GChecksum) checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFileOutputStream) stream = NULL;
+	g_autoptr(GfuBenchFileHelper) helper = g_new0 (GfuBenchFileHelper, 1);
+	g_autoptr(GRand) prng = g_rand_new_with_seed (size_mib);
+
+	helper->fn = g_build_filename (tmpdir, basename, NULL);
+	file = g_file_new_for_path (helper->fn);
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return NULL;
+	for (guint i = 0; i < 1024 * 1024 / sizeof(guint32); i++)
+		((guint32 *) buf)[i] = g_rand_int (prng);
+	for (guint i = 0; i < size_mib; i++) {
+		buf[0] = (guint8) i;
+		g_checksum_update (checksum, buf, 1024 * 1024);
+		if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), buf, 1024 * 1024,
+						NULL, NULL, error))
+			return NULL;
+	}
+	if (!g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error))
+		return NULL;
+	helper->checksum = g_strdup (g_checksum_get_string (checksum));
+	return g_steal_pointer (&helper);
+}
+
+static void
+gfu_bench_checksum_cb (gpointer user_data)
+{
+	GfuBenchFileHelper *helper = (GfuBenchFileHelper *) user_data;
+	if (!gfu_common_file_exists_with_checksum (helper->fn, helper->checksum, G_CHECKSUM_SHA256))
+		g_error ("checksum of %s did not match", helper->fn);
+}
+
+static gboolean
+gfu_bench_checksum (GError **error)
+{
+	const guint sizes_mib[] = { 1, 4, 16, 64, 256 };
+	g_autofree gchar *tmpdir = g_dir_make_tmp ("gfu-bench-XXXXXX", error);
+
+	if (tmpdir == NULL)
+		return FALSE;
+	for (guint i = 0; i < G_N_ELEMENTS (sizes_mib); i++) {
+		g_autofree gchar *name = g_strdup_printf ("file-exists-with-checksum/%uMiB", sizes_mib[i]);
+		g_autoptr(GfuBenchFileHelper) helper = gfu_bench_file_new (tmpdir, sizes_mib[i], error);
+		if (helper == NULL) {
+			g_rmdir (tmpdir);
+			return FALSE;
+		}
+		gfu_bench_run (name, (gsize) sizes_mib[i] * 1024 * 1024,
+			       gfu_bench_checksum_cb, helper);
+	}
+	g_rmdir (tmpdir);
+	return TRUE;
+}
+
+/* downloads from a local HTTP stand-in */
+
+typedef struct {
+	GAsyncQueue	*ready;		/* of the base URI, once listening */
+	GMainLoop	*loop;		/* owned by the server thread */
+	GHashTable	*payloads;	/* path : GBytes, not changed once started */
+} GfuBenchServer;
+
+static void
+gfu_bench_server_handler_cb (SoupServer *soup_server,
+			     SoupMessage *msg,
+			     const char *path,
+			     GHashTable *query,
+			     SoupClientContext *client,
+			     gpointer user_data)
+{
+	GfuBenchServer *server = (GfuBenchServer *) user_data;
+	GBytes *blob = g_hash_table_lookup (server->payloads, path);
+
+	if (blob == NULL) {
+		soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+		return;
+	}
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_body_append (msg->response_body, SOUP_MEMORY_STATIC,
+				  g_bytes_get_data (blob, NULL),
+				  g_bytes_get_size (blob));
+}
+
+static gpointer
+gfu_bench_server_thread_cb (gpointer user_data)
+{
+	GfuBenchServer *server = (GfuBenchServer *) user_data;
+	GMainContext *context = g_main_context_new ();
+	GSList *uris;
+	SoupServer *soup_server;
+	g_autoptr(GError) error = NULL;
+
+	g_main_context_push_thread_default (context);
+	server->loop = g_main_loop_new (context, FALSE);
+	soup_server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (soup_server, NULL, gfu_bench_server_handler_cb, server, NULL);
+	if (!soup_server_listen_local (soup_server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error))
+		g_error ("failed to listen: %s", error->message);
+	uris = soup_server_get_uris (soup_server);
+	g_async_queue_push (server->ready, soup_uri_to_string (uris->data, FALSE));
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+	g_main_loop_run (server->loop);
+
+	soup_server_disconnect (soup_server);
+	g_object_unref (soup_server);
+	g_main_loop_unref (server->loop);
+	g_main_context_pop_thread_default (context);
+	g_main_context_unref (context);
+	return NULL;
+}
+
+typedef struct {
+	GfuEngine	*engine;
+	SoupURI		*uri;
+	gchar		*fn;
+	gchar		*checksum;
+} GfuBenchDownloadHelper;
+
+static void
+gfu_bench_download_cb (gpointer user_data)
+{
+	GfuBenchDownloadHelper *helper = (GfuBenchDownloadHelper *) user_data;
+	g_autoptr(GError) error = NULL;
+
+	g_unlink (helper->fn);
+	if (!gfu_engine_download_file (helper->engine, helper->uri, helper->fn,
+				       helper->checksum, &error))
+		g_error ("failed to download: %s", error->message);
+}
+
+static void
+gfu_bench_download_cached_cb (gpointer user_data)
+{
+	GfuBenchDownloadHelper *helper = (GfuBenchDownloadHelper *) user_data;
+	g_autoptr(GError) error = NULL;
+
+	if (!gfu_engine_download_file (helper->engine, helper->uri, helper->fn,
+				       helper->checksum, &error))
+		g_error ("failed to use cached download: %s", error->message);
+}
+
+static gboolean
+gfu_bench_download (GError **error)
+{
+	const guint sizes_kib[] = { 64, 1024, 16 * 1024 };
+	GThread *thread;
+	GfuBenchServer server = { NULL };
+	g_autofree gchar *base = NULL;
+	g_autofree gchar *tmpdir = g_dir_make_tmp ("gfu-bench-XXXXXX", error);
+	g_autoptr(GfuEngine) engine = gfu_engine_new ();
+	g_autoptr(GRand) prng = g_rand_new_with_seed (0);
+
+	if (tmpdir == NULL)
+		return FALSE;
+
+	/* the stand-in is local, so never go through a proxy */
+	g_unsetenv ("https_proxy");
+	g_unsetenv ("HTTPS_PROXY");
+	g_unsetenv ("http_proxy");
+	g_unsetenv ("HTTP_PROXY");
+	g_setenv ("no_proxy", "127.0.0.1", TRUE);
+
+	server.ready = g_async_queue_new ();
+	server.payloads = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, (GDestroyNotify) g_bytes_unref);
+	for (guint i = 0; i < G_N_ELEMENTS (sizes_kib); i++) {
+		gsize sz = (gsize) sizes_kib[i] * 1024;
+		guint8 *buf = g_malloc (sz);
+		for (gsize j = 0; j < sz; j++)
+			buf[j] = (guint8) g_rand_int (prng);
+		g_hash_table_insert (server.payloads,
+				     g_strdup_printf ("/firmware-%uKiB.cab", sizes_kib[i]),
+				     g_bytes_new_take (buf, sz));
+	}
+	thread = g_thread_new ("gfu-bench-server", gfu_bench_server_thread_cb, &server);
+	base = g_async_queue_pop (server.ready);
+
+	for (guint i = 0; i < G_N_ELEMENTS (sizes_kib); i++) {
+		GfuBenchDownloadHelper helper = { .engine = engine };
+		GBytes *blob;
+		g_autofree gchar *basename = g_strdup_printf ("firmware-%uKiB.cab", sizes_kib[i]);
+		g_autofree gchar *name = NULL;
+		g_autofree gchar *path = g_strdup_printf ("/%s", basename);
+		g_autofree gchar *uri_str = g_strdup_printf ("%s%s", base, basename);
+		g_autoptr(SoupURI) uri = soup_uri_new (uri_str);
+
+		blob = g_hash_table_lookup (server.payloads, path);
+		helper.uri = uri;
+		helper.fn = g_build_filename (tmpdir, basename, NULL);
+		helper.checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, blob);
+		name = g_strdup_printf ("download/%uKiB", sizes_kib[i]);
+		gfu_bench_run (name, g_bytes_get_size (blob), gfu_bench_download_cb, &helper);
+		g_free (name);
+		name = g_strdup_printf ("download/%uKiB/cached", sizes_kib[i]);
+		gfu_bench_run (name, g_bytes_get_size (blob), gfu_bench_download_cached_cb, &helper);
+		g_unlink (helper.fn);
+		g_free (helper.fn);
+		g_free (helper.checksum);
+	}
+
+	g_main_loop_quit (server.loop);
+	g_thread_join (thread);
+	g_hash_table_unref (server.payloads);
+	g_async_queue_unref (server.ready);
+	g_rmdir (tmpdir);
+	return TRUE;
+}
+
+static const struct {
+	const gchar	*name;
+	gboolean	 (*func)	(GError		**error);
+} gfu_bench_suites[] = {
+	{ "xml-to-markup",	gfu_bench_xml_to_markup },
+	{ "descriptions",	gfu_bench_descriptions },
+	{ "flags",		gfu_bench_flags },
+	{ "get-devices",	gfu_bench_devices },
+	{ "refresh",		gfu_bench_refresh },
+	{ "checksum",		gfu_bench_checksum },
+	{ "download",		gfu_bench_download },
+};
+
+int
+main (int argc, char **argv)
+{
+	gboolean ret = TRUE;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	const GOptionEntry options[] = {
+		{ "samples", '\0', 0, G_OPTION_ARG_INT, &gfu_bench_samples,
+			"Most samples taken for each benchmark", "N" },
+		{ NULL}
+	};
+
+	setlocale (LC_ALL, "");
+
+	context = g_option_context_new ("[SUITE…] - benchmark the shared helpers");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("Failed to parse command line options: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	if (gfu_bench_samples < GFU_BENCH_SAMPLES_MIN) {
+		g_printerr ("Invalid --samples, at least %i are needed\n", GFU_BENCH_SAMPLES_MIN);
+		return EXIT_FAILURE;
+	}
+	for (gint i = 1; i < argc; i++) {
+		gboolean found = FALSE;
+		for (guint j = 0; j < G_N_ELEMENTS (gfu_bench_suites); j++)
+			found |= g_strcmp0 (argv[i], gfu_bench_suites[j].name) == 0;
+		if (!found) {
+			g_printerr ("No suite called %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* the suites named on the command line, or all of them */
+	for (guint j = 0; j < G_N_ELEMENTS (gfu_bench_suites); j++) {
+		g_autoptr(GError) error_local = NULL;
+		if (argc > 1 && !g_strv_contains ((const gchar * const *) argv + 1,
+						  gfu_bench_suites[j].name))
+			continue;
+		if (!gfu_bench_suites[j].func (&error_local)) {
+			g_printerr ("%s failed: %s\n", gfu_bench_suites[j].name, error_local->message);
+			ret = FALSE;
+		}
+	}
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -7,12 +7,15 @@
 
 #include "config.h"
 
+#include <glib/gi18n.h>
+
 #include "gfu-common.h"
+#include "gfu-stats.h"
 
 /* formatting helper functions */
 
-gchar *
-gfu_common_checksum_format (const gchar *checksum)
+const gchar *
+gfu_common_checksum_format (GString *str, const gchar *checksum)
 {
 	const gchar *checksum_type;
 	guint len;
@@ -30,13 +33,27 @@ gfu_common_checksum_format (const gchar *checksum)
 		checksum_type = "SHA512";
 	else
 		checksum_type = "SHA1";
-	return g_strdup_printf ("%s(%s)",
-				checksum_type,
-				checksum);
+	g_string_append (str, checksum_type);
+	g_string_append_c (str, '(');
+	g_string_append (str, checksum);
+	g_string_append_c (str, ')');
+	return str->str;
 }
 
+/* one string on each line; g_string_append_printf() would allocate */
 const gchar *
-gfu_common_seconds_to_string (guint64 seconds)
+gfu_common_array_join (GString *str, GPtrArray *array)
+{
+	for (guint i = 0; i < array->len; i++) {
+		if (i > 0)
+			g_string_append_c (str, '\n');
+		g_string_append (str, g_ptr_array_index (array, i));
+	}
+	return str->str;
+}
+
+const gchar *
+gfu_common_seconds_to_string (guint64 seconds, gchar *buf, gsize bufsz)
 {
 	guint64 minutes, hours;
 	if (seconds == 0)
@@ -47,19 +64,204 @@ gfu_common_seconds_to_string (guint64 seconds)
 		if (minutes >= 60) {
 			hours = minutes / 60;
 			minutes = minutes % 60;
-			return g_strdup_printf ("%lu hr, %lu min, %lu sec", hours, minutes, seconds);
+			g_snprintf (buf, bufsz,
+				    "%" G_GUINT64_FORMAT " hr, %" G_GUINT64_FORMAT " min, %" G_GUINT64_FORMAT " sec",
+				    hours, minutes, seconds);
+			return buf;
+		}
+		g_snprintf (buf, bufsz,
+			    "%" G_GUINT64_FORMAT " min, %" G_GUINT64_FORMAT " sec",
+			    minutes, seconds);
+		return buf;
+	}
+	g_snprintf (buf, bufsz, "%" G_GUINT64_FORMAT " sec", seconds);
+	return buf;
+}
+
+/* for skipping widget updates: @shown starts as NULL and NULL is stored as
+ * "", so the first update always happens and clears any placeholder */
+gboolean
+gfu_common_shown_update (gchar **shown, const gchar *value)
+{
+	if (value == NULL)
+		value = "";
+	if (g_strcmp0 (*shown, value) == 0)
+		return FALSE;
+	g_free (*shown);
+	*shown = g_strdup (value);
+	return TRUE;
+}
+
+const gchar *
+gfu_common_format_size (guint64 size, gchar *buf, gsize bufsz)
+{
+	const gchar *units[] = { "kB", "MB", "GB", "TB" };
+	gdouble value = size;
+
+	/* the same SI units as g_format_size(), without the allocation */
+	if (size < 1000) {
+		g_snprintf (buf, bufsz,
+			    ngettext ("%u byte", "%u bytes", (guint) size),
+			    (guint) size);
+		return buf;
+	}
+	for (guint i = 0; i < G_N_ELEMENTS (units); i++) {
+		value /= 1000;
+		if (value < 1000 || i == G_N_ELEMENTS (units) - 1) {
+			g_snprintf (buf, bufsz, "%.1f %s", value, units[i]);
+			break;
+		}
+	}
+	return buf;
+}
+
+/* lists nested deeper than this are numbered as the deepest one */
+#define GFU_COMMON_MARKUP_LISTS_MAX	8
+
+typedef struct {
+	guint		 idx;
+	gboolean	 ordered;
+} GfuCommonMarkupList;
+
+typedef struct {
+	GString		*str;
+	guint		 depth_text;	/* inside <p> or <li> */
+	guint		 depth_list;
+	GfuCommonMarkupList lists[GFU_COMMON_MARKUP_LISTS_MAX];
+	gboolean	 need_space;
+	gboolean	 at_start;
+} GfuCommonMarkupHelper;
+
+static void
+gfu_common_markup_flush_space (GfuCommonMarkupHelper *helper)
+{
+	if (helper->need_space && !helper->at_start)
+		g_string_append_c (helper->str, ' ');
+	helper->need_space = FALSE;
+	helper->at_start = FALSE;
+}
+
+static void
+gfu_common_markup_start_element_cb (GMarkupParseContext *context,
+				    const gchar *element_name,
+				    const gchar **attribute_names,
+				    const gchar **attribute_values,
+				    gpointer user_data,
+				    GError **error)
+{
+	GfuCommonMarkupHelper *helper = (GfuCommonMarkupHelper *) user_data;
+
+	/* support <p>, <ul>, <ol>, <li>, <em> and <code>, ignore all else */
+	if (g_strcmp0 (element_name, "p") == 0) {
+		helper->depth_text++;
+		helper->at_start = TRUE;
+		helper->need_space = FALSE;
+	} else if (g_strcmp0 (element_name, "ul") == 0 ||
+		   g_strcmp0 (element_name, "ol") == 0) {
+		GfuCommonMarkupList *list;
+		/* a list inside an item starts on its own line */
+		if (helper->depth_text > 0)
+			g_string_append_c (helper->str, '\n');
+		helper->depth_list++;
+		list = &helper->lists[MIN (helper->depth_list, GFU_COMMON_MARKUP_LISTS_MAX) - 1];
+		list->ordered = g_strcmp0 (element_name, "ol") == 0;
+		list->idx = 0;
+	} else if (g_strcmp0 (element_name, "li") == 0) {
+		GfuCommonMarkupList list_none = { 0 };
+		GfuCommonMarkupList *list = &list_none;
+		if (helper->depth_list > 0)
+			list = &helper->lists[MIN (helper->depth_list, GFU_COMMON_MARKUP_LISTS_MAX) - 1];
+		for (guint i = 1; i < helper->depth_list; i++)
+			g_string_append (helper->str, "   ");
+		list->idx++;
+		if (list->ordered)
+			g_string_append_printf (helper->str, " %u. ", list->idx);
+		else
+			g_string_append (helper->str, " • ");
+		helper->depth_text++;
+		helper->at_start = TRUE;
+		helper->need_space = FALSE;
+	} else if (helper->depth_text > 0 && g_strcmp0 (element_name, "em") == 0) {
+		gfu_common_markup_flush_space (helper);
+		g_string_append (helper->str, "<i>");
+	} else if (helper->depth_text > 0 && g_strcmp0 (element_name, "code") == 0) {
+		gfu_common_markup_flush_space (helper);
+		g_string_append (helper->str, "<tt>");
+	}
+}
+
+static void
+gfu_common_markup_end_element_cb (GMarkupParseContext *context,
+				  const gchar *element_name,
+				  gpointer user_data,
+				  GError **error)
+{
+	GfuCommonMarkupHelper *helper = (GfuCommonMarkupHelper *) user_data;
+
+	if (g_strcmp0 (element_name, "p") == 0) {
+		helper->depth_text--;
+		g_string_append (helper->str, "\n\n");
+	} else if (g_strcmp0 (element_name, "ul") == 0 ||
+		   g_strcmp0 (element_name, "ol") == 0) {
+		if (helper->depth_list > 0)
+			helper->depth_list--;
+		/* the item around a nested list already ends the line */
+		if (helper->depth_text == 0)
+			g_string_append (helper->str, "\n");
+	} else if (g_strcmp0 (element_name, "li") == 0) {
+		helper->depth_text--;
+		if (helper->str->len == 0 || helper->str->str[helper->str->len - 1] != '\n')
+			g_string_append_c (helper->str, '\n');
+	} else if (helper->depth_text > 0 && g_strcmp0 (element_name, "em") == 0) {
+		g_string_append (helper->str, "</i>");
+	} else if (helper->depth_text > 0 && g_strcmp0 (element_name, "code") == 0) {
+		g_string_append (helper->str, "</tt>");
+	}
+}
+
+static void
+gfu_common_markup_text_cb (GMarkupParseContext *context,
+			   const gchar *text,
+			   gsize text_len,
+			   gpointer user_data,
+			   GError **error)
+{
+	GfuCommonMarkupHelper *helper = (GfuCommonMarkupHelper *) user_data;
+
+	/* whitespace between elements */
+	if (helper->depth_text == 0)
+		return;
+
+	/* collapse whitespace and escape for Pango */
+	for (gsize i = 0; i < text_len; i++) {
+		if (g_ascii_isspace (text[i])) {
+			helper->need_space = TRUE;
+			continue;
 		}
-		return g_strdup_printf ("%lu min, %lu sec", minutes, seconds);
+		gfu_common_markup_flush_space (helper);
+		if (text[i] == '<')
+			g_string_append (helper->str, "&lt;");
+		else if (text[i] == '>')
+			g_string_append (helper->str, "&gt;");
+		else if (text[i] == '&')
+			g_string_append (helper->str, "&amp;");
+		else
+			g_string_append_c (helper->str, text[i]);
 	}
-	return g_strdup_printf ("%lu sec", seconds);
 }
 
 gchar *
-gfu_common_xml_to_text (const gchar *xml, GError **error)
+gfu_common_xml_to_markup (const gchar *xml, GError **error)
 {
+	const GMarkupParser parser = {
+		gfu_common_markup_start_element_cb,
+		gfu_common_markup_end_element_cb,
+		gfu_common_markup_text_cb,
+		NULL,
+		NULL };
 	g_autoptr(GString) str = g_string_new (NULL);
-	g_autoptr(XbNode) n = NULL;
-	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(GMarkupParseContext) ctx = NULL;
+	GfuCommonMarkupHelper helper = { .str = str };
 
 	if (xml == NULL) {
 		g_set_error_literal (error,
@@ -69,47 +271,20 @@ gfu_common_xml_to_text (const gchar *xml, GError **error)
 		return NULL;
 	}
 
-	/* parse XML */
-	silo = xb_silo_new_from_xml (xml, error);
-	if (silo == NULL)
+	/* the description is a fragment without a root element */
+	ctx = g_markup_parse_context_new (&parser, G_MARKUP_PREFIX_ERROR_POSITION,
+					  &helper, NULL);
+	if (!g_markup_parse_context_parse (ctx, "<description>", -1, error))
+		return NULL;
+	if (!g_markup_parse_context_parse (ctx, xml, -1, error))
+		return NULL;
+	if (!g_markup_parse_context_parse (ctx, "</description>", -1, error))
+		return NULL;
+	if (!g_markup_parse_context_end_parse (ctx, error))
 		return NULL;
 
-	n = xb_silo_get_root (silo);
-	while (n != NULL) {
-		g_autoptr(XbNode) n2 = NULL;
-
-		/* support <p>, <ul>, <ol> and <li>, ignore all else */
-		if (g_strcmp0 (xb_node_get_element (n), "p") == 0) {
-			g_string_append_printf (str, "%s\n\n", xb_node_get_text (n));
-		} else if (g_strcmp0 (xb_node_get_element (n), "ul") == 0) {
-			g_autoptr(GPtrArray) children = xb_node_get_children (n);
-			for (guint i = 0; i < children->len; i++) {
-				XbNode *nc = g_ptr_array_index (children, i);
-				if (g_strcmp0 (xb_node_get_element (nc), "li") == 0) {
-					g_string_append_printf (str, " • %s\n",
-								xb_node_get_text (nc));
-				}
-			}
-			g_string_append (str, "\n");
-		} else if (g_strcmp0 (xb_node_get_element (n), "ol") == 0) {
-			g_autoptr(GPtrArray) children = xb_node_get_children (n);
-			for (guint i = 0; i < children->len; i++) {
-				XbNode *nc = g_ptr_array_index (children, i);
-				if (g_strcmp0 (xb_node_get_element (nc), "li") == 0) {
-					g_string_append_printf (str, " %u. %s\n",
-								i + 1,
-								xb_node_get_text (nc));
-				}
-			}
-			g_string_append (str, "\n");
-		}
-
-		n2 = xb_node_get_next (n);
-		g_set_object (&n, n2);
-	}
-
-	/* remove extra newline */
-	if (str->len > 0)
+	/* remove trailing newlines */
+	while (str->len > 0 && str->str[str->len - 1] == '\n')
 		g_string_truncate (str, str->len - 1);
 
 	/* success */
@@ -117,39 +292,208 @@ gfu_common_xml_to_text (const gchar *xml, GError **error)
 }
 
 const gchar *
-gfu_common_device_flags_to_strings (guint64 flags)
+gfu_common_device_flags_to_strings (GString *str, guint64 flags)
 {
-	g_autoptr(GString) str = g_string_new (NULL);
-	for (guint j = 0; j < 64; j++) {
-		if ((flags & ((guint64) 1 << j)) == 0)
-			continue;
-		g_string_append_printf (str, "%s\n",
-					fwupd_device_flag_to_string ((guint64) 1 << j));
+	for (guint64 tmp = flags; tmp != 0; tmp &= tmp - 1) {
+		guint j = GFU_FLAG_BIT (tmp);
+		if (str->len > 0)
+			g_string_append_c (str, '\n');
+		g_string_append (str, fwupd_device_flag_to_string ((guint64) 1 << j));
 	}
-	if (str->len == 0) {
+	if (str->len == 0)
 		g_string_append (str, fwupd_device_flag_to_string (0));
-	} else {
-		g_string_truncate (str, str->len - 1);
-	}
-	return g_string_free (g_steal_pointer (&str), FALSE);
+	return str->str;
 }
 
 const gchar *
-gfu_common_release_flags_to_strings (guint64 flags)
+gfu_common_release_flags_to_strings (GString *str, guint64 flags)
 {
-	g_autoptr(GString) str = g_string_new (NULL);
-	for (guint j = 0; j < 64; j++) {
-		if ((flags & ((guint64) 1 << j)) == 0)
+	for (guint64 tmp = flags; tmp != 0; tmp &= tmp - 1) {
+		guint j = GFU_FLAG_BIT (tmp);
+		const GfuFlagInfo *info = gfu_common_release_flag_get_info (j);
+		if (info != NULL && info->label == NULL)
 			continue;
-		g_string_append_printf (str, "%s\n",
-					fwupd_device_flag_to_string ((guint64) 1 << j));
-	}
-	if (str->len == 0) {
+		if (str->len > 0)
+			g_string_append_c (str, '\n');
+		if (info != NULL)
+			g_string_append (str, _(info->label));
+		else
+			g_string_append (str, fwupd_release_flag_to_string ((guint64) 1 << j));
+	}
+	if (str->len == 0)
 		g_string_append (str, fwupd_release_flag_to_string (0));
-	} else {
-		g_string_truncate (str, str->len - 1);
+	return str->str;
+}
+
+/* D-Bus helper functions */
+
+GPtrArray *
+gfu_common_device_array_from_variant (GVariant *value)
+{
+	gsize sz;
+	guint skipped = 0;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autoptr(GVariant) untuple = NULL;
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	untuple = g_variant_get_child_value (value, 0);
+	sz = g_variant_n_children (untuple);
+	for (guint i = 0; i < sz; i++) {
+		guint64 flags = 0;
+		g_autoptr(GVariant) data = g_variant_get_child_value (untuple, i);
+
+		/* only the flags are looked at before deciding to build the object */
+		g_variant_lookup (data, "Flags", "t", &flags);
+		if ((flags & (FWUPD_DEVICE_FLAG_UPDATABLE | FWUPD_DEVICE_FLAG_LOCKED)) == 0) {
+			const gchar *id = NULL;
+			g_variant_lookup (data, "DeviceId", "&s", &id);
+			g_debug ("ignoring non-updatable device: %s", id);
+			skipped++;
+			continue;
+		}
+		g_ptr_array_add (array, fwupd_device_from_variant (data));
 	}
-	return g_string_free (g_steal_pointer (&str), FALSE);
+	gfu_stats_add (GFU_STATS_COUNTER_DEVICES_DECODED, array->len);
+	g_debug ("parsed %u devices and skipped %u in %.1fms",
+		 array->len, skipped, g_timer_elapsed (timer, NULL) * 1000);
+	return g_steal_pointer (&array);
+}
+
+/* only decoded when the release details are shown */
+static const gchar *release_keys_details[] = {
+	"Checksum",
+	"Description",
+	"Issues",
+	NULL
+};
+
+static GVariant *
+gfu_common_variant_filter (GVariant *dict, const gchar **keys, gboolean include)
+{
+	GVariantBuilder builder;
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, dict);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		if (g_strv_contains (keys, key) == include)
+			g_variant_builder_add (&builder, "{sv}", key, value);
+		g_variant_unref (value);
+	}
+	return g_variant_builder_end (&builder);
+}
+
+/* what the device rows and the stale device pane show */
+static const gchar *device_keys_snapshot[] = {
+	"DeviceId",
+	"Name",
+	"Summary",
+	"Icon",
+	"Guid",
+	"Serial",
+	"Vendor",
+	"VendorId",
+	"Version",
+	"VersionLowest",
+	"VersionBootloader",
+	"Flags",
+	"FlashesLeft",
+	"InstallDuration",
+	"UpdateError",
+	NULL
+};
+
+GVariant *
+gfu_common_device_array_to_snapshot (GPtrArray *devices)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *device = g_ptr_array_index (devices, i);
+		g_autoptr(GVariant) data = g_variant_ref_sink (fwupd_device_to_variant (device));
+		g_variant_builder_add_value (&builder,
+					     gfu_common_variant_filter (data, device_keys_snapshot, TRUE));
+	}
+	return g_variant_new ("(@aa{sv})", g_variant_builder_end (&builder));
+}
+
+GVariant *
+gfu_common_release_reply_strip_details (GVariant *value)
+{
+	GVariantBuilder builder;
+	gsize sz;
+	g_autoptr(GVariant) untuple = g_variant_get_child_value (value, 0);
+
+	/* small enough to keep on disk for every device */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	sz = g_variant_n_children (untuple);
+	for (guint i = 0; i < sz; i++) {
+		g_autoptr(GVariant) data = g_variant_get_child_value (untuple, i);
+		g_variant_builder_add_value (&builder,
+					     gfu_common_variant_filter (data, release_keys_details, FALSE));
+	}
+	return g_variant_new ("(@aa{sv})", g_variant_builder_end (&builder));
+}
+
+GPtrArray *
+gfu_common_release_array_from_variant (GVariant *value)
+{
+	gsize sz;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GVariant) untuple = NULL;
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	untuple = g_variant_get_child_value (value, 0);
+	sz = g_variant_n_children (untuple);
+	for (guint i = 0; i < sz; i++) {
+		FwupdRelease *release;
+		g_autoptr(GVariant) data = g_variant_get_child_value (untuple, i);
+		g_autoptr(GVariant) summary = NULL;
+
+		/* the child shares the reply buffer, so keeping it is cheap */
+		summary = g_variant_ref_sink (gfu_common_variant_filter (data, release_keys_details, FALSE));
+		release = fwupd_release_from_variant (summary);
+		g_object_set_data_full (G_OBJECT (release), "GfuReleaseVariant",
+					g_steal_pointer (&data),
+					(GDestroyNotify) g_variant_unref);
+		g_ptr_array_add (array, release);
+	}
+	gfu_stats_add (GFU_STATS_COUNTER_RELEASES_DECODED, array->len);
+	return g_steal_pointer (&array);
+}
+
+void
+gfu_common_release_ensure_details (FwupdRelease *release)
+{
+	GPtrArray *checksums;
+	GVariant *data = g_object_get_data (G_OBJECT (release), "GfuReleaseVariant");
+	g_autoptr(FwupdRelease) tmp = NULL;
+	g_autoptr(GVariant) details = NULL;
+
+	/* already done, or not created from a reply */
+	if (data == NULL)
+		return;
+
+	details = g_variant_ref_sink (gfu_common_variant_filter (data, release_keys_details, TRUE));
+	tmp = fwupd_release_from_variant (details);
+	fwupd_release_set_description (release, fwupd_release_get_description (tmp));
+	checksums = fwupd_release_get_checksums (tmp);
+	for (guint i = 0; i < checksums->len; i++)
+		fwupd_release_add_checksum (release, g_ptr_array_index (checksums, i));
+#if FWUPD_CHECK_VERSION(1,3,2)
+	{
+		GPtrArray *issues = fwupd_release_get_issues (tmp);
+		for (guint i = 0; i < issues->len; i++)
+			fwupd_release_add_issue (release, g_ptr_array_index (issues, i));
+	}
+#endif
+
+	/* drop the reference to the reply */
+	g_object_set_data (G_OBJECT (release), "GfuReleaseVariant", NULL);
 }
 
 /* handle needs-reboot and needs-shutdown */
@@ -332,195 +676,227 @@ gfu_common_setup_networking (GError **error)
 	return g_steal_pointer (&session);
 }
 
-/* GTK helper functions */
-
-gchar *
-gfu_common_device_flag_to_string (guint64 device_flag)
+/* so that the fwupd client, the proxy and logind can all be pointed at a
+ * test bus, this has to be called before anything connects to it */
+gboolean
+gfu_common_set_bus (const gchar *bus, GError **error)
 {
-	if (device_flag == FWUPD_DEVICE_FLAG_NONE) {
-		return NULL;
+	g_autofree gchar *address = NULL;
+
+	if (bus == NULL || g_strcmp0 (bus, "system") == 0)
+		return TRUE;
+	if (g_strcmp0 (bus, "session") == 0) {
+		address = g_dbus_address_get_for_bus_sync (G_BUS_TYPE_SESSION, NULL, error);
+		if (address == NULL)
+			return FALSE;
+	} else if (g_dbus_is_address (bus)) {
+		address = g_strdup (bus);
+	} else {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "'%s' is not system, session or a D-Bus address", bus);
+		return FALSE;
 	}
-	if (device_flag == FWUPD_DEVICE_FLAG_INTERNAL) {
+	g_debug ("using %s as the system bus", address);
+	g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", address, TRUE);
+	return TRUE;
+}
+
+/* GTK helper functions */
+
+/* the same as GFU_FLAG_BIT() for a single flag, but usable in an initializer */
+#define GFU_FLAG_INDEX(flag) \
+	((((guint64) (flag) & G_GUINT64_CONSTANT (0xffffffff00000000)) ? 32 : 0) + \
+	 (((guint64) (flag) & G_GUINT64_CONSTANT (0xffff0000ffff0000)) ? 16 : 0) + \
+	 (((guint64) (flag) & G_GUINT64_CONSTANT (0xff00ff00ff00ff00)) ? 8 : 0) + \
+	 (((guint64) (flag) & G_GUINT64_CONSTANT (0xf0f0f0f0f0f0f0f0)) ? 4 : 0) + \
+	 (((guint64) (flag) & G_GUINT64_CONSTANT (0xcccccccccccccccc)) ? 2 : 0) + \
+	 (((guint64) (flag) & G_GUINT64_CONSTANT (0xaaaaaaaaaaaaaaaa)) ? 1 : 0))
+
+/* indexed by bit number so that looking up a set flag is a single load */
+static const GfuFlagInfo device_flag_info[64] = {
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_INTERNAL)] = {
 		/* TRANSLATORS: Device cannot be removed easily*/
-		return _("Internal device");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_UPDATABLE) {
+		N_("Internal device"), "drive-harddisk-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_UPDATABLE)] = {
 		/* TRANSLATORS: Device is updatable in this or any other mode */
-		return _("Updatable");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_ONLY_OFFLINE) {
+		N_("Updatable"), "software-update-available-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_ONLY_OFFLINE)] = {
 		/* TRANSLATORS: Update can only be done from offline mode */
-		return _("Update requires a reboot");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_REQUIRE_AC) {
+		N_("Update requires a reboot"), "network-offline-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_REQUIRE_AC)] = {
 		/* TRANSLATORS: Must be plugged in to an outlet */
-		return _("Requires AC power");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_LOCKED) {
+		N_("Requires AC power"), "battery-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_LOCKED)] = {
 		/* TRANSLATORS: Is locked and can be unlocked */
-		return _("Device is locked");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_SUPPORTED) {
+		N_("Device is locked"), "locked-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_SUPPORTED)] = {
 		/* TRANSLATORS: Is found in current metadata */
-		return _("Supported on LVFS");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER) {
+		N_("Supported on LVFS"), "security-high-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER)] = {
 		/* TRANSLATORS: Requires a bootloader mode to be manually enabled by the user */
-		return _("Requires a bootloader");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_REBOOT) {
+		N_("Requires a bootloader"), "computer-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_REGISTERED)] = {
+		NULL, NULL, TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_NEEDS_REBOOT)] = {
 		/* TRANSLATORS: Requires a reboot to apply firmware or to reload hardware */
-		return _("Needs a reboot after installation");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_SHUTDOWN) {
+		N_("Needs a reboot after installation"), "system-reboot-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_NEEDS_SHUTDOWN)] = {
 		/* TRANSLATORS: Requires system shutdown to apply firmware */
-		return _("Needs shutdown after installation");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_REPORTED) {
+		N_("Needs shutdown after installation"), "system-shutdown-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_REPORTED)] = {
 		/* TRANSLATORS: Has been reported to a metadata server */
-		return _("Reported to LVFS");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_NOTIFIED) {
+		N_("Reported to LVFS"), "task-due-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_NOTIFIED)] = {
 		/* TRANSLATORS: User has been notified */
-		return _("User has been notified");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_USE_RUNTIME_VERSION) {
-		/* skip */
-		return NULL;
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_INSTALL_PARENT_FIRST) {
+		N_("User has been notified"), "task-due-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_USE_RUNTIME_VERSION)] = {
+		NULL, "system-run-symbolic", TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_INSTALL_PARENT_FIRST)] = {
 		/* TRANSLATORS: Install composite firmware on the parent before the child */
-		return _("Install to parent device first");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_IS_BOOTLOADER) {
+		N_("Install to parent device first"), "system-software-install-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_IS_BOOTLOADER)] = {
 		/* TRANSLATORS: Is currently in bootloader mode */
-		return _("Is in bootloader mode");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG) {
+		N_("Is in bootloader mode"), "computer-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)] = {
 		/* TRANSLATORS: The hardware is waiting to be replugged */
-		return _("Hardware is waiting to be replugged");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_IGNORE_VALIDATION) {
+		N_("Hardware is waiting to be replugged"), "battery-low-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_IGNORE_VALIDATION)] = {
 		/* TRANSLATORS: Ignore validation safety checks when flashing this device */
-		return _("Ignore validation safety checks");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_ANOTHER_WRITE_REQUIRED) {
-		/* skip */
-		return NULL;
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_NO_AUTO_INSTANCE_IDS) {
-		/* skip */
-		return NULL;
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION) {
+		N_("Ignore validation safety checks"), "dialog-error-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_TRUSTED)] = {
+		NULL, NULL, TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_ANOTHER_WRITE_REQUIRED)] = {
+		NULL, "media-floppy-symbolic", TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_NO_AUTO_INSTANCE_IDS)] = {
+		NULL, "dialog-error-symbolic", TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION)] = {
 		/* TRANSLATORS: Device update needs to be separately activated */
-		return _("Device update needs activation");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_ENSURE_SEMVER) {
-		/* skip */
-		return NULL;
-	}
+		N_("Device update needs activation"), "emblem-important-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_ENSURE_SEMVER)] = {
+		NULL, "emblem-important-symbolic", TRUE },
 #if FWUPD_CHECK_VERSION(1,3,2)
-	if (device_flag == FWUPD_DEVICE_FLAG_HISTORICAL) {
-		/* skip */
-		return NULL;
-	}
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_HISTORICAL)] = {
+		NULL, NULL, TRUE },
 #endif
 #if FWUPD_CHECK_VERSION(1,3,3)
-	if (device_flag == FWUPD_DEVICE_FLAG_ONLY_SUPPORTED) {
-		/* skip */
-		return NULL;
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_WILL_DISAPPEAR) {
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_ONLY_SUPPORTED)] = {
+		NULL, NULL, TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_WILL_DISAPPEAR)] = {
 		/* TRANSLATORS: Device will not return after update completes */
-		return _("Device will not re-appear after update completes");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_CAN_VERIFY) {
+		N_("Device will not re-appear after update completes"), "emblem-important-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_CAN_VERIFY)] = {
 		/* TRANSLATORS: Device supports some form of checksum verification */
-		return _("Cryptographic hash verification is available");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE) {
-		/* skip */
-		return NULL;
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_DUAL_IMAGE) {
+		N_("Cryptographic hash verification is available"), "emblem-important-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE)] = {
+		NULL, NULL, TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_DUAL_IMAGE)] = {
 		/* TRANSLATORS: Device supports a safety mechanism for flashing */
-		return _("Device stages updates");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_SELF_RECOVERY) {
+		N_("Device stages updates"), "emblem-important-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_SELF_RECOVERY)] = {
 		/* TRANSLATORS: Device supports a safety mechanism for flashing */
-		return _("Device can recover flash failures");
-	}
-	if (device_flag == FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE) {
+		N_("Device can recover flash failures"), "emblem-important-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE)] = {
 		/* TRANSLATORS: Device remains usable during update */
-		return _("Device is usable for the duration of the update");
-	}
+		N_("Device is usable for the duration of the update"), "emblem-important-symbolic" },
+#endif
+#if FWUPD_CHECK_VERSION(1,3,7)
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_VERSION_CHECK_REQUIRED)] = {
+		NULL, NULL, TRUE },
+	[GFU_FLAG_INDEX (FWUPD_DEVICE_FLAG_INSTALL_ALL_RELEASES)] = {
+		NULL, NULL, TRUE },
 #endif
-	if (device_flag == FWUPD_DEVICE_FLAG_UNKNOWN) {
+};
+
+static const GfuFlagInfo release_flag_info[64] = {
+	[GFU_FLAG_INDEX (FWUPD_RELEASE_FLAG_TRUSTED_PAYLOAD)] = {
+		/* TRANSLATORS: the firmware archive was signed by a trusted key */
+		N_("Trusted payload"), "security-high-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_RELEASE_FLAG_TRUSTED_METADATA)] = {
+		/* TRANSLATORS: the metadata describing the release was signed by a trusted key */
+		N_("Trusted metadata"), "security-high-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_RELEASE_FLAG_IS_UPGRADE)] = {
+		/* TRANSLATORS: the release is newer than the installed version */
+		N_("Is upgrade"), "go-up-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_RELEASE_FLAG_IS_DOWNGRADE)] = {
+		/* TRANSLATORS: the release is older than the installed version */
+		N_("Is downgrade"), "go-down-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_RELEASE_FLAG_BLOCKED_VERSION)] = {
+		/* TRANSLATORS: the release cannot be installed on this version */
+		N_("Blocked version"), "dialog-error-symbolic" },
+	[GFU_FLAG_INDEX (FWUPD_RELEASE_FLAG_BLOCKED_APPROVAL)] = {
+		/* TRANSLATORS: the release has not been approved by the site administrator */
+		N_("Not approved"), "dialog-error-symbolic" },
+};
+
+const GfuFlagInfo *
+gfu_common_device_flag_get_info (guint bit)
+{
+	const GfuFlagInfo *info;
+	if (bit >= G_N_ELEMENTS (device_flag_info))
+		return NULL;
+	info = &device_flag_info[bit];
+	if (info->label == NULL && !info->hidden)
+		return NULL;
+	return info;
+}
+
+const GfuFlagInfo *
+gfu_common_release_flag_get_info (guint bit)
+{
+	const GfuFlagInfo *info;
+	if (bit >= G_N_ELEMENTS (release_flag_info))
+		return NULL;
+	info = &release_flag_info[bit];
+	if (info->label == NULL && !info->hidden)
 		return NULL;
+	return info;
+}
+
+void
+gfu_common_flag_info_check (void)
+{
+	/* flags added to newer daemons are shown by their ID until described */
+	for (guint j = 0; j < 64; j++) {
+		const gchar *tmp = fwupd_device_flag_to_string ((guint64) 1 << j);
+		if (tmp != NULL && g_strcmp0 (tmp, "unknown") != 0 &&
+		    gfu_common_device_flag_get_info (j) == NULL)
+			g_debug ("no description for device flag %s", tmp);
+		tmp = fwupd_release_flag_to_string ((guint64) 1 << j);
+		if (tmp != NULL && g_strcmp0 (tmp, "unknown") != 0 &&
+		    gfu_common_release_flag_get_info (j) == NULL)
+			g_debug ("no description for release flag %s", tmp);
 	}
-	return NULL;
 }
 
-gchar *
+const gchar *
+gfu_common_device_flag_to_string (guint64 device_flag)
+{
+	const GfuFlagInfo *info;
+
+	/* exactly one bit has to be set */
+	if (device_flag == 0 || (device_flag & (device_flag - 1)) != 0)
+		return NULL;
+	info = gfu_common_device_flag_get_info (GFU_FLAG_BIT (device_flag));
+	if (info == NULL || info->label == NULL)
+		return NULL;
+	return _(info->label);
+}
+
+const gchar *
 gfu_common_device_icon_from_flag (FwupdDeviceFlags device_flag)
 {
-	if (device_flag == FWUPD_DEVICE_FLAG_INTERNAL)
-		return "drive-harddisk-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_UPDATABLE)
-		return "software-update-available-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_ONLY_OFFLINE)
-		return "network-offline-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_REQUIRE_AC)
-		return "battery-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_LOCKED)
-		return "locked-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_SUPPORTED)
-		return "security-high-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER)
-		return "computer-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_REBOOT)
-		return "system-reboot-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_SHUTDOWN)
-		return "system-shutdown-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_REPORTED)
-		return "task-due-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_NOTIFIED)
-		return "task-due-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_USE_RUNTIME_VERSION)
-		return "system-run-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_INSTALL_PARENT_FIRST)
-		return "system-software-install-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_IS_BOOTLOADER)
-		return "computer-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)
-		return "battery-low-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_IGNORE_VALIDATION)
-		return "dialog-error-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_ANOTHER_WRITE_REQUIRED)
-		return "media-floppy-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_NO_AUTO_INSTANCE_IDS)
-		return "dialog-error-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION)
-		return "emblem-important-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_ENSURE_SEMVER)
-		return "emblem-important-symbolic";
-#if FWUPD_CHECK_VERSION(1,3,3)
-	if (device_flag == FWUPD_DEVICE_FLAG_WILL_DISAPPEAR)
-		return "emblem-important-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_CAN_VERIFY)
-		return "emblem-important-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_DUAL_IMAGE)
-		return "emblem-important-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_SELF_RECOVERY)
-		return "emblem-important-symbolic";
-	if (device_flag == FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE)
-		return "emblem-important-symbolic";
+	const GfuFlagInfo *info;
 
-#endif
 	if (device_flag == FWUPD_DEVICE_FLAG_UNKNOWN)
 		return "unknown-symbolic";
-	return NULL;
+	if (device_flag == 0 || (device_flag & (device_flag - 1)) != 0)
+		return NULL;
+	info = gfu_common_device_flag_get_info (GFU_FLAG_BIT (device_flag));
+	if (info == NULL)
+		return NULL;
+	return info->icon;
 }
 
 gchar *
@@ -7,7 +7,7 @@
 
 #pragma once
 
-#include <xmlb.h>
+#include <fwupd.h>
 #include <libsoup/soup.h>
 #include <errno.h>
 
@@ -21,17 +21,36 @@ typedef enum {
 	GFU_OPERATION_LAST
 } GfuOperation;
 
-/* formatting helper functions */
-gchar           *gfu_common_checksum_format             (const gchar	*checksum);
-const gchar     *gfu_common_seconds_to_string           (guint64	seconds);
-gchar           *gfu_common_xml_to_text                 (const gchar	*xml,
+/* formatting helper functions, writing into caller-provided buffers */
+const gchar     *gfu_common_checksum_format             (GString	*str,
+							 const gchar	*checksum);
+const gchar     *gfu_common_array_join                  (GString	*str,
+							 GPtrArray	*array);
+const gchar     *gfu_common_seconds_to_string           (guint64	seconds,
+							 gchar		*buf,
+							 gsize		 bufsz);
+const gchar     *gfu_common_format_size                 (guint64	size,
+							 gchar		*buf,
+							 gsize		 bufsz);
+gboolean         gfu_common_shown_update                (gchar		**shown,
+							 const gchar	*value);
+gchar           *gfu_common_xml_to_markup               (const gchar	*xml,
 							 GError		**error);
-const gchar     *gfu_common_device_flags_to_strings     (guint64	flags);
-const gchar     *gfu_common_release_flags_to_strings    (guint64	flags);
+const gchar     *gfu_common_device_flags_to_strings     (GString	*str,
+							 guint64	flags);
+const gchar     *gfu_common_release_flags_to_strings    (GString	*str,
+							 guint64	flags);
 const gchar     *gfu_status_to_string                   (FwupdStatus	 status);
 gchar           *gfu_operation_to_string                (GfuOperation	 operation,
                                                         FwupdDevice	*device);
 
+/* D-Bus helper functions */
+GPtrArray	*gfu_common_device_array_from_variant	(GVariant	*value);
+GPtrArray	*gfu_common_release_array_from_variant	(GVariant	*value);
+void		 gfu_common_release_ensure_details	(FwupdRelease	*release);
+GVariant	*gfu_common_release_reply_strip_details	(GVariant	*value);
+GVariant	*gfu_common_device_array_to_snapshot	(GPtrArray	*devices);
+
 /* handle needs-reboot and needs-shutdown */
 gboolean        gfu_common_system_shutdown              (GError		**error);
 gboolean        gfu_common_system_reboot                (GError		**error);
@@ -43,10 +62,49 @@ gboolean        gfu_common_file_exists_with_checksum    (const gchar	*fn,
 				                         const gchar	*checksum_expected,
 				                         GChecksumType	checksum_type);
 SoupSession     *gfu_common_setup_networking            (GError		**error);
+gboolean	 gfu_common_set_bus			(const gchar	*bus,
+							 GError		**error);
 gchar 		*gfu_get_user_cache_path		(const gchar *fn);
 
 /* GTK helper functions */
-gchar		*gfu_common_device_flag_to_string		(guint64	device_flag);
-gchar		*gfu_common_device_icon_from_flag		(FwupdDeviceFlags device_flag);
+typedef struct {
+	const gchar	*label;		/* untranslated */
+	const gchar	*icon;
+	gboolean	 hidden;	/* known, but not shown to the user */
+} GfuFlagInfo;
+
+/* the bit number of the lowest set flag, which must not be zero */
+#if G_GNUC_CHECK_VERSION(3,4)
+#define GFU_HAVE_BUILTIN_CTZLL
+#elif defined(__has_builtin)
+#if __has_builtin(__builtin_ctzll)
+#define GFU_HAVE_BUILTIN_CTZLL
+#endif
+#endif
+
+#ifdef GFU_HAVE_BUILTIN_CTZLL
+#define GFU_FLAG_BIT(flag)	((guint) __builtin_ctzll (flag))
+#else
+/* isolate the lowest bit, and look up the top six bits of its de Bruijn
+ * product, as g_bit_nth_lsf() tests one bit at a time */
+static inline guint
+gfu_flag_bit (guint64 flag)
+{
+	static const guint8 table[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6,
+	};
+	return table[((flag & (~flag + 1)) * G_GUINT64_CONSTANT (0x03f79d71b4cb0a89)) >> 58];
+}
+#define GFU_FLAG_BIT(flag)	gfu_flag_bit (flag)
+#endif
+
+const GfuFlagInfo *gfu_common_device_flag_get_info		(guint		bit);
+const GfuFlagInfo *gfu_common_release_flag_get_info		(guint		bit);
+void		 gfu_common_flag_info_check			(void);
+const gchar	*gfu_common_device_flag_to_string		(guint64	device_flag);
+const gchar	*gfu_common_device_icon_from_flag		(FwupdDeviceFlags device_flag);
 
 G_END_DECLS
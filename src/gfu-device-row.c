@@ -6,6 +6,7 @@
 
 #include "config.h"
 
+#include "gfu-common.h"
 #include "gfu-device-row.h"
 
 typedef struct {
@@ -13,44 +14,110 @@ typedef struct {
 	GtkWidget	*image;
 	GtkWidget	*name;
 	GtkWidget	*summary;
+	GtkWidget	*count;
+	GtkWidget	*members;
+	GtkWidget	*revealer_members;
+	GPtrArray	*group;			/* of FwupdDevice, or NULL */
 	guint		 pending_refresh_id;
+	gchar		*name_shown;		/* see gfu_common_shown_update() */
+	gchar		*summary_shown;
+	GIcon		*icon_shown;		/* owned by icon_cache */
+	gchar		*members_shown;
 } GfuDeviceRowPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GfuDeviceRow, gfu_device_row, GTK_TYPE_LIST_BOX_ROW)
 
+/* icons are shared by every row, keyed by the icon names in order */
+static GHashTable *icon_cache = NULL;
+
+static GIcon *
+gfu_device_row_get_icon (FwupdDevice *device)
+{
+	GIcon *icon;
+	GPtrArray *icons = fwupd_device_get_icons (device);
+	static GString *key = NULL;
+
+	if (icon_cache == NULL) {
+		icon_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) g_object_unref);
+	}
+	if (key == NULL)
+		key = g_string_new (NULL);
+	g_string_truncate (key, 0);
+	for (guint i = 0; i < icons->len; i++) {
+		g_string_append (key, g_ptr_array_index (icons, i));
+		g_string_append_c (key, '\n');
+	}
+	icon = g_hash_table_lookup (icon_cache, key->str);
+	if (icon != NULL)
+		return icon;
+
+	/* set icon, with fallbacks */
+	icon = g_themed_icon_new ("computer");
+	for (guint i = 0; i < icons->len; i++) {
+		const gchar *icon_name = g_ptr_array_index (icons, i);
+		g_themed_icon_prepend_name (G_THEMED_ICON (icon), icon_name);
+	}
+	g_hash_table_insert (icon_cache, g_strdup (key->str), icon);
+	return icon;
+}
+
 static void
 gfu_device_row_refresh (GfuDeviceRow *self)
 {
-	const gchar *tmp;
-	GPtrArray *icons;
-	g_autoptr(GIcon) icon = g_themed_icon_new ("computer");
+	GIcon *icon;
 
 	GfuDeviceRowPrivate *priv = gfu_device_row_get_instance_private (self);
 	if (priv->device == NULL)
 		return;
 
 	/* row labels - name, summary */
-	tmp = fwupd_device_get_name (priv->device);
-	gtk_label_set_label (GTK_LABEL (priv->name), tmp);
-	tmp = fwupd_device_get_summary (priv->device);
-	gtk_label_set_label (GTK_LABEL (priv->summary), tmp);
-	gtk_widget_set_visible (priv->summary, TRUE);
+	if (gfu_common_shown_update (&priv->name_shown, fwupd_device_get_name (priv->device)))
+		gtk_label_set_label (GTK_LABEL (priv->name), priv->name_shown);
+	if (gfu_common_shown_update (&priv->summary_shown, fwupd_device_get_summary (priv->device))) {
+		gtk_label_set_label (GTK_LABEL (priv->summary), priv->summary_shown);
+		gtk_widget_set_visible (priv->summary, TRUE);
+	}
 
-	/* set icon, with fallbacks */
-	icons = fwupd_device_get_icons (priv->device);
-	for (guint i = 0; i < icons->len; i++) {
-		const gchar *icon_name = g_ptr_array_index (icons, i);
-		g_themed_icon_prepend_name (G_THEMED_ICON (icon), icon_name);
+	/* the same shared icon does not need to be looked up by GTK again */
+	icon = gfu_device_row_get_icon (priv->device);
+	if (icon != priv->icon_shown) {
+		priv->icon_shown = icon;
+		gtk_image_set_from_gicon (GTK_IMAGE (priv->image), icon, -1);
+	}
+
+	/* identical devices shown as one row */
+	if (priv->group != NULL && priv->group->len > 1) {
+		g_autoptr(GString) str = g_string_new (NULL);
+		gchar buf[16];
+		for (guint i = 0; i < priv->group->len; i++) {
+			FwupdDevice *device = g_ptr_array_index (priv->group, i);
+			const gchar *tmp = fwupd_device_get_serial (device);
+			if (str->len > 0)
+				g_string_append_c (str, '\n');
+			g_string_append (str, tmp != NULL ? tmp : fwupd_device_get_id (device));
+		}
+		if (gfu_common_shown_update (&priv->members_shown, str->str))
+			gtk_label_set_label (GTK_LABEL (priv->members), priv->members_shown);
+		g_snprintf (buf, sizeof (buf), "×%u", priv->group->len);
+		gtk_label_set_label (GTK_LABEL (priv->count), buf);
+		gtk_widget_set_visible (priv->count, TRUE);
+	} else {
+		if (gfu_common_shown_update (&priv->members_shown, NULL))
+			gtk_label_set_label (GTK_LABEL (priv->members), priv->members_shown);
+		gtk_widget_set_visible (priv->count, FALSE);
 	}
-	gtk_image_set_from_gicon (GTK_IMAGE (priv->image), icon, -1);
 }
 
-FwupdDevice *
-gfu_device_row_get_device (GfuDeviceRow *self)
+static void
+gfu_device_row_refresh_revealer (GfuDeviceRow *self)
 {
 	GfuDeviceRowPrivate *priv = gfu_device_row_get_instance_private (self);
-	g_return_val_if_fail (GFU_IS_DEVICE_ROW (self), NULL);
-	return priv->device;
+	gboolean selected = (gtk_widget_get_state_flags (GTK_WIDGET (self)) & GTK_STATE_FLAG_SELECTED) > 0;
+
+	/* the members are only listed for the selected row */
+	gtk_revealer_set_reveal_child (GTK_REVEALER (priv->revealer_members),
+				       selected && priv->group != NULL && priv->group->len > 1);
 }
 
 static gboolean
@@ -63,17 +130,55 @@ gfu_device_row_refresh_idle_cb (gpointer user_data)
 	return FALSE;
 }
 
-static void
-gfu_device_row_notify_props_changed_cb (FwupdDevice *device,
-				        GParamSpec *pspec,
-				        GfuDeviceRow *self)
+void
+gfu_device_row_invalidate (GfuDeviceRow *self)
 {
 	GfuDeviceRowPrivate *priv = gfu_device_row_get_instance_private (self);
+	g_return_if_fail (GFU_IS_DEVICE_ROW (self));
 	if (priv->pending_refresh_id > 0)
 		return;
 	priv->pending_refresh_id = g_idle_add (gfu_device_row_refresh_idle_cb, self);
 }
 
+void
+gfu_device_row_set_group (GfuDeviceRow *self, GPtrArray *group)
+{
+	GfuDeviceRowPrivate *priv = gfu_device_row_get_instance_private (self);
+	g_return_if_fail (GFU_IS_DEVICE_ROW (self));
+	if (priv->group == group)
+		return;
+	g_clear_pointer (&priv->group, g_ptr_array_unref);
+	if (group != NULL)
+		priv->group = g_ptr_array_ref (group);
+	gfu_device_row_refresh_revealer (self);
+	gfu_device_row_invalidate (self);
+}
+
+GPtrArray *
+gfu_device_row_get_group (GfuDeviceRow *self)
+{
+	GfuDeviceRowPrivate *priv = gfu_device_row_get_instance_private (self);
+	g_return_val_if_fail (GFU_IS_DEVICE_ROW (self), NULL);
+	return priv->group;
+}
+
+FwupdDevice *
+gfu_device_row_get_device (GfuDeviceRow *self)
+{
+	GfuDeviceRowPrivate *priv = gfu_device_row_get_instance_private (self);
+	g_return_val_if_fail (GFU_IS_DEVICE_ROW (self), NULL);
+	return priv->device;
+}
+
+static void
+gfu_device_row_notify_props_changed_cb (FwupdDevice *device,
+				        GParamSpec *pspec,
+				        GfuDeviceRow *self)
+{
+	/* many properties change at once, so only refresh when idle */
+	gfu_device_row_invalidate (self);
+}
+
 static void
 gfu_device_row_set_device (GfuDeviceRow *self, FwupdDevice *device)
 {
@@ -81,7 +186,7 @@ gfu_device_row_set_device (GfuDeviceRow *self, FwupdDevice *device)
 
 	priv->device = g_object_ref (device);
 
-	g_signal_connect_object (priv->device, "notify::state",
+	g_signal_connect_object (priv->device, "notify",
 				 G_CALLBACK (gfu_device_row_notify_props_changed_cb),
 				 self, 0);
 	gfu_device_row_refresh (self);
@@ -97,6 +202,11 @@ gfu_device_row_destroy (GtkWidget *object)
 		g_signal_handlers_disconnect_by_func (priv->device, gfu_device_row_notify_props_changed_cb, self);
 
 	g_clear_object (&priv->device);
+	g_clear_pointer (&priv->name_shown, g_free);
+	g_clear_pointer (&priv->summary_shown, g_free);
+	g_clear_pointer (&priv->members_shown, g_free);
+	g_clear_pointer (&priv->group, g_ptr_array_unref);
+	priv->icon_shown = NULL;
 	if (priv->pending_refresh_id != 0) {
 		g_source_remove (priv->pending_refresh_id);
 		priv->pending_refresh_id = 0;
@@ -105,15 +215,27 @@ gfu_device_row_destroy (GtkWidget *object)
 	GTK_WIDGET_CLASS (gfu_device_row_parent_class)->destroy (object);
 }
 
+static void
+gfu_device_row_state_flags_changed (GtkWidget *widget, GtkStateFlags flags_old)
+{
+	GfuDeviceRow *self = GFU_DEVICE_ROW (widget);
+	gfu_device_row_refresh_revealer (self);
+	GTK_WIDGET_CLASS (gfu_device_row_parent_class)->state_flags_changed (widget, flags_old);
+}
+
 static void
 gfu_device_row_class_init (GfuDeviceRowClass *klass)
 {
 	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 	widget_class->destroy = gfu_device_row_destroy;
+	widget_class->state_flags_changed = gfu_device_row_state_flags_changed;
 	gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/Firmware/gfu-device-row.ui");
 	gtk_widget_class_bind_template_child_private (widget_class, GfuDeviceRow, image);
 	gtk_widget_class_bind_template_child_private (widget_class, GfuDeviceRow, name);
 	gtk_widget_class_bind_template_child_private (widget_class, GfuDeviceRow, summary);
+	gtk_widget_class_bind_template_child_private (widget_class, GfuDeviceRow, count);
+	gtk_widget_class_bind_template_child_private (widget_class, GfuDeviceRow, members);
+	gtk_widget_class_bind_template_child_private (widget_class, GfuDeviceRow, revealer_members);
 }
 
 static void
@@ -22,5 +22,9 @@ struct _GfuDeviceRowClass
 
 GtkWidget	*gfu_device_row_new			(FwupdDevice	*device);
 FwupdDevice	*gfu_device_row_get_device		(GfuDeviceRow	*self);
+void		 gfu_device_row_invalidate		(GfuDeviceRow	*self);
+void		 gfu_device_row_set_group		(GfuDeviceRow	*self,
+							 GPtrArray	*group);
+GPtrArray	*gfu_device_row_get_group		(GfuDeviceRow	*self);
 
 G_END_DECLS
@@ -0,0 +1,617 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include "gfu-device-store.h"
+#include "gfu-stats.h"
+
+struct _GfuDeviceStore {
+	GObject		 parent_instance;
+	GListStore	*model;		/* of FwupdDevice */
+	GHashTable	*devices;	/* device-id : FwupdDevice */
+	GPtrArray	*pending;	/* of FwupdDevice, not yet in the model */
+	guint		 pending_id;
+	GHashTable	*groups;	/* device-id : GPtrArray of FwupdDevice */
+	gboolean	 groups_valid;
+};
+
+enum {
+	SIGNAL_DEVICE_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+G_DEFINE_TYPE (GfuDeviceStore, gfu_device_store, G_TYPE_OBJECT)
+
+GListModel *
+gfu_device_store_get_model (GfuDeviceStore *self)
+{
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+	return G_LIST_MODEL (self->model);
+}
+
+FwupdDevice *
+gfu_device_store_lookup (GfuDeviceStore *self, const gchar *device_id)
+{
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+	if (device_id == NULL)
+		return NULL;
+	return g_hash_table_lookup (self->devices, device_id);
+}
+
+gboolean
+gfu_device_store_find (GfuDeviceStore *self, const gchar *device_id, guint *position)
+{
+	FwupdDevice *device;
+	guint n_items;
+
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), FALSE);
+
+	/* not known, or still waiting to be added to the model */
+	device = gfu_device_store_lookup (self, device_id);
+	if (device == NULL)
+		return FALSE;
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
+	for (guint i = 0; i < n_items; i++) {
+		g_autoptr(FwupdDevice) device_tmp = g_list_model_get_item (G_LIST_MODEL (self->model), i);
+		if (device_tmp == device) {
+			if (position != NULL)
+				*position = i;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gint
+gfu_device_store_sort_str_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* devices with the same GUIDs on the same version can be updated together */
+static gchar *
+gfu_device_store_group_key (FwupdDevice *device)
+{
+	GPtrArray *guids = fwupd_device_get_guids (device);
+	GString *key;
+	g_autoptr(GPtrArray) sorted = NULL;
+
+	if (guids->len == 0 || fwupd_device_get_version (device) == NULL)
+		return g_strdup (fwupd_device_get_id (device));
+	sorted = g_ptr_array_sized_new (guids->len);
+	for (guint i = 0; i < guids->len; i++)
+		g_ptr_array_add (sorted, g_ptr_array_index (guids, i));
+	g_ptr_array_sort (sorted, gfu_device_store_sort_str_cb);
+	key = g_string_new (fwupd_device_get_version (device));
+	for (guint i = 0; i < sorted->len; i++) {
+		g_string_append_c (key, '|');
+		g_string_append (key, g_ptr_array_index (sorted, i));
+	}
+	return g_string_free (key, FALSE);
+}
+
+static gboolean
+gfu_device_store_group_equal (GPtrArray *group1, GPtrArray *group2)
+{
+	if (group1->len != group2->len)
+		return FALSE;
+	for (guint i = 0; i < group1->len; i++) {
+		if (g_ptr_array_index (group1, i) != g_ptr_array_index (group2, i))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+gfu_device_store_ensure_groups (GfuDeviceStore *self)
+{
+	GHashTableIter iter;
+	gpointer value;
+	guint n_items;
+	g_autoptr(GHashTable) groups_by_key = NULL;
+	g_autoptr(GHashTable) groups_old = NULL;
+
+	if (self->groups_valid)
+		return;
+	groups_old = g_steal_pointer (&self->groups);
+	self->groups = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      NULL, (GDestroyNotify) g_ptr_array_unref);
+	groups_by_key = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, (GDestroyNotify) g_ptr_array_unref);
+
+	/* the first device in the model leads the group */
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
+	for (guint i = 0; i < n_items; i++) {
+		g_autoptr(FwupdDevice) device = g_list_model_get_item (G_LIST_MODEL (self->model), i);
+		g_autofree gchar *key = gfu_device_store_group_key (device);
+		GPtrArray *group = g_hash_table_lookup (groups_by_key, key);
+		if (group == NULL) {
+			group = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			g_hash_table_insert (groups_by_key, g_steal_pointer (&key), group);
+		}
+		g_ptr_array_add (group, g_object_ref (device));
+	}
+
+	/* an unchanged group keeps its array, so rows can tell nothing moved */
+	g_hash_table_iter_init (&iter, groups_by_key);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GPtrArray *group = (GPtrArray *) value;
+		FwupdDevice *leader = g_ptr_array_index (group, 0);
+		GPtrArray *group_old = g_hash_table_lookup (groups_old, fwupd_device_get_id (leader));
+		if (group_old != NULL && gfu_device_store_group_equal (group, group_old))
+			group = group_old;
+		for (guint i = 0; i < group->len; i++) {
+			FwupdDevice *device = g_ptr_array_index (group, i);
+			g_hash_table_insert (self->groups,
+					     (gpointer) fwupd_device_get_id (device),
+					     g_ptr_array_ref (group));
+		}
+	}
+	self->groups_valid = TRUE;
+}
+
+gboolean
+gfu_device_store_get_groups_valid (GfuDeviceStore *self)
+{
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), FALSE);
+	return self->groups_valid;
+}
+
+GPtrArray *
+gfu_device_store_get_group (GfuDeviceStore *self, FwupdDevice *device)
+{
+	GPtrArray *group;
+
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	gfu_device_store_ensure_groups (self);
+	group = g_hash_table_lookup (self->groups, fwupd_device_get_id (device));
+	if (group == NULL) {
+		group = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		g_ptr_array_add (group, g_object_ref (device));
+		return group;
+	}
+	return g_ptr_array_ref (group);
+}
+
+gboolean
+gfu_device_store_is_group_leader (GfuDeviceStore *self, FwupdDevice *device)
+{
+	GPtrArray *group;
+
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), FALSE);
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), FALSE);
+
+	gfu_device_store_ensure_groups (self);
+	group = g_hash_table_lookup (self->groups, fwupd_device_get_id (device));
+	return group == NULL || g_ptr_array_index (group, 0) == device;
+}
+
+FwupdDevice *
+gfu_device_store_get_parent (GfuDeviceStore *self, FwupdDevice *device)
+{
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	/* the parent object is not sent over D-Bus, only the ID */
+	return gfu_device_store_lookup (self, fwupd_device_get_parent_id (device));
+}
+
+/* deep enough for any real composite device, and stops loops */
+#define GFU_DEVICE_STORE_DEPTH_MAX	16
+
+static gboolean
+gfu_device_store_install_parent_first (FwupdDevice *parent, FwupdDevice *child)
+{
+	return fwupd_device_has_flag (parent, FWUPD_DEVICE_FLAG_INSTALL_PARENT_FIRST) ||
+	       fwupd_device_has_flag (child, FWUPD_DEVICE_FLAG_INSTALL_PARENT_FIRST);
+}
+
+FwupdDevice *
+gfu_device_store_get_ancestor (GfuDeviceStore *self, FwupdDevice *device, GPtrArray *devices)
+{
+	FwupdDevice *parent = device;
+
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	for (guint depth = 0; depth < GFU_DEVICE_STORE_DEPTH_MAX; depth++) {
+		parent = gfu_device_store_get_parent (self, parent);
+		if (parent == NULL)
+			return NULL;
+		for (guint i = 0; i < devices->len; i++) {
+			FwupdDevice *device_tmp = g_ptr_array_index (devices, i);
+			if (g_strcmp0 (fwupd_device_get_id (device_tmp),
+				       fwupd_device_get_id (parent)) == 0)
+				return device_tmp;
+		}
+	}
+	return NULL;
+}
+
+typedef struct {
+	guint	 first;
+	guint	 then;
+} GfuDeviceStoreEdge;
+
+GPtrArray *
+gfu_device_store_get_install_order (GfuDeviceStore *self, GPtrArray *devices)
+{
+	GPtrArray *order;
+	g_autofree guint *blocked = g_new0 (guint, devices->len);
+	g_autofree gboolean *done = g_new0 (gboolean, devices->len);
+	g_autoptr(GArray) edges = g_array_new (FALSE, FALSE, sizeof (GfuDeviceStoreEdge));
+
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+
+	/* link each device to its closest ancestor that is also updated */
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *device = g_ptr_array_index (devices, i);
+		FwupdDevice *ancestor = gfu_device_store_get_ancestor (self, device, devices);
+		if (ancestor == NULL)
+			continue;
+		for (guint j = 0; j < devices->len; j++) {
+			GfuDeviceStoreEdge edge;
+			if (g_ptr_array_index (devices, j) != ancestor)
+				continue;
+			if (gfu_device_store_install_parent_first (ancestor, device)) {
+				edge.first = j;
+				edge.then = i;
+			} else {
+				/* composite updates normally do the children first */
+				edge.first = i;
+				edge.then = j;
+			}
+			g_array_append_val (edges, edge);
+			blocked[edge.then]++;
+			break;
+		}
+	}
+
+	/* stable topological sort: the first unblocked device in the
+	 * original order is always the next to go */
+	order = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	while (order->len < devices->len) {
+		gboolean progress = FALSE;
+		for (guint i = 0; i < devices->len; i++) {
+			if (done[i] || blocked[i] > 0)
+				continue;
+			done[i] = TRUE;
+			progress = TRUE;
+			g_ptr_array_add (order, g_object_ref (g_ptr_array_index (devices, i)));
+
+			/* unblock anything that was waiting for this device */
+			for (guint j = 0; j < edges->len; j++) {
+				GfuDeviceStoreEdge *edge = &g_array_index (edges, GfuDeviceStoreEdge, j);
+				if (edge->first == i)
+					blocked[edge->then]--;
+			}
+			break;
+		}
+
+		/* a parent loop, so keep the order the daemon gave */
+		if (!progress) {
+			g_debug ("device parents form a loop, ignoring order");
+			for (guint i = 0; i < devices->len; i++) {
+				if (!done[i])
+					g_ptr_array_add (order, g_object_ref (g_ptr_array_index (devices, i)));
+			}
+			break;
+		}
+	}
+	return order;
+}
+
+static gboolean
+gfu_device_store_strv_update (GPtrArray *dst, GPtrArray *src)
+{
+	gboolean same = dst->len == src->len;
+
+	for (guint i = 0; same && i < src->len; i++) {
+		if (g_strcmp0 (g_ptr_array_index (dst, i), g_ptr_array_index (src, i)) != 0)
+			same = FALSE;
+	}
+	if (same)
+		return FALSE;
+
+	/* libfwupd only allows adding, so the owned array is replaced here */
+	g_ptr_array_set_size (dst, 0);
+	for (guint i = 0; i < src->len; i++)
+		g_ptr_array_add (dst, g_strdup (g_ptr_array_index (src, i)));
+	return TRUE;
+}
+
+/* copies the property from the donor if it differs */
+#define GFU_DEVICE_STORE_SYNC_STR(prop) \
+	if (g_strcmp0 (fwupd_device_get_##prop (device), fwupd_device_get_##prop (donor)) != 0) { \
+		fwupd_device_set_##prop (device, fwupd_device_get_##prop (donor)); \
+		changed = TRUE; \
+	}
+#define GFU_DEVICE_STORE_SYNC_INT(prop) \
+	if (fwupd_device_get_##prop (device) != fwupd_device_get_##prop (donor)) { \
+		fwupd_device_set_##prop (device, fwupd_device_get_##prop (donor)); \
+		changed = TRUE; \
+	}
+
+/* returns TRUE if anything differed, and sets @regroup if the group may have */
+static gboolean
+gfu_device_store_incorporate (FwupdDevice *device, FwupdDevice *donor, gboolean *regroup)
+{
+	gboolean changed = FALSE;
+
+	GFU_DEVICE_STORE_SYNC_STR (name);
+	GFU_DEVICE_STORE_SYNC_STR (summary);
+	GFU_DEVICE_STORE_SYNC_STR (description);
+	GFU_DEVICE_STORE_SYNC_STR (vendor);
+	GFU_DEVICE_STORE_SYNC_STR (vendor_id);
+	GFU_DEVICE_STORE_SYNC_STR (serial);
+	GFU_DEVICE_STORE_SYNC_STR (version_lowest);
+	GFU_DEVICE_STORE_SYNC_STR (version_bootloader);
+	GFU_DEVICE_STORE_SYNC_INT (flags);
+	GFU_DEVICE_STORE_SYNC_INT (flashes_left);
+	GFU_DEVICE_STORE_SYNC_INT (install_duration);
+	GFU_DEVICE_STORE_SYNC_INT (update_state);
+	GFU_DEVICE_STORE_SYNC_STR (update_error);
+	if (gfu_device_store_strv_update (fwupd_device_get_icons (device),
+					  fwupd_device_get_icons (donor)))
+		changed = TRUE;
+	if (gfu_device_store_strv_update (fwupd_device_get_checksums (device),
+					  fwupd_device_get_checksums (donor)))
+		changed = TRUE;
+
+	/* the group key */
+	if (g_strcmp0 (fwupd_device_get_version (device), fwupd_device_get_version (donor)) != 0) {
+		fwupd_device_set_version (device, fwupd_device_get_version (donor));
+		*regroup = TRUE;
+	}
+	if (gfu_device_store_strv_update (fwupd_device_get_guids (device),
+					  fwupd_device_get_guids (donor)))
+		*regroup = TRUE;
+	return changed || *regroup;
+}
+
+FwupdDevice *
+gfu_device_store_update (GfuDeviceStore *self, FwupdDevice *device)
+{
+	FwupdDevice *device_old;
+	gboolean regroup = FALSE;
+
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	device_old = gfu_device_store_lookup (self, fwupd_device_get_id (device));
+	if (device_old == NULL)
+		return NULL;
+	if (device_old == device)
+		return device_old;
+
+	/* the same properties are sent again for most signals */
+	if (!gfu_device_store_incorporate (device_old, device, &regroup))
+		return device_old;
+	if (regroup)
+		self->groups_valid = FALSE;
+	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device_old);
+	return device_old;
+}
+
+static void
+gfu_device_store_pending_stop (GfuDeviceStore *self)
+{
+	if (self->pending_id != 0) {
+		g_source_remove (self->pending_id);
+		self->pending_id = 0;
+	}
+}
+
+static gboolean
+gfu_device_store_pending_cb (gpointer user_data)
+{
+	GfuDeviceStore *self = GFU_DEVICE_STORE (user_data);
+	guint n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
+
+	self->pending_id = 0;
+	g_debug ("adding %u queued devices", self->pending->len);
+	g_list_store_splice (self->model, n_items, 0,
+			     self->pending->pdata,
+			     self->pending->len);
+	g_ptr_array_set_size (self->pending, 0);
+	return FALSE;
+}
+
+FwupdDevice *
+gfu_device_store_add (GfuDeviceStore *self, FwupdDevice *device)
+{
+	FwupdDevice *device_old;
+
+	g_return_val_if_fail (GFU_IS_DEVICE_STORE (self), NULL);
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	/* already known, so just refresh the object everyone shares */
+	device_old = gfu_device_store_update (self, device);
+	if (device_old != NULL) {
+		gfu_stats_inc (GFU_STATS_COUNTER_SIGNALS_COALESCED);
+		return device_old;
+	}
+	if (fwupd_device_get_id (device) == NULL) {
+		g_debug ("ignoring device %s with no ID", fwupd_device_get_name (device));
+		return NULL;
+	}
+	g_hash_table_insert (self->devices,
+			     (gpointer) fwupd_device_get_id (device),
+			     g_object_ref (device));
+
+	/* a replug storm is added to the model in one go */
+	g_ptr_array_add (self->pending, g_object_ref (device));
+	if (self->pending_id == 0)
+		self->pending_id = g_idle_add (gfu_device_store_pending_cb, self);
+	else
+		gfu_stats_inc (GFU_STATS_COUNTER_SIGNALS_COALESCED);
+	return device;
+}
+
+void
+gfu_device_store_remove (GfuDeviceStore *self, const gchar *device_id)
+{
+	FwupdDevice *device;
+	guint position = 0;
+
+	g_return_if_fail (GFU_IS_DEVICE_STORE (self));
+
+	device = gfu_device_store_lookup (self, device_id);
+	if (device == NULL)
+		return;
+
+	/* still waiting to be added */
+	if (g_ptr_array_remove (self->pending, device)) {
+		gfu_stats_inc (GFU_STATS_COUNTER_SIGNALS_COALESCED);
+		g_hash_table_remove (self->devices, device_id);
+		return;
+	}
+	if (gfu_device_store_find (self, device_id, &position))
+		g_list_store_remove (self->model, position);
+	g_hash_table_remove (self->devices, device_id);
+}
+
+static gboolean
+gfu_device_store_remove_unkept_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	GHashTable *keep = (GHashTable *) user_data;
+	return !g_hash_table_contains (keep, key);
+}
+
+void
+gfu_device_store_set_devices (GfuDeviceStore *self, GPtrArray *devices)
+{
+	guint n_items;
+	guint n_removed = 0;
+	g_autoptr(GHashTable) keep = g_hash_table_new (g_str_hash, g_str_equal);
+	g_autoptr(GPtrArray) added = g_ptr_array_new ();
+
+	g_return_if_fail (GFU_IS_DEVICE_STORE (self));
+
+	/* devices that still exist keep their object, and so their row */
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *device = g_ptr_array_index (devices, i);
+		FwupdDevice *device_old = gfu_device_store_update (self, device);
+		if (device_old != NULL) {
+			g_hash_table_add (keep, (gpointer) fwupd_device_get_id (device_old));
+			continue;
+		}
+		if (fwupd_device_get_id (device) == NULL)
+			continue;
+		g_hash_table_insert (self->devices,
+				     (gpointer) fwupd_device_get_id (device),
+				     g_object_ref (device));
+		g_hash_table_add (keep, (gpointer) fwupd_device_get_id (device));
+		g_ptr_array_add (added, device);
+	}
+
+	/* anything queued is added with the new devices, or dropped */
+	gfu_device_store_pending_stop (self);
+	for (guint i = 0; i < self->pending->len; i++) {
+		FwupdDevice *device = g_ptr_array_index (self->pending, i);
+		if (g_hash_table_contains (keep, fwupd_device_get_id (device)))
+			g_ptr_array_add (added, device);
+	}
+
+	/* remove from the end so that the positions stay valid, with one
+	 * items-changed emission for each run of vanished devices */
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
+	for (guint i = n_items; i > 0; i--) {
+		g_autoptr(FwupdDevice) device = g_list_model_get_item (G_LIST_MODEL (self->model), i - 1);
+		if (!g_hash_table_contains (keep, fwupd_device_get_id (device))) {
+			n_removed++;
+			continue;
+		}
+		if (n_removed > 0) {
+			g_list_store_splice (self->model, i, n_removed, NULL, 0);
+			n_removed = 0;
+		}
+	}
+	if (n_removed > 0)
+		g_list_store_splice (self->model, 0, n_removed, NULL, 0);
+
+	/* one items-changed emission for all the new devices */
+	if (added->len > 0) {
+		n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
+		g_list_store_splice (self->model, n_items, 0, added->pdata, added->len);
+	}
+	g_ptr_array_set_size (self->pending, 0);
+	g_hash_table_foreach_remove (self->devices, gfu_device_store_remove_unkept_cb, keep);
+}
+
+void
+gfu_device_store_clear (GfuDeviceStore *self)
+{
+	g_return_if_fail (GFU_IS_DEVICE_STORE (self));
+	gfu_device_store_pending_stop (self);
+	g_ptr_array_set_size (self->pending, 0);
+	g_list_store_remove_all (self->model);
+	g_hash_table_remove_all (self->devices);
+	g_hash_table_remove_all (self->groups);
+}
+
+static void
+gfu_device_store_finalize (GObject *object)
+{
+	GfuDeviceStore *self = GFU_DEVICE_STORE (object);
+
+	gfu_device_store_pending_stop (self);
+	g_ptr_array_unref (self->pending);
+	g_object_unref (self->model);
+	g_hash_table_unref (self->devices);
+	g_hash_table_unref (self->groups);
+
+	G_OBJECT_CLASS (gfu_device_store_parent_class)->finalize (object);
+}
+
+static void
+gfu_device_store_class_init (GfuDeviceStoreClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gfu_device_store_finalize;
+
+	signals[SIGNAL_DEVICE_CHANGED] =
+		g_signal_new ("device-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__OBJECT,
+			      G_TYPE_NONE, 1, FWUPD_TYPE_DEVICE);
+}
+
+static void
+gfu_device_store_model_changed_cb (GListModel *model,
+				   guint position,
+				   guint removed,
+				   guint added,
+				   GfuDeviceStore *self)
+{
+	self->groups_valid = FALSE;
+}
+
+static void
+gfu_device_store_init (GfuDeviceStore *self)
+{
+	self->model = g_list_store_new (FWUPD_TYPE_DEVICE);
+	self->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       NULL, (GDestroyNotify) g_object_unref);
+	self->pending = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->groups = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      NULL, (GDestroyNotify) g_ptr_array_unref);
+
+	/* connected first, so anyone else listening sees the new groups */
+	g_signal_connect (self->model, "items-changed",
+			  G_CALLBACK (gfu_device_store_model_changed_cb), self);
+}
+
+GfuDeviceStore *
+gfu_device_store_new (void)
+{
+	return g_object_new (GFU_TYPE_DEVICE_STORE, NULL);
+}
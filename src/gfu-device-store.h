@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <fwupd.h>
+
+G_BEGIN_DECLS
+
+#define GFU_TYPE_DEVICE_STORE (gfu_device_store_get_type ())
+
+G_DECLARE_FINAL_TYPE (GfuDeviceStore, gfu_device_store, GFU, DEVICE_STORE, GObject)
+
+GfuDeviceStore	*gfu_device_store_new			(void);
+GListModel	*gfu_device_store_get_model		(GfuDeviceStore	*self);
+FwupdDevice	*gfu_device_store_lookup		(GfuDeviceStore	*self,
+							 const gchar	*device_id);
+gboolean	 gfu_device_store_find			(GfuDeviceStore	*self,
+							 const gchar	*device_id,
+							 guint		*position);
+FwupdDevice	*gfu_device_store_add			(GfuDeviceStore	*self,
+							 FwupdDevice	*device);
+FwupdDevice	*gfu_device_store_update		(GfuDeviceStore	*self,
+							 FwupdDevice	*device);
+void		 gfu_device_store_remove		(GfuDeviceStore	*self,
+							 const gchar	*device_id);
+void		 gfu_device_store_set_devices		(GfuDeviceStore	*self,
+							 GPtrArray	*devices);
+void		 gfu_device_store_clear			(GfuDeviceStore	*self);
+GPtrArray	*gfu_device_store_get_group		(GfuDeviceStore	*self,
+							 FwupdDevice	*device);
+gboolean	 gfu_device_store_is_group_leader	(GfuDeviceStore	*self,
+							 FwupdDevice	*device);
+gboolean	 gfu_device_store_get_groups_valid	(GfuDeviceStore	*self);
+FwupdDevice	*gfu_device_store_get_parent		(GfuDeviceStore	*self,
+							 FwupdDevice	*device);
+FwupdDevice	*gfu_device_store_get_ancestor		(GfuDeviceStore	*self,
+							 FwupdDevice	*device,
+							 GPtrArray	*devices);
+GPtrArray	*gfu_device_store_get_install_order	(GfuDeviceStore	*self,
+							 GPtrArray	*devices);
+
+G_END_DECLS
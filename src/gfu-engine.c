@@ -0,0 +1,619 @@
+/*
+ * Copyright (C) 2019 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include "gfu-common.h"
+#include "gfu-engine.h"
+#include "gfu-stats.h"
+#include "gfu-trace.h"
+
+/* smaller files, like signatures, only measure the round trip */
+#define GFU_ENGINE_THROUGHPUT_MIN_SIZE	(64 * 1024)
+
+struct _GfuEngine {
+	GObject		 parent_instance;
+	FwupdClient	*client;
+	SoupSession	*soup_session;	/* created on first download */
+	GHashTable	*prefetched;	/* filenames downloaded ahead of the install */
+};
+
+enum {
+	SIGNAL_STATUS_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+G_DEFINE_TYPE (GfuEngine, gfu_engine, G_TYPE_OBJECT)
+
+/* the text is translated and only meant for showing to the user */
+static void
+gfu_engine_set_status (GfuEngine *self, const gchar *text)
+{
+	g_signal_emit (self, signals[SIGNAL_STATUS_CHANGED], 0, text);
+}
+
+FwupdClient *
+gfu_engine_get_client (GfuEngine *self)
+{
+	g_return_val_if_fail (GFU_IS_ENGINE (self), NULL);
+	return self->client;
+}
+
+SoupSession *
+gfu_engine_get_soup_session (GfuEngine *self, GError **error)
+{
+	g_return_val_if_fail (GFU_IS_ENGINE (self), NULL);
+	if (self->soup_session == NULL)
+		self->soup_session = gfu_common_setup_networking (error);
+	return self->soup_session;
+}
+
+/* queued downloads finish with SOUP_STATUS_CANCELLED before this returns */
+void
+gfu_engine_abort (GfuEngine *self)
+{
+	g_return_if_fail (GFU_IS_ENGINE (self));
+	if (self->soup_session != NULL)
+		soup_session_abort (self->soup_session);
+}
+
+/* the download was for the install, so finding it later saves nothing */
+void
+gfu_engine_add_prefetched (GfuEngine *self, const gchar *fn)
+{
+	g_return_if_fail (GFU_IS_ENGINE (self));
+	g_return_if_fail (fn != NULL);
+	g_hash_table_add (self->prefetched, g_strdup (fn));
+}
+
+static void
+gfu_engine_download_chunk_cb (SoupMessage *msg, SoupBuffer *chunk, gpointer user_data)
+{
+	guint percentage;
+	goffset header_size;
+	goffset body_length;
+	g_autofree gchar *status = NULL;
+	GfuEngine *self = GFU_ENGINE (user_data);
+
+	/* if it's returning "Found" or an error, ignore the percentage */
+	if (msg->status_code != SOUP_STATUS_OK) {
+		g_debug ("ignoring status code %u (%s)",
+			 msg->status_code, msg->reason_phrase);
+		return;
+	}
+
+	/* get data */
+	body_length = msg->response_body->length;
+	header_size = soup_message_headers_get_content_length (msg->response_headers);
+
+	/* size is not known */
+	if (header_size < body_length)
+		return;
+
+	/* calculate percentage */
+	gfu_trace_counter ("download-bytes", body_length);
+	percentage = (guint) ((100 * body_length) / header_size);
+	g_debug ("progress: %u%%", percentage);
+	status = g_strdup_printf ("%s (%u%%)", _("Downloading"), percentage);
+	gfu_engine_set_status (self, status);
+}
+
+/* checks the reply, verifies the checksum and saves the payload */
+gboolean
+gfu_engine_download_check (SoupMessage *msg,
+			   const gchar *uri_str,
+			   const gchar *fn,
+			   const gchar *checksum_expected,
+			   GError **error)
+{
+	GChecksumType checksum_type = fwupd_checksum_guess_kind (checksum_expected);
+	guint status_code = msg->status_code;
+	g_autoptr(GError) error_local = NULL;
+	g_autofree gchar *checksum_actual = NULL;
+
+	if (status_code == 429) {
+		g_autofree gchar *str = g_strndup (msg->response_body->data,
+						   msg->response_body->length);
+		if (g_strcmp0 (str, "Too Many Requests") == 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     /* TRANSLATORS: the server is rate-limiting downloads */
+				     "%s", _("Failed to download due to server limit"));
+			return FALSE;
+		}
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     _("Failed to download due to server limit: %s"), str);
+		return FALSE;
+	}
+	if (status_code != SOUP_STATUS_OK) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     _("Failed to download %s: %s"),
+			     uri_str, soup_status_get_phrase (status_code));
+		return FALSE;
+	}
+
+	/* verify checksum */
+	if (checksum_expected != NULL) {
+		g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("engine", "checksum");
+		checksum_actual = g_compute_checksum_for_data (checksum_type,
+							       (guchar *) msg->response_body->data,
+							       (gsize) msg->response_body->length);
+		if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     _("Checksum invalid, expected %s got %s"),
+				     checksum_expected, checksum_actual);
+			return FALSE;
+		}
+	}
+
+	/* save file */
+	if (!g_file_set_contents (fn,
+				  msg->response_body->data,
+				  msg->response_body->length,
+				  &error_local)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     _("Failed to save file: %s"),
+			     error_local->message);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* the connection phases of each download, only used when tracing */
+typedef struct {
+	GfuTraceSpan		*resolve;
+	GfuTraceSpan		*connect;
+	GfuTraceSpan		*tls;
+	GfuTraceSpan		*transfer;	/* once the request is sent */
+} GfuEngineNetworkSpans;
+
+static void
+gfu_engine_network_spans_free (GfuEngineNetworkSpans *spans)
+{
+	gfu_trace_span_end (spans->resolve);
+	gfu_trace_span_end (spans->connect);
+	gfu_trace_span_end (spans->tls);
+	gfu_trace_span_end (spans->transfer);
+	g_free (spans);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuEngineNetworkSpans, gfu_engine_network_spans_free)
+
+static void
+gfu_engine_network_event_cb (SoupMessage *msg,
+			     GSocketClientEvent event,
+			     GIOStream *connection,
+			     gpointer user_data)
+{
+	GfuEngineNetworkSpans *spans = (GfuEngineNetworkSpans *) user_data;
+	switch (event) {
+	case G_SOCKET_CLIENT_RESOLVING:
+		spans->resolve = gfu_trace_span_begin ("network", "dns");
+		break;
+	case G_SOCKET_CLIENT_RESOLVED:
+		g_clear_pointer (&spans->resolve, gfu_trace_span_end);
+		break;
+	case G_SOCKET_CLIENT_CONNECTING:
+		spans->connect = gfu_trace_span_begin ("network", "connect");
+		break;
+	case G_SOCKET_CLIENT_CONNECTED:
+		g_clear_pointer (&spans->connect, gfu_trace_span_end);
+		break;
+	case G_SOCKET_CLIENT_TLS_HANDSHAKING:
+		spans->tls = gfu_trace_span_begin ("network", "tls");
+		break;
+	case G_SOCKET_CLIENT_TLS_HANDSHAKED:
+		g_clear_pointer (&spans->tls, gfu_trace_span_end);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+gfu_engine_network_wrote_body_cb (SoupMessage *msg, gpointer user_data)
+{
+	GfuEngineNetworkSpans *spans = (GfuEngineNetworkSpans *) user_data;
+
+	/* a redirect sends the request again */
+	gfu_trace_span_end (spans->transfer);
+	spans->transfer = gfu_trace_span_begin ("network", "transfer");
+}
+
+static void
+gfu_engine_network_finished_cb (SoupMessage *msg, gpointer user_data)
+{
+	GfuEngineNetworkSpans *spans = (GfuEngineNetworkSpans *) user_data;
+	g_clear_pointer (&spans->transfer, gfu_trace_span_end);
+}
+
+/* the timings of each download for the diagnostics, freed with the message */
+typedef struct {
+	gint64			 start;
+	gboolean		 got_headers;
+} GfuEngineDownloadStats;
+
+static void
+gfu_engine_download_got_headers_cb (SoupMessage *msg, gpointer user_data)
+{
+	GfuEngineDownloadStats *stats = (GfuEngineDownloadStats *) user_data;
+
+	/* redirects also emit this, but the first response is what was waited for */
+	if (stats->got_headers)
+		return;
+	stats->got_headers = TRUE;
+	gfu_stats_add_sample (GFU_STATS_HISTOGRAM_FIRST_BYTE,
+			      (g_get_monotonic_time () - stats->start) / 1000);
+}
+
+static void
+gfu_engine_download_finished_cb (SoupMessage *msg, gpointer user_data)
+{
+	GfuEngineDownloadStats *stats = (GfuEngineDownloadStats *) user_data;
+	gint64 elapsed = g_get_monotonic_time () - stats->start;
+	guint64 length;
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code))
+		return;
+	length = (guint64) msg->response_body->length;
+	gfu_stats_add (GFU_STATS_COUNTER_BYTES_DOWNLOADED, length);
+	if (length < GFU_ENGINE_THROUGHPUT_MIN_SIZE || elapsed <= 0)
+		return;
+	gfu_stats_add_sample (GFU_STATS_HISTOGRAM_THROUGHPUT,
+			      (length * G_USEC_PER_SEC / 1024) / (guint64) elapsed);
+}
+
+/* call just before the message is sent or queued */
+void
+gfu_engine_download_watch (SoupMessage *msg)
+{
+	GfuEngineDownloadStats *stats = g_new0 (GfuEngineDownloadStats, 1);
+
+	g_return_if_fail (SOUP_IS_MESSAGE (msg));
+
+	stats->start = g_get_monotonic_time ();
+	g_object_set_data_full (G_OBJECT (msg), "GfuEngineDownloadStats", stats, g_free);
+	g_signal_connect (msg, "got-headers",
+			  G_CALLBACK (gfu_engine_download_got_headers_cb), stats);
+	g_signal_connect (msg, "finished",
+			  G_CALLBACK (gfu_engine_download_finished_cb), stats);
+}
+
+gboolean
+gfu_engine_download_file (GfuEngine *self,
+			  SoupURI *uri,
+			  const gchar *fn,
+			  const gchar *checksum_expected,
+			  GError **error)
+{
+	GChecksumType checksum_type;
+	SoupSession *soup_session;
+	g_autofree gchar *uri_str = NULL;
+	g_autoptr(GfuEngineNetworkSpans) spans = NULL;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("engine", "download");
+	g_autoptr(SoupMessage) msg = NULL;
+
+	g_return_val_if_fail (GFU_IS_ENGINE (self), FALSE);
+
+	/* check if the file already exists with the right checksum, which is the
+	 * only place the download cache is counted */
+	if (checksum_expected != NULL) {
+		checksum_type = fwupd_checksum_guess_kind (checksum_expected);
+		if (gfu_common_file_exists_with_checksum (fn, checksum_expected, checksum_type)) {
+			GStatBuf stat_buf;
+			if (g_hash_table_remove (self->prefetched, fn)) {
+				gfu_stats_inc (GFU_STATS_COUNTER_CACHE_MISSES);
+			} else {
+				gfu_stats_inc (GFU_STATS_COUNTER_CACHE_HITS);
+				if (g_stat (fn, &stat_buf) == 0)
+					gfu_stats_add (GFU_STATS_COUNTER_BYTES_SAVED, stat_buf.st_size);
+			}
+			g_debug ("skipping download as file already exists");
+			gfu_trace_instant ("engine", "cache-hit");
+			gfu_engine_set_status (self, _("File already downloaded..."));
+			return TRUE;
+		}
+		gfu_stats_inc (GFU_STATS_COUNTER_CACHE_MISSES);
+	}
+
+	/* set up networking */
+	soup_session = gfu_engine_get_soup_session (self, error);
+	if (soup_session == NULL)
+		return FALSE;
+
+	/* download data */
+	uri_str = soup_uri_to_string (uri, FALSE);
+	gfu_trace_span_add_arg (span, "uri", uri_str);
+	g_debug ("downloading %s to %s", uri_str, fn);
+	gfu_engine_set_status (self, _("Downloading file..."));
+	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
+	if (msg == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "Failed to parse URI %s", uri_str);
+		return FALSE;
+	}
+	if (g_str_has_suffix (uri_str, ".asc") ||
+	    g_str_has_suffix (uri_str, ".p7b") ||
+	    g_str_has_suffix (uri_str, ".p7c")) {
+		/* TRANSLATORS: downloading new signing file */
+		g_debug ("%s %s\n", _("Fetching signature"), uri_str);
+		gfu_engine_set_status (self, _("Fetching signature..."));
+	} else if (g_str_has_suffix (uri_str, ".gz")) {
+		/* TRANSLATORS: downloading new metadata file */
+		g_debug ("%s %s\n", _("Fetching metadata"), uri_str);
+		gfu_engine_set_status (self, _("Fetching metadata..."));
+	} else if (g_str_has_suffix (uri_str, ".cab")) {
+		/* TRANSLATORS: downloading new firmware file */
+		g_debug ("%s %s\n", _("Fetching firmware"), uri_str);
+		gfu_engine_set_status (self, _("Fetching firmware..."));
+	} else {
+		/* TRANSLATORS: downloading unknown file */
+		g_debug ("%s %s\n", _("Fetching file"), uri_str);
+		gfu_engine_set_status (self, _("Fetching file..."));
+	}
+	g_signal_connect (msg, "got-chunk",
+			  G_CALLBACK (gfu_engine_download_chunk_cb), self);
+	if (gfu_trace_enabled) {
+		spans = g_new0 (GfuEngineNetworkSpans, 1);
+		g_signal_connect (msg, "network-event",
+				  G_CALLBACK (gfu_engine_network_event_cb), spans);
+		g_signal_connect (msg, "wrote-body",
+				  G_CALLBACK (gfu_engine_network_wrote_body_cb), spans);
+		g_signal_connect (msg, "finished",
+				  G_CALLBACK (gfu_engine_network_finished_cb), spans);
+	}
+	gfu_engine_download_watch (msg);
+	soup_session_send_message (soup_session, msg);
+	g_debug ("\n");
+	return gfu_engine_download_check (msg, uri_str, fn, checksum_expected, error);
+}
+
+/* a plausible local filename for a file the daemon keeps for the remote */
+gchar *
+gfu_engine_remote_cache_path (FwupdRemote *remote, const gchar *fn_daemon)
+{
+	g_autofree gchar *basename = g_path_get_basename (fn_daemon);
+	g_autofree gchar *basename_id = g_strdup_printf ("%s-%s", fwupd_remote_get_id (remote), basename);
+	return gfu_get_user_cache_path (basename_id);
+}
+
+gboolean
+gfu_engine_refresh_remote (GfuEngine *self, FwupdRemote *remote, GError **error)
+{
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *filename_asc = NULL;
+	g_autoptr(SoupURI) uri = NULL;
+	g_autoptr(SoupURI) uri_sig = NULL;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("engine", "refresh-remote");
+	g_autoptr(GfuTraceSpan) span_update = NULL;
+
+	g_return_val_if_fail (GFU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (FWUPD_IS_REMOTE (remote), FALSE);
+
+	gfu_trace_span_add_arg (span, "remote", fwupd_remote_get_id (remote));
+
+	/* download the metadata */
+	filename = gfu_engine_remote_cache_path (remote, fwupd_remote_get_filename_cache (remote));
+	gfu_engine_set_status (self, _("Creating cache path..."));
+	if (!gfu_common_mkdir_parent (filename, error))
+		return FALSE;
+	uri = soup_uri_new (fwupd_remote_get_metadata_uri (remote));
+	gfu_engine_set_status (self, _("Preparing to download file..."));
+	if (!gfu_engine_download_file (self, uri, filename, NULL, error))
+		return FALSE;
+
+	/* download the signature */
+	filename_asc = gfu_engine_remote_cache_path (remote, fwupd_remote_get_filename_cache_sig (remote));
+	uri_sig = soup_uri_new (fwupd_remote_get_metadata_uri_sig (remote));
+	gfu_engine_set_status (self, _("Preparing to download file..."));
+	if (!gfu_engine_download_file (self, uri_sig, filename_asc, NULL, error))
+		return FALSE;
+
+	/* send all this to fwupd */
+	span_update = gfu_trace_span_begin ("engine", "update-metadata");
+	return fwupd_client_update_metadata (self->client,
+					     fwupd_remote_get_id (remote),
+					     filename,
+					     filename_asc,
+					     NULL, error);
+}
+
+gboolean
+gfu_engine_refresh_metadata (GfuEngine *self, guint64 max_age, GError **error)
+{
+	g_autoptr(GPtrArray) remotes = NULL;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("engine", "metadata-refresh");
+
+	g_return_val_if_fail (GFU_IS_ENGINE (self), FALSE);
+
+	remotes = fwupd_client_get_remotes (self->client, NULL, error);
+	if (remotes == NULL)
+		return FALSE;
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		if (!fwupd_remote_get_enabled (remote))
+			continue;
+		if (fwupd_remote_get_kind (remote) != FWUPD_REMOTE_KIND_DOWNLOAD)
+			continue;
+
+		/* still fresh enough */
+		if (max_age > 0 && fwupd_remote_get_age (remote) < max_age) {
+			g_debug ("%s is recent enough", fwupd_remote_get_id (remote));
+			continue;
+		}
+		if (!gfu_engine_refresh_remote (self, remote, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* works out where the payload is, and the URI if it has to be downloaded */
+gboolean
+gfu_engine_release_resolve (GfuEngine *self,
+			    FwupdRelease *rel,
+			    gchar **fn,
+			    gchar **uri,
+			    GError **error)
+{
+	const gchar *remote_id;
+	const gchar *uri_tmp;
+	g_autofree gchar *uri_str = NULL;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("engine", "remote-lookup");
+
+	/* work out what remote-specific URI fields this should use */
+	uri_tmp = fwupd_release_get_uri (rel);
+	remote_id = fwupd_release_get_remote_id (rel);
+	if (remote_id != NULL) {
+		g_autoptr(FwupdRemote) remote = NULL;
+		remote = fwupd_client_get_remote_by_id (self->client,
+							remote_id,
+							NULL,
+							error);
+		if (remote == NULL)
+			return FALSE;
+
+		/* local and directory remotes have the firmware already */
+		if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_LOCAL) {
+			const gchar *fn_cache = fwupd_remote_get_filename_cache (remote);
+			g_autofree gchar *path = g_path_get_dirname (fn_cache);
+
+			*fn = g_build_filename (path, uri_tmp, NULL);
+			return TRUE;
+		}
+		if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
+			*fn = g_strdup (uri_tmp + 7);
+			return TRUE;
+		}
+		uri_str = fwupd_remote_build_firmware_uri (remote, uri_tmp, error);
+		if (uri_str == NULL)
+			return FALSE;
+	} else {
+		uri_str = g_strdup (uri_tmp);
+	}
+
+	/* place in gfu cache directory */
+	*fn = gfu_get_user_cache_path (uri_str);
+	*uri = g_steal_pointer (&uri_str);
+	return TRUE;
+}
+
+/* returns the local filename of the verified payload */
+gchar *
+gfu_engine_fetch_release (GfuEngine *self, FwupdRelease *rel, GError **error)
+{
+	GPtrArray *checksums;
+	const gchar *checksum;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *uri_str = NULL;
+	g_autoptr(SoupURI) uri = NULL;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("engine", "fetch-release");
+
+	g_return_val_if_fail (GFU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (FWUPD_IS_RELEASE (rel), NULL);
+
+	if (!gfu_engine_release_resolve (self, rel, &fn, &uri_str, error))
+		return NULL;
+	if (uri_str == NULL)
+		return g_steal_pointer (&fn);
+
+	/* download file */
+	g_debug ("Downloading %s...\n", fwupd_release_get_version (rel));
+	gfu_engine_set_status (self, _("Preparing to download file..."));
+	/* TRANSLATORS: creating directory for the firmware download */
+	gfu_engine_set_status (self, _("Creating cache path..."));
+	if (!gfu_common_mkdir_parent (fn, error))
+		return NULL;
+	gfu_common_release_ensure_details (rel);
+	checksums = fwupd_release_get_checksums (rel);
+	checksum = fwupd_checksum_get_best (checksums);
+	if (checksum == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     _("No checksum to verify version %s"),
+			     fwupd_release_get_version (rel));
+		return NULL;
+	}
+	uri = soup_uri_new (uri_str);
+	if (!gfu_engine_download_file (self, uri, fn, checksum, error))
+		return NULL;
+	return g_steal_pointer (&fn);
+}
+
+gboolean
+gfu_engine_install (GfuEngine *self,
+		    FwupdDevice *dev,
+		    const gchar *fn,
+		    FwupdInstallFlags flags,
+		    GError **error)
+{
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("engine", "fwupd-install");
+
+	g_return_val_if_fail (GFU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (FWUPD_IS_DEVICE (dev), FALSE);
+
+	/* if the device specifies ONLY_OFFLINE automatically set this flag */
+	if (fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_ONLY_OFFLINE))
+		flags |= FWUPD_INSTALL_FLAG_OFFLINE;
+	return fwupd_client_install (self->client,
+				     fwupd_device_get_id (dev), fn,
+				     flags, NULL, error);
+}
+
+static void
+gfu_engine_finalize (GObject *object)
+{
+	GfuEngine *self = GFU_ENGINE (object);
+
+	g_object_unref (self->client);
+	g_hash_table_unref (self->prefetched);
+	if (self->soup_session != NULL)
+		g_object_unref (self->soup_session);
+
+	G_OBJECT_CLASS (gfu_engine_parent_class)->finalize (object);
+}
+
+static void
+gfu_engine_class_init (GfuEngineClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gfu_engine_finalize;
+
+	signals[SIGNAL_STATUS_CHANGED] =
+		g_signal_new ("status-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__STRING,
+			      G_TYPE_NONE, 1, G_TYPE_STRING);
+}
+
+static void
+gfu_engine_init (GfuEngine *self)
+{
+	self->client = fwupd_client_new ();
+	self->prefetched = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+GfuEngine *
+gfu_engine_new (void)
+{
+	return g_object_new (GFU_TYPE_ENGINE, NULL);
+}
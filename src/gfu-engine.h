@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <fwupd.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+#define GFU_TYPE_ENGINE (gfu_engine_get_type ())
+
+G_DECLARE_FINAL_TYPE (GfuEngine, gfu_engine, GFU, ENGINE, GObject)
+
+GfuEngine	*gfu_engine_new				(void);
+FwupdClient	*gfu_engine_get_client			(GfuEngine	*self);
+SoupSession	*gfu_engine_get_soup_session		(GfuEngine	*self,
+							 GError		**error);
+void		 gfu_engine_abort			(GfuEngine	*self);
+void		 gfu_engine_add_prefetched		(GfuEngine	*self,
+							 const gchar	*fn);
+gboolean	 gfu_engine_download_check		(SoupMessage	*msg,
+							 const gchar	*uri_str,
+							 const gchar	*fn,
+							 const gchar	*checksum_expected,
+							 GError		**error);
+void		 gfu_engine_download_watch		(SoupMessage	*msg);
+gboolean	 gfu_engine_download_file		(GfuEngine	*self,
+							 SoupURI	*uri,
+							 const gchar	*fn,
+							 const gchar	*checksum_expected,
+							 GError		**error);
+gchar		*gfu_engine_remote_cache_path		(FwupdRemote	*remote,
+							 const gchar	*fn_daemon);
+gboolean	 gfu_engine_refresh_remote		(GfuEngine	*self,
+							 FwupdRemote	*remote,
+							 GError		**error);
+gboolean	 gfu_engine_refresh_metadata		(GfuEngine	*self,
+							 guint64	 max_age,
+							 GError		**error);
+gboolean	 gfu_engine_release_resolve		(GfuEngine	*self,
+							 FwupdRelease	*rel,
+							 gchar		**fn,
+							 gchar		**uri,
+							 GError		**error);
+gchar		*gfu_engine_fetch_release		(GfuEngine	*self,
+							 FwupdRelease	*rel,
+							 GError		**error);
+gboolean	 gfu_engine_install			(GfuEngine	*self,
+							 FwupdDevice	*dev,
+							 const gchar	*fn,
+							 FwupdInstallFlags flags,
+							 GError		**error);
+
+G_END_DECLS
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include "gfu-common.h"
+#include "gfu-estimator.h"
+
+/* number of installs before older samples start to be forgotten */
+#define GFU_ESTIMATOR_SAMPLES_MAX	8
+
+/* weight given to the extrapolated value compared to the running estimate */
+#define GFU_ESTIMATOR_SMOOTHING		0.3
+
+struct _GfuEstimator {
+	GObject		 parent_instance;
+	GKeyFile	*db;
+	gchar		*filename;
+	gchar		*group_device;	/* the first GUID */
+	gchar		*group_kind;	/* plugin and protocol */
+	GTimer		*timer_total;
+	GTimer		*timer_phase;
+	gboolean	 active;
+	FwupdStatus	 status;
+	gdouble		 elapsed[FWUPD_STATUS_LAST];	/* measured this install */
+	gdouble		 expected[FWUPD_STATUS_LAST];	/* learned, or from the prior */
+	gdouble		 estimate;			/* seconds, or -1 if unknown */
+	gdouble		 estimate_time;
+};
+
+G_DEFINE_TYPE (GfuEstimator, gfu_estimator, G_TYPE_OBJECT)
+
+/* the order the daemon normally reports the phases in */
+static const FwupdStatus phase_order[] = {
+	FWUPD_STATUS_DECOMPRESSING,
+	FWUPD_STATUS_LOADING,
+	FWUPD_STATUS_DEVICE_BUSY,
+	FWUPD_STATUS_DEVICE_READ,
+	FWUPD_STATUS_DEVICE_ERASE,
+	FWUPD_STATUS_DEVICE_WRITE,
+	FWUPD_STATUS_DEVICE_VERIFY,
+	FWUPD_STATUS_SCHEDULING,
+	FWUPD_STATUS_DEVICE_RESTART,
+};
+
+/* how the install duration from the daemon is split if nothing is learned */
+static const struct {
+	FwupdStatus	 status;
+	gdouble		 fraction;
+} phase_prior[] = {
+	{ FWUPD_STATUS_DEVICE_ERASE,	0.20 },
+	{ FWUPD_STATUS_DEVICE_WRITE,	0.55 },
+	{ FWUPD_STATUS_DEVICE_VERIFY,	0.15 },
+	{ FWUPD_STATUS_DEVICE_RESTART,	0.10 },
+};
+
+static void
+gfu_estimator_ensure_loaded (GfuEstimator *self)
+{
+	g_autoptr(GError) error = NULL;
+
+	if (self->filename != NULL)
+		return;
+	self->filename = gfu_get_user_cache_path ("install-durations.ini");
+	if (!g_key_file_load_from_file (self->db, self->filename,
+					G_KEY_FILE_NONE, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_debug ("ignoring install durations: %s", error->message);
+	}
+}
+
+static gdouble
+gfu_estimator_lookup (GfuEstimator *self, const gchar *group, FwupdStatus status)
+{
+	const gchar *key = fwupd_status_to_string (status);
+	if (group == NULL || !g_key_file_has_key (self->db, group, key, NULL))
+		return -1;
+	return g_key_file_get_double (self->db, group, key, NULL);
+}
+
+static void
+gfu_estimator_learn (GfuEstimator *self,
+		     const gchar *group,
+		     FwupdStatus status,
+		     gdouble value)
+{
+	const gchar *key = fwupd_status_to_string (status);
+	gdouble mean;
+	gint samples;
+	g_autofree gchar *key_samples = g_strdup_printf ("%s-samples", key);
+
+	if (group == NULL)
+		return;
+
+	/* rolling average, so that firmware or daemon changes are picked up */
+	mean = g_key_file_get_double (self->db, group, key, NULL);
+	samples = g_key_file_get_integer (self->db, group, key_samples, NULL);
+	samples = MIN (samples + 1, GFU_ESTIMATOR_SAMPLES_MAX);
+	mean += (value - mean) / samples;
+	g_key_file_set_double (self->db, group, key, mean);
+	g_key_file_set_integer (self->db, group, key_samples, samples);
+}
+
+void
+gfu_estimator_start (GfuEstimator *self, FwupdDevice *device)
+{
+	GPtrArray *guids;
+	const gchar *plugin;
+	const gchar *protocol = NULL;
+	gboolean learned = FALSE;
+	guint64 prior;
+
+	g_return_if_fail (GFU_IS_ESTIMATOR (self));
+	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	gfu_estimator_ensure_loaded (self);
+
+	/* the same model of hardware first, then anything using the same protocol */
+	guids = fwupd_device_get_guids (device);
+	g_free (self->group_device);
+	self->group_device = guids->len > 0 ? g_strdup (g_ptr_array_index (guids, 0)) : NULL;
+	plugin = fwupd_device_get_plugin (device);
+#if FWUPD_CHECK_VERSION(1,3,6)
+	protocol = fwupd_device_get_protocol (device);
+#endif
+	g_free (self->group_kind);
+	self->group_kind = g_strdup_printf ("%s/%s",
+					    plugin != NULL ? plugin : "unknown",
+					    protocol != NULL ? protocol : "unknown");
+
+	for (guint i = 0; i < FWUPD_STATUS_LAST; i++) {
+		self->elapsed[i] = 0;
+		self->expected[i] = gfu_estimator_lookup (self, self->group_device, i);
+		if (self->expected[i] < 0)
+			self->expected[i] = gfu_estimator_lookup (self, self->group_kind, i);
+		if (self->expected[i] >= 0)
+			learned = TRUE;
+	}
+
+	/* never seen anything like this before, so use what the daemon says */
+	prior = fwupd_device_get_install_duration (device);
+	if (!learned && prior > 0) {
+		for (guint i = 0; i < G_N_ELEMENTS (phase_prior); i++)
+			self->expected[phase_prior[i].status] = phase_prior[i].fraction * prior;
+	}
+	g_debug ("estimating %s using %s, prior %" G_GUINT64_FORMAT "s",
+		 fwupd_device_get_id (device),
+		 learned ? "learned durations" : "install duration",
+		 prior);
+
+	self->status = FWUPD_STATUS_UNKNOWN;
+	self->estimate = -1;
+	self->estimate_time = 0;
+	self->active = TRUE;
+	g_timer_start (self->timer_total);
+	g_timer_start (self->timer_phase);
+}
+
+static void
+gfu_estimator_close_phase (GfuEstimator *self)
+{
+	if (self->status == FWUPD_STATUS_UNKNOWN || self->status >= FWUPD_STATUS_LAST)
+		return;
+	self->elapsed[self->status] += g_timer_elapsed (self->timer_phase, NULL);
+}
+
+static gdouble
+gfu_estimator_get_phase_remaining (GfuEstimator *self, guint percentage)
+{
+	gdouble elapsed_phase = g_timer_elapsed (self->timer_phase, NULL);
+	gdouble elapsed = self->elapsed[self->status] + elapsed_phase;
+	gdouble expected = self->expected[self->status];
+	gdouble linear = -1;
+	gdouble weight;
+
+	if (percentage > 0 && percentage < 100)
+		linear = elapsed_phase / percentage * (100 - percentage);
+	if (expected < 0)
+		return linear;
+	if (linear < 0)
+		return MAX (expected - elapsed, 0);
+
+	/* trust the history at the start, and the measured rate at the end */
+	weight = (gdouble) percentage / 100.f;
+	return (1 - weight) * MAX (expected - elapsed, 0) + weight * linear;
+}
+
+static gdouble
+gfu_estimator_get_future_remaining (GfuEstimator *self)
+{
+	gboolean found = FALSE;
+	gdouble total = 0;
+
+	for (guint i = 0; i < G_N_ELEMENTS (phase_order); i++) {
+		FwupdStatus status = phase_order[i];
+		if (status == self->status) {
+			found = TRUE;
+			continue;
+		}
+		if (!found)
+			continue;
+		if (self->expected[status] > 0 && self->elapsed[status] == 0)
+			total += self->expected[status];
+	}
+
+	/* not a flashing phase, e.g. authenticating, so everything is to come */
+	if (!found) {
+		for (guint i = 0; i < G_N_ELEMENTS (phase_order); i++) {
+			FwupdStatus status = phase_order[i];
+			if (self->expected[status] > 0 && self->elapsed[status] == 0)
+				total += self->expected[status];
+		}
+	}
+	return total;
+}
+
+void
+gfu_estimator_set_progress (GfuEstimator *self, FwupdStatus status, guint percentage)
+{
+	gdouble future;
+	gdouble now;
+	gdouble phase = -1;
+	gdouble raw;
+
+	g_return_if_fail (GFU_IS_ESTIMATOR (self));
+
+	if (!self->active || status >= FWUPD_STATUS_LAST)
+		return;
+
+	/* phase changed */
+	if (status != self->status) {
+		gfu_estimator_close_phase (self);
+		self->status = status;
+		g_timer_start (self->timer_phase);
+	}
+
+	if (self->status != FWUPD_STATUS_UNKNOWN)
+		phase = gfu_estimator_get_phase_remaining (self, percentage);
+	future = gfu_estimator_get_future_remaining (self);
+	if (phase < 0 && future == 0)
+		return;
+	raw = MAX (phase, 0) + future;
+
+	/* count down from the last estimate rather than jumping about */
+	now = g_timer_elapsed (self->timer_total, NULL);
+	if (self->estimate < 0) {
+		self->estimate = raw;
+	} else {
+		gdouble predicted = MAX (self->estimate - (now - self->estimate_time), 0);
+		self->estimate = (1 - GFU_ESTIMATOR_SMOOTHING) * predicted +
+				 GFU_ESTIMATOR_SMOOTHING * raw;
+	}
+	self->estimate_time = now;
+}
+
+gdouble
+gfu_estimator_get_remaining (GfuEstimator *self)
+{
+	g_return_val_if_fail (GFU_IS_ESTIMATOR (self), -1);
+	if (!self->active)
+		return -1;
+	return self->estimate;
+}
+
+gboolean
+gfu_estimator_finish (GfuEstimator *self, gboolean success, GError **error)
+{
+	g_return_val_if_fail (GFU_IS_ESTIMATOR (self), FALSE);
+
+	if (!self->active)
+		return TRUE;
+	gfu_estimator_close_phase (self);
+	self->active = FALSE;
+
+	/* only learn from installs that completed */
+	if (!success)
+		return TRUE;
+	for (guint i = 0; i < FWUPD_STATUS_LAST; i++) {
+		if (self->elapsed[i] == 0)
+			continue;
+		g_debug ("%s took %.1fs", fwupd_status_to_string (i), self->elapsed[i]);
+		gfu_estimator_learn (self, self->group_device, i, self->elapsed[i]);
+		gfu_estimator_learn (self, self->group_kind, i, self->elapsed[i]);
+	}
+
+	/* save */
+	if (!gfu_common_mkdir_parent (self->filename, error))
+		return FALSE;
+	return g_key_file_save_to_file (self->db, self->filename, error);
+}
+
+static void
+gfu_estimator_finalize (GObject *object)
+{
+	GfuEstimator *self = GFU_ESTIMATOR (object);
+
+	g_key_file_unref (self->db);
+	g_free (self->filename);
+	g_free (self->group_device);
+	g_free (self->group_kind);
+	g_timer_destroy (self->timer_total);
+	g_timer_destroy (self->timer_phase);
+
+	G_OBJECT_CLASS (gfu_estimator_parent_class)->finalize (object);
+}
+
+static void
+gfu_estimator_class_init (GfuEstimatorClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gfu_estimator_finalize;
+}
+
+static void
+gfu_estimator_init (GfuEstimator *self)
+{
+	self->db = g_key_file_new ();
+	self->timer_total = g_timer_new ();
+	self->timer_phase = g_timer_new ();
+	self->estimate = -1;
+}
+
+GfuEstimator *
+gfu_estimator_new (void)
+{
+	return g_object_new (GFU_TYPE_ESTIMATOR, NULL);
+}
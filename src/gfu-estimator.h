@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <fwupd.h>
+
+G_BEGIN_DECLS
+
+#define GFU_TYPE_ESTIMATOR (gfu_estimator_get_type ())
+
+G_DECLARE_FINAL_TYPE (GfuEstimator, gfu_estimator, GFU, ESTIMATOR, GObject)
+
+GfuEstimator	*gfu_estimator_new			(void);
+void		 gfu_estimator_start			(GfuEstimator	*self,
+							 FwupdDevice	*device);
+void		 gfu_estimator_set_progress		(GfuEstimator	*self,
+							 FwupdStatus	 status,
+							 guint		 percentage);
+gdouble		 gfu_estimator_get_remaining		(GfuEstimator	*self);
+gboolean	 gfu_estimator_finish			(GfuEstimator	*self,
+							 gboolean	 success,
+							 GError		**error);
+
+G_END_DECLS
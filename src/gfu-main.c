@@ -6,6 +6,8 @@
 
 #include "config.h"
 
+#include <fcntl.h>
+#include <gio/gunixfdlist.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
 #include <gtk/gtk.h>
@@ -13,9 +15,16 @@
 #include <stdlib.h>
 #include <fwupd.h>
 
+#include "gfu-common.h"
 #include "gfu-device-row.h"
+#include "gfu-device-store.h"
+#include "gfu-engine.h"
+#include "gfu-estimator.h"
+#include "gfu-recorder.h"
 #include "gfu-release-row.h"
-#include "gfu-common.c"
+#include "gfu-stats.h"
+#include "gfu-trace.h"
+#include "gfu-watchdog.h"
 
 /* gfu types */
 
@@ -23,35 +32,177 @@ typedef enum {
 	GFU_MAIN_MODE_UNKNOWN,
 	GFU_MAIN_MODE_DEVICE,
 	GFU_MAIN_MODE_RELEASE,
+	GFU_MAIN_MODE_DIAGNOSTICS,
 	GFU_MAIN_MODE_LAST
 } GfuMainMode;
 
+typedef enum {
+	GFU_MAIN_SECTION_NONE		= 0,
+	GFU_MAIN_SECTION_STACK		= 1 << 0,
+	GFU_MAIN_SECTION_DEVICE		= 1 << 1,
+	GFU_MAIN_SECTION_RELEASE	= 1 << 2,
+	GFU_MAIN_SECTION_ACTIONS	= 1 << 3,
+	GFU_MAIN_SECTION_ALL		= 0xff
+} GfuMainSection;
+
+/* points on the way to the first useful frame, in the order expected */
+typedef enum {
+	GFU_MAIN_STARTUP_RESOURCE,
+	GFU_MAIN_STARTUP_BUILDER,
+	GFU_MAIN_STARTUP_MAP,
+	GFU_MAIN_STARTUP_DBUS,
+	GFU_MAIN_STARTUP_FIRST_ROW,
+	GFU_MAIN_STARTUP_LAST
+} GfuMainStartup;
+
+/* one reply or signal from the daemon, all times are monotonic µs */
+typedef struct {
+	gchar			*member;
+	GDBusMessageType	 type;
+	gint64			 arrival;
+	gint64			 dispatched;
+	gint64			 painted;		/* 0 if no frame was drawn */
+} GfuMainLatency;
+
+/* a value label and the label describing it */
+typedef struct {
+	GtkWidget		*value;
+	GtkWidget		*title;
+} GfuMainLabel;
+
 typedef struct {
 	GtkApplication		*application;
 	GtkBuilder		*builder;
 	GCancellable		*cancellable;
-	FwupdClient		*client;
+	GfuEngine		*engine;
+	FwupdClient		*client;		/* owned by the engine */
 	FwupdDevice		*device;
 	FwupdRelease		*release;
 	GPtrArray		*releases;
+	gboolean		 releases_live;		/* not from the snapshot */
 	GfuMainMode		 mode;
 	GDBusProxy		*proxy;
-	SoupSession		*soup_session;
 	FwupdInstallFlags	 flags;
 	GfuOperation		 current_operation;
-	GTimer			*time_elapsed;
-	gdouble			 last_estimate;
+	GfuEstimator		*estimator;
+	GfuDeviceStore		*devices;
+	guint			 groups_refresh_id;
+	GHashTable		*release_rows;		/* device-id : GPtrArray of GfuReleaseRow */
+	GPtrArray		*release_rows_current;
+	guint			 releases_pending_id;
+	guint			 releases_pending_idx;
+	GfuMainSection		 dirty;
+	gboolean		 verification_matched;
+	GHashTable		*labels;		/* label-id : GfuMainLabel */
+	GHashTable		*descriptions;		/* XML : Pango markup */
+	GString			*scratch;		/* reused by each refresh */
+	guint64			 device_flags_shown;
+	GtkWidget		*stack_main;
+	GtkWidget		*grid_device_flags;
+	GtkWidget		*button_install;
+	GtkWidget		*menu_button;
+	GtkWidget		*button_back;
+	GtkWidget		*button_unlock;
+	GtkWidget		*button_verify;
+	GtkWidget		*button_verify_update;
+	GtkWidget		*button_releases;
+	GtkWidget		*box_firmware;		/* built when first needed */
+	GtkWidget		*label_diagnostics;	/* built when first needed */
+	GfuMainMode		 diagnostics_mode_prev;
+	guint			 diagnostics_id;
+	GTimer			*startup_timer;		/* NULL when all phases are done */
+	gdouble			 startup_phases[GFU_MAIN_STARTUP_LAST];
+	GPtrArray		*update_all;		/* of GfuUpdateAllJob */
+	guint			 update_all_idx;
+	guint			 update_all_id;
+	gboolean		 update_all_flashing;
+	gpointer		 update_all_query;	/* GfuUpdateAllQuery, NULL unless asking */
+	gboolean		 stale;			/* showing the snapshot */
+	GVariant		*snapshot_devices;	/* summaries of the shown devices */
+	GHashTable		*snapshot_releases;	/* device-id : GetReleases reply */
+	guint			 snapshot_save_id;
+	gboolean		 service;		/* resident without a window */
+	guint			 service_refresh_id;
+	gboolean		 service_refreshing;	/* downloading metadata */
+	GPtrArray		*prefetch;		/* of GfuUpdateAllJob */
+	gboolean		 lvfs_disabled;
+	GfuRecorder		*recorder;		/* NULL unless recording or measuring */
+	gchar			*record_filename;
+	GArray			*latencies;		/* of GfuMainLatency, NULL if not measuring */
+	guint			 latencies_painted;
+	GfuWatchdog		*watchdog;		/* NULL unless --stall-threshold */
 } GfuMain;
 
-/* used to compare rows in a list */
+/* in ms, long enough to not be noise from a slow frame */
+#define GFU_MAIN_STALL_THRESHOLD	250
 
-typedef struct {
-	GtkListBox *list;
-	FwupdDevice *row;
-} GfuDeviceRowHelper;
+/* number of release rows that are shown before the first frame */
+#define GFU_MAIN_RELEASES_SCREENFUL	15
+
+/* time allowed for each idle batch of release rows, in microseconds */
+#define GFU_MAIN_RELEASES_BATCH_BUDGET	4000
+
+/* number of rendered release descriptions to keep */
+#define GFU_MAIN_DESCRIPTIONS_MAX	64
+
+/* bumped when the snapshot format changes */
+#define GFU_MAIN_SNAPSHOT_VERSION	1
+#define GFU_MAIN_SNAPSHOT_TYPE		"(u(aa{sv})a{sv})"
+
+/* how often the service refreshes metadata, and the spread across a fleet,
+ * in seconds; the first refresh is between one and two minutes after boot */
+#define GFU_MAIN_SERVICE_REFRESH_INTERVAL	(6 * 60 * 60)
+#define GFU_MAIN_SERVICE_REFRESH_JITTER		(30 * 60)
+#define GFU_MAIN_SERVICE_REFRESH_FIRST		60
 
 /* GTK helper functions */
 
+static void
+gfu_main_startup_mark (GfuMain *self, GfuMainStartup phase)
+{
+	const gchar *ids[] = {
+		[GFU_MAIN_STARTUP_RESOURCE]	= "resource decompression",
+		[GFU_MAIN_STARTUP_BUILDER]	= "builder parse",
+		[GFU_MAIN_STARTUP_MAP]		= "first map",
+		[GFU_MAIN_STARTUP_DBUS]		= "D-Bus connect",
+		[GFU_MAIN_STARTUP_FIRST_ROW]	= "first device row",
+	};
+
+	/* only the first time each phase is reached counts */
+	if (self->startup_timer == NULL || self->startup_phases[phase] > 0)
+		return;
+	self->startup_phases[phase] = g_timer_elapsed (self->startup_timer, NULL);
+	g_debug ("startup: %s after %.2fms",
+		 ids[phase], self->startup_phases[phase] * 1000);
+
+	/* all done */
+	for (guint i = 0; i < GFU_MAIN_STARTUP_LAST; i++) {
+		if (self->startup_phases[i] == 0)
+			return;
+	}
+	g_clear_pointer (&self->startup_timer, g_timer_destroy);
+}
+
+/* what the watchdog blames for a stall, popped when it goes out of scope */
+typedef GfuMain GfuMainScope;
+
+static GfuMainScope *
+gfu_main_scope_push (GfuMain *self, const gchar *name)
+{
+	if (self->watchdog != NULL)
+		gfu_watchdog_push (self->watchdog, name);
+	return self;
+}
+
+static void
+gfu_main_scope_pop (GfuMainScope *self)
+{
+	if (self->watchdog != NULL)
+		gfu_watchdog_pop (self->watchdog);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuMainScope, gfu_main_scope_pop)
+
 static void
 gfu_main_container_remove_all_cb (GtkWidget *widget, gpointer user_data)
 {
@@ -71,6 +222,12 @@ gfu_main_error_dialog (GfuMain *self, const gchar *title, const gchar *message)
 	GtkWindow *window;
 	GtkWidget *dialog;
 
+	/* running as a service with no window yet */
+	if (self->builder == NULL) {
+		g_warning ("%s: %s", title, message);
+		return;
+	}
+
 	window = GTK_WINDOW (gtk_builder_get_object (self->builder, "dialog_main"));
 	dialog = gtk_message_dialog_new (window,
 					 GTK_DIALOG_MODAL,
@@ -85,70 +242,97 @@ gfu_main_error_dialog (GfuMain *self, const gchar *title, const gchar *message)
 	gtk_widget_destroy (dialog);
 }
 
+static gboolean gfu_main_ensure_ui (GfuMain *self, GError **error);
+
 static void
 gfu_main_activate_cb (GApplication *application, GfuMain *self)
 {
 	GtkWindow *window;
+	g_autoptr(GError) error = NULL;
+
+	/* attach to whatever the service already has loaded */
+	if (!gfu_main_ensure_ui (self, &error)) {
+		g_warning ("failed to load ui: %s", error->message);
+		return;
+	}
 	window = GTK_WINDOW (gtk_builder_get_object (self->builder, "dialog_main"));
 	gtk_window_present (window);
 }
 
+static GfuMainLabel *
+gfu_main_get_label (GfuMain *self, const gchar *label_id)
+{
+	GfuMainLabel *label = g_hash_table_lookup (self->labels, label_id);
+
+	/* only looked up the first time */
+	if (label == NULL) {
+		g_autofree gchar *label_id_title = g_strdup_printf ("%s_title", label_id);
+		label = g_new0 (GfuMainLabel, 1);
+		label->value = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id));
+		label->title = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id_title));
+		g_hash_table_insert (self->labels, (gpointer) label_id, label);
+	}
+	return label;
+}
+
+static void
+gfu_main_label_set_text (GtkWidget *w, const gchar *text)
+{
+	/* avoid a relayout if nothing changed */
+	if (g_strcmp0 (gtk_label_get_label (GTK_LABEL (w)), text) == 0)
+		return;
+	gtk_label_set_label (GTK_LABEL (w), text);
+}
+
 static void
 gfu_main_set_label (GfuMain *self, const gchar *label_id, const gchar *text)
 {
-	GtkWidget *w;
-	g_autofree gchar *label_id_title = g_strdup_printf ("%s_title", label_id);
+	GfuMainLabel *label = gfu_main_get_label (self, label_id);
 
 	/* hide empty box */
 	if (text == NULL) {
-		w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id));
-		gtk_widget_set_visible (w, FALSE);
-		w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id_title));
-		gtk_widget_set_visible (w, FALSE);
+		gtk_widget_set_visible (label->value, FALSE);
+		gtk_widget_set_visible (label->title, FALSE);
 		return;
 	}
 
 	/* update and display */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id));
-	gtk_label_set_label (GTK_LABEL (w), text);
-	gtk_widget_set_visible (w, TRUE);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id_title));
-	gtk_widget_set_visible (w, TRUE);
+	gfu_main_label_set_text (label->value, text);
+	gtk_widget_set_visible (label->value, TRUE);
+	gtk_widget_set_visible (label->title, TRUE);
 }
 
 static void
 gfu_main_set_label_title (GfuMain *self, const gchar *label_id, const gchar *text)
 {
 	/* update only the title of a label */
-	GtkWidget *w;
-	g_autofree gchar *label_id_title = g_strdup_printf ("%s_title", label_id);
+	GfuMainLabel *label = gfu_main_get_label (self, label_id);
 
 	/* hide empty box */
 	if (text == NULL) {
-		w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id));
-		gtk_widget_set_visible (w, FALSE);
-		w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id_title));
-		gtk_widget_set_visible (w, FALSE);
+		gtk_widget_set_visible (label->value, FALSE);
+		gtk_widget_set_visible (label->title, FALSE);
 		return;
 	}
 
 	/* update and display */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id_title));
-	gtk_label_set_label (GTK_LABEL (w), text);
-	gtk_widget_set_visible (w, TRUE);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, label_id));
-	gtk_widget_set_visible (w, TRUE);
+	gfu_main_label_set_text (label->title, text);
+	gtk_widget_set_visible (label->title, TRUE);
+	gtk_widget_set_visible (label->value, TRUE);
 }
 
 static void
 gfu_main_set_device_flags (GfuMain *self, guint64 flags)
 {
 	GtkWidget *icon, *label;
-	GtkGrid *w;
+	GtkGrid *w = GTK_GRID (self->grid_device_flags);
 	gint count = 0;
-	g_autoptr(GString) flag = g_string_new (NULL);
 
-	w = GTK_GRID (gtk_builder_get_object (self->builder, "grid_device_flags"));
+	/* the grid is only rebuilt when the flags change */
+	if (flags == self->device_flags_shown)
+		return;
+	self->device_flags_shown = flags;
+
 	/* clear the grid */
 	gtk_grid_remove_column (w, 0);
 	gtk_grid_remove_column (w, 0);
@@ -156,373 +340,494 @@ gfu_main_set_device_flags (GfuMain *self, guint64 flags)
 	gtk_grid_insert_column (w, 0);
 
 	/* iterate through flags */
-	for (guint j = 0; j < 64; j++) {
-		gchar *flag_tmp;
-		/* if flag is not set, skip */
-		if ((flags & ((guint64) 1 << j)) == 0)
+	for (guint64 tmp = flags; tmp != 0; tmp &= tmp - 1) {
+		const GfuFlagInfo *info = gfu_common_device_flag_get_info (GFU_FLAG_BIT (tmp));
+		if (info == NULL || info->label == NULL)
 			continue;
-		/* else, add a row for this flag */
-		g_string_set_size (flag, 0);
-		flag_tmp = gfu_common_device_flag_to_string ((guint64) 1 << j);
-		if (flag_tmp == NULL)
-			continue;
-		g_string_assign (flag, flag_tmp);
+
+		/* add a row for this flag */
 		gtk_grid_insert_row (w, count);
 
-		icon = gtk_image_new_from_icon_name (gfu_common_device_icon_from_flag ((guint64) 1 << j), GTK_ICON_SIZE_BUTTON);
+		icon = gtk_image_new_from_icon_name (info->icon, GTK_ICON_SIZE_BUTTON);
 		gtk_widget_set_visible (icon, TRUE);
 		gtk_grid_attach (w, icon, 0, count, 1, 1);
 
-		label = gtk_label_new (flag->str);
+		label = gtk_label_new (_(info->label));
 		gtk_label_set_xalign (GTK_LABEL (label), 0);
 		gtk_widget_set_visible (label, TRUE);
 		gtk_grid_attach (w, label, 1, count, 1, 1);
 
 		count++;
 	}
-	if (count == 0) {
-		/* no flags were added */
-		gtk_widget_set_visible (GTK_WIDGET (w), FALSE);
-		gtk_widget_set_visible (GTK_WIDGET (gtk_builder_get_object (self->builder, "label_device_flags_title")), FALSE);
-	} else {
-		gtk_widget_set_visible (GTK_WIDGET (w), TRUE);
-		gtk_widget_set_visible (GTK_WIDGET (gtk_builder_get_object (self->builder, "label_device_flags_title")), TRUE);
-	}
+
+	/* hide if no flags were added */
+	gtk_widget_set_visible (GTK_WIDGET (w), count > 0);
+	gtk_widget_set_visible (gfu_main_get_label (self, "label_device_flags")->title, count > 0);
 }
 
 static void
-gfu_main_refresh_ui (GfuMain *self)
+gfu_main_refresh_stack (GfuMain *self)
 {
-	GtkWidget *w;
-	g_autoptr(GPtrArray) upgrades = NULL;
-	gboolean verification_matched = FALSE;
-
-	/* set stack */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "stack_main"));
 	if (self->mode == GFU_MAIN_MODE_RELEASE)
-		gtk_stack_set_visible_child_name (GTK_STACK (w), "firmware");
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_main), "firmware");
+	else if (self->mode == GFU_MAIN_MODE_DIAGNOSTICS)
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_main), "diagnostics");
 	else if (self->mode == GFU_MAIN_MODE_DEVICE)
-		gtk_stack_set_visible_child_name (GTK_STACK (w), "main");
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_main), "main");
 	else
-		gtk_stack_set_visible_child_name (GTK_STACK (w), "loading");
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_main), "loading");
+}
 
-	/* set device information */
-	if (self->device != NULL) {
-		GPtrArray *guids;
-		g_autoptr(GString) attr = g_string_new (NULL);
-		g_autoptr(GError) error = NULL;
-		gchar *tmp;
-		gchar *tmp2;
-
-		gfu_main_set_label (self, "label_device_version",
-				    fwupd_device_get_version (self->device));
-		gfu_main_set_label (self, "label_device_version_lowest",
-				    fwupd_device_get_version_lowest (self->device));
-		gfu_main_set_label (self, "label_device_version_bootloader",
-				    fwupd_device_get_version_bootloader (self->device));
-		gfu_main_set_label (self, "label_device_update_error",
-				    fwupd_device_get_update_error (self->device));
-		gfu_main_set_label (self, "label_device_serial",
-				    fwupd_device_get_serial (self->device));
-
-		tmp = fwupd_device_get_vendor (self->device);
-		tmp2 = fwupd_device_get_vendor_id (self->device);
-		if (tmp != NULL && tmp2 != NULL) {
-			g_autofree gchar *both = g_strdup_printf ("%s (%s)", tmp, tmp2);
-			gfu_main_set_label (self, "label_device_vendor", both);
-		} else if (tmp != NULL) {
-			gfu_main_set_label (self, "label_device_vendor", tmp);
-		} else if (tmp2 != NULL) {
-			gfu_main_set_label (self, "label_device_vendor", tmp2);
-		} else {
-			gfu_main_set_label (self, "label_device_vendor", NULL);
-		}
+static void
+gfu_main_refresh_device (GfuMain *self)
+{
+	GPtrArray *guids;
+	GString *attr = self->scratch;
+	g_autoptr(GError) error = NULL;
+	const gchar *tmp;
+	const gchar *tmp2;
+	gchar buf[64];
 
-		g_string_append_printf (attr, "%u", fwupd_device_get_flashes_left (self->device));
-		gfu_main_set_label (self, "label_device_flashes_left",
-				    g_strcmp0 (attr->str, "0")? attr->str : NULL);
+	self->verification_matched = FALSE;
+	if (self->device == NULL)
+		return;
 
-		gfu_main_set_label (self, "label_device_install_duration",
-				    gfu_common_seconds_to_string (fwupd_device_get_install_duration (self->device)));
+	gfu_main_set_label (self, "label_device_version",
+			    fwupd_device_get_version (self->device));
+	gfu_main_set_label (self, "label_device_version_lowest",
+			    fwupd_device_get_version_lowest (self->device));
+	gfu_main_set_label (self, "label_device_version_bootloader",
+			    fwupd_device_get_version_bootloader (self->device));
+	gfu_main_set_label (self, "label_device_update_error",
+			    fwupd_device_get_update_error (self->device));
+	gfu_main_set_label (self, "label_device_serial",
+			    fwupd_device_get_serial (self->device));
+
+	tmp = fwupd_device_get_vendor (self->device);
+	tmp2 = fwupd_device_get_vendor_id (self->device);
+	if (tmp != NULL && tmp2 != NULL) {
+		g_string_set_size (attr, 0);
+		g_string_append (attr, tmp);
+		g_string_append (attr, " (");
+		g_string_append (attr, tmp2);
+		g_string_append_c (attr, ')');
+		gfu_main_set_label (self, "label_device_vendor", attr->str);
+	} else if (tmp != NULL) {
+		gfu_main_set_label (self, "label_device_vendor", tmp);
+	} else if (tmp2 != NULL) {
+		gfu_main_set_label (self, "label_device_vendor", tmp2);
+	} else {
+		gfu_main_set_label (self, "label_device_vendor", NULL);
+	}
 
+	g_snprintf (buf, sizeof (buf), "%u", fwupd_device_get_flashes_left (self->device));
+	gfu_main_set_label (self, "label_device_flashes_left",
+			    g_strcmp0 (buf, "0")? buf : NULL);
 
-		gfu_main_set_device_flags (self, fwupd_device_get_flags (self->device));
+	gfu_main_set_label (self, "label_device_install_duration",
+			    gfu_common_seconds_to_string (fwupd_device_get_install_duration (self->device),
+							  buf, sizeof (buf)));
 
-		g_string_set_size (attr, 0);
-		guids = fwupd_device_get_guids (self->device);
-		/* extract GUIDs, append with newline */
-		for (guint i = 0; i < guids->len; i++) {
-			g_string_append_printf (attr, "%s\n", (gchar *) g_ptr_array_index (guids, i));
-		}
-		/* remove final newline, set label */
-		if (attr->len > 0)
-			g_string_truncate (attr, attr->len - 1);
-		gfu_main_set_label (self, "label_device_guids", attr->str);
-		/* set GUIDs->GUID if only one */
-		gfu_main_set_label_title (self, "label_device_guids", ngettext ("GUID", "GUIDs", guids->len));
 
-#if FWUPD_CHECK_VERSION(1,3,3)
-		/* device can be verified immediately without a round trip to firmware */
-		if (fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY) &&
-		    !fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE)) {
-			if (!fwupd_client_verify (self->client,
-						 fwupd_device_get_id (self->device),
-						 self->cancellable,
-						 &error)) {
-				gfu_main_set_label (self, "label_device_checksums", error->message);
-			} else {
-				gfu_main_set_label (self, "label_device_checksums", _("Cryptographic hashes match"));
-				verification_matched = TRUE;
-			}
+	gfu_main_set_device_flags (self, fwupd_device_get_flags (self->device));
+
+	g_string_set_size (attr, 0);
+	guids = fwupd_device_get_guids (self->device);
+	gfu_main_set_label (self, "label_device_guids", gfu_common_array_join (attr, guids));
+	/* set GUIDs->GUID if only one */
+	gfu_main_set_label_title (self, "label_device_guids", ngettext ("GUID", "GUIDs", guids->len));
 
-			if (fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE))
-				gfu_main_set_label_title (self, "label_device_checksums", _("Firmware checksum"));
-			else
-				gfu_main_set_label_title (self, "label_device_checksums", _("Device checksum"));
+#if FWUPD_CHECK_VERSION(1,3,3)
+	/* device can be verified immediately without a round trip to firmware */
+	if (!self->stale &&
+	    fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY) &&
+	    !fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE)) {
+		g_autoptr(GfuMainScope) scope = gfu_main_scope_push (self, "verify");
+		if (!fwupd_client_verify (self->client,
+					 fwupd_device_get_id (self->device),
+					 self->cancellable,
+					 &error)) {
+			gfu_main_set_label (self, "label_device_checksums", error->message);
 		} else {
-			gfu_main_set_label (self, "label_device_checksums", NULL);
+			gfu_main_set_label (self, "label_device_checksums", _("Cryptographic hashes match"));
+			self->verification_matched = TRUE;
 		}
-#else
+
+		if (fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE))
+			gfu_main_set_label_title (self, "label_device_checksums", _("Firmware checksum"));
+		else
+			gfu_main_set_label_title (self, "label_device_checksums", _("Device checksum"));
+	} else {
 		gfu_main_set_label (self, "label_device_checksums", NULL);
+	}
+#else
+	gfu_main_set_label (self, "label_device_checksums", NULL);
 #endif
-		//fixme: get parents
-		//FwupdDevice *parent = fwupd_device_get_parent (self->device);
-		//g_print ("parent: %s\n", fwupd_device_get_name (parent));
+	//fixme: get parents
+	//FwupdDevice *parent = fwupd_device_get_parent (self->device);
+	//g_print ("parent: %s\n", fwupd_device_get_name (parent));
+}
+
+static const gchar *
+gfu_main_get_description_markup (GfuMain *self, const gchar *xml, GError **error)
+{
+	gchar *markup;
+
+	/* moving between releases shows the same descriptions again */
+	if (xml != NULL) {
+		markup = g_hash_table_lookup (self->descriptions, xml);
+		if (markup != NULL)
+			return markup;
 	}
+	markup = gfu_common_xml_to_markup (xml, error);
+	if (markup == NULL)
+		return NULL;
+	if (g_hash_table_size (self->descriptions) >= GFU_MAIN_DESCRIPTIONS_MAX)
+		g_hash_table_remove_all (self->descriptions);
+	g_hash_table_insert (self->descriptions, g_strdup (xml), markup);
+	return markup;
+}
 
-	/* set release information */
-	if (self->release != NULL) {
-		GPtrArray *cats = NULL;
-		GPtrArray *checks = NULL;
-		GPtrArray *issues = NULL;
-		g_autofree gchar *desc = NULL;
-		g_autoptr(GString) size = g_string_new (NULL);
-		g_autoptr(GError) error = NULL;
-		g_autoptr(GString) attr = g_string_new (NULL);
+static void
+gfu_main_refresh_release (GfuMain *self)
+{
+	GPtrArray *cats = NULL;
+	GPtrArray *checks = NULL;
+	GPtrArray *issues = NULL;
+	const gchar *desc;
+	g_autoptr(GError) error = NULL;
+	GString *attr = self->scratch;
+	gchar buf[64];
 
-		gfu_main_set_label (self, "label_release_version", fwupd_release_get_version (self->release));
+	/* done when the page is built */
+	if (self->release == NULL || self->box_firmware == NULL)
+		return;
+
+	gfu_common_release_ensure_details (self->release);
+	gfu_main_set_label (self, "label_release_version", fwupd_release_get_version (self->release));
 
-		cats = fwupd_release_get_categories (self->release);
-		if (cats->len == 0) {
-			gfu_main_set_label (self, "label_release_categories", NULL);
+	g_string_set_size (attr, 0);
+	cats = fwupd_release_get_categories (self->release);
+	if (cats->len == 0) {
+		gfu_main_set_label (self, "label_release_categories", NULL);
+	} else {
+		gfu_main_set_label (self, "label_release_categories",
+				    gfu_common_array_join (attr, cats));
+		if (cats->len == 1) {
+			gfu_main_set_label_title (self, "label_release_categories", "Category");
 		} else {
-			for (guint i = 0; i < cats->len; i++) {
-				g_string_append_printf (attr, "%s\n", (const gchar *) g_ptr_array_index (cats, i));
-			}
-			gfu_main_set_label (self, "label_release_categories", attr->str);
-			if (attr->len > 0)
-				g_string_truncate (attr, attr->len - 1);
-			if (cats->len == 1) {
-				gfu_main_set_label_title (self, "label_release_categories", "Category");
-			} else {
-				gfu_main_set_label_title (self, "label_release_categories", "Categories");
-			}
+			gfu_main_set_label_title (self, "label_release_categories", "Categories");
 		}
+	}
 
-		g_string_set_size (attr, 0);
-		checks = fwupd_release_get_checksums (self->release);
-		if (checks->len == 0) {
-			gfu_main_set_label (self, "label_release_checksum", NULL);
-		} else {
-			for (guint i = 0; i < checks->len; i++) {
-				g_autofree gchar *tmp = gfu_common_checksum_format (g_ptr_array_index (checks, i));
-				g_string_append_printf (attr, "%s\n", tmp);
-			}
-			if (attr->len > 0)
-				g_string_truncate (attr, attr->len - 1);
-			gfu_main_set_label (self, "label_release_checksum", attr->str);
-			gfu_main_set_label_title (self, "label_release_checksum",
-						  ngettext ("Checksum", "Checksums", checks->len));
+	g_string_set_size (attr, 0);
+	checks = fwupd_release_get_checksums (self->release);
+	if (checks->len == 0) {
+		gfu_main_set_label (self, "label_release_checksum", NULL);
+	} else {
+		for (guint i = 0; i < checks->len; i++) {
+			gfu_common_checksum_format (attr, g_ptr_array_index (checks, i));
+			g_string_append_c (attr, '\n');
 		}
+		if (attr->len > 0)
+			g_string_truncate (attr, attr->len - 1);
+		gfu_main_set_label (self, "label_release_checksum", attr->str);
+		gfu_main_set_label_title (self, "label_release_checksum",
+					  ngettext ("Checksum", "Checksums", checks->len));
+	}
 
 #if FWUPD_CHECK_VERSION(1,3,2)
-		issues = fwupd_release_get_issues (self->release);
+	issues = fwupd_release_get_issues (self->release);
 #endif
-		if (issues == NULL || issues->len == 0) {
-			gfu_main_set_label (self, "label_release_issues", NULL);
-		} else {
-			g_autoptr(GString) str = g_string_new (NULL);
-			for (guint i = 0; i < issues->len; i++) {
-				const gchar *tmp = g_ptr_array_index (issues, i);
-				g_string_append_printf (str, "%s\n", tmp);
-			}
-			if (str->len > 0)
-				g_string_truncate (str, str->len - 1);
-			gfu_main_set_label (self, "label_release_issues", str->str);
-			gfu_main_set_label_title (self, "label_release_checksum",
-						  /* TRANSLATORS: e.g. CVEs */
-						  ngettext ("Fixed Issue", "Fixed Issues", checks->len));
-		}
-
-		gfu_main_set_label (self, "label_release_filename", fwupd_release_get_filename (self->release));
-		gfu_main_set_label (self, "label_release_protocol", fwupd_release_get_protocol (self->release));
-		gfu_main_set_label (self, "label_release_appstream_id", fwupd_release_get_appstream_id (self->release));
-		gfu_main_set_label (self, "label_release_remote_id", fwupd_release_get_remote_id (self->release));
-		gfu_main_set_label (self, "label_release_vendor", fwupd_release_get_vendor (self->release));
-		gfu_main_set_label (self, "label_release_summary", fwupd_release_get_summary (self->release));
-
+	if (issues == NULL || issues->len == 0) {
+		gfu_main_set_label (self, "label_release_issues", NULL);
+	} else {
 		g_string_set_size (attr, 0);
-		desc = gfu_common_xml_to_text (fwupd_release_get_description (self->release), &error);
-		if (desc == NULL) {
-			g_debug ("failed to get release description for version %s: %s", fwupd_release_get_version (self->release), error->message);
-			gfu_main_set_label (self, "label_release_description", NULL);
-		} else {
-			g_string_append (attr, desc);
-			if (attr->len > 0)
-				g_string_truncate (attr, attr->len - 1);
-			gfu_main_set_label (self, "label_release_description", attr->str);
-		}
+		gfu_main_set_label (self, "label_release_issues",
+				    gfu_common_array_join (attr, issues));
+		gfu_main_set_label_title (self, "label_release_issues",
+					  /* TRANSLATORS: e.g. CVEs */
+					  ngettext ("Fixed Issue", "Fixed Issues", issues->len));
+	}
 
-		gfu_main_set_label (self, "label_release_size", g_format_size(fwupd_release_get_size (self->release)));
+	gfu_main_set_label (self, "label_release_filename", fwupd_release_get_filename (self->release));
+	gfu_main_set_label (self, "label_release_protocol", fwupd_release_get_protocol (self->release));
+	gfu_main_set_label (self, "label_release_appstream_id", fwupd_release_get_appstream_id (self->release));
+	gfu_main_set_label (self, "label_release_remote_id", fwupd_release_get_remote_id (self->release));
+	gfu_main_set_label (self, "label_release_vendor", fwupd_release_get_vendor (self->release));
+	gfu_main_set_label (self, "label_release_summary", fwupd_release_get_summary (self->release));
+
+	desc = gfu_main_get_description_markup (self, fwupd_release_get_description (self->release), &error);
+	if (desc == NULL) {
+		g_debug ("failed to get release description for version %s: %s", fwupd_release_get_version (self->release), error->message);
+		gfu_main_set_label (self, "label_release_description", NULL);
+	} else {
+		gfu_main_set_label (self, "label_release_description", desc);
+	}
 
-		gfu_main_set_label (self, "label_release_license", fwupd_release_get_license (self->release));
+	gfu_main_set_label (self, "label_release_size",
+			    gfu_common_format_size (fwupd_release_get_size (self->release),
+						    buf, sizeof (buf)));
 
-		gfu_main_set_label (self, "label_release_flags",
-				    gfu_common_release_flags_to_strings (fwupd_release_get_flags (self->release)));
+	gfu_main_set_label (self, "label_release_license", fwupd_release_get_license (self->release));
 
-		gfu_main_set_label (self, "label_release_install_duration",
-				    gfu_common_seconds_to_string (fwupd_release_get_install_duration (self->release)));
+	g_string_set_size (attr, 0);
+	gfu_main_set_label (self, "label_release_flags",
+			    gfu_common_release_flags_to_strings (attr, fwupd_release_get_flags (self->release)));
 
-		gfu_main_set_label (self, "label_release_update_message",
-				    fwupd_release_get_update_message (self->release));
+	gfu_main_set_label (self, "label_release_install_duration",
+			    gfu_common_seconds_to_string (fwupd_release_get_install_duration (self->release),
+							  buf, sizeof (buf)));
 
-		/* install button */
-		w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_install"));
+	gfu_main_set_label (self, "label_release_update_message",
+			    fwupd_release_get_update_message (self->release));
 
-		if (self->device != NULL) {
-			gtk_widget_set_sensitive (w, TRUE);
-			if (self->release != NULL && self->releases != NULL) {
-				if (fwupd_release_has_flag (self->release, FWUPD_RELEASE_FLAG_IS_UPGRADE)) {
-					/* TRANSLATORS: upgrading the firmware */
-					gtk_button_set_label (GTK_BUTTON (w), _("Upgrade"));
-				} else if (fwupd_release_has_flag (self->release, FWUPD_RELEASE_FLAG_IS_DOWNGRADE)) {
-					/* TRANSLATORS: downgrading the firmware */
-					gtk_button_set_label (GTK_BUTTON (w), _("Downgrade"));
-				} else {
-					/* TRANSLATORS: installing the same firmware that is currently installed */
-					gtk_button_set_label (GTK_BUTTON (w), _("Reinstall"));
-				}
+	/* install button, which is made sensitive with the other actions */
+	if (self->device != NULL) {
+		if (self->release != NULL && self->releases != NULL) {
+			if (fwupd_release_has_flag (self->release, FWUPD_RELEASE_FLAG_IS_UPGRADE)) {
+				/* TRANSLATORS: upgrading the firmware */
+				gtk_button_set_label (GTK_BUTTON (self->button_install), _("Upgrade"));
+			} else if (fwupd_release_has_flag (self->release, FWUPD_RELEASE_FLAG_IS_DOWNGRADE)) {
+				/* TRANSLATORS: downgrading the firmware */
+				gtk_button_set_label (GTK_BUTTON (self->button_install), _("Downgrade"));
+			} else {
+				/* TRANSLATORS: installing the same firmware that is currently installed */
+				gtk_button_set_label (GTK_BUTTON (self->button_install), _("Reinstall"));
 			}
-		} else {
-			gtk_widget_set_sensitive (w, FALSE);
-			/* TRANSLATORS: general install button in the event of an error; not clickable */
-			gtk_button_set_label (GTK_BUTTON (w), _("Install"));
 		}
-
+	} else {
+		/* TRANSLATORS: general install button in the event of an error; not clickable */
+		gtk_button_set_label (GTK_BUTTON (self->button_install), _("Install"));
 	}
+}
 
+static void
+gfu_main_refresh_actions (GfuMain *self)
+{
 	/* refresh button */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "menu_button"));
-	gtk_widget_set_visible (w, self->mode != GFU_MAIN_MODE_RELEASE);
+	gtk_widget_set_visible (self->menu_button, self->mode != GFU_MAIN_MODE_RELEASE &&
+						   self->mode != GFU_MAIN_MODE_DIAGNOSTICS);
 
 	/* back button */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_back"));
-	gtk_widget_set_visible (w, self->mode == GFU_MAIN_MODE_RELEASE);
+	gtk_widget_set_visible (self->button_back, self->mode == GFU_MAIN_MODE_RELEASE ||
+						   self->mode == GFU_MAIN_MODE_DIAGNOSTICS);
+
+	/* nothing can be changed until the daemon confirms the snapshot, and
+	 * the snapshot releases have no checksums to verify the payload with */
+	if (self->button_install != NULL)
+		gtk_widget_set_sensitive (self->button_install, !self->stale && self->releases_live &&
+					  self->device != NULL && self->release != NULL);
 
 	/* unlock button */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_unlock"));
-	gtk_widget_set_visible (w, self->device != NULL &&
-				   fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_LOCKED));
+	gtk_widget_set_visible (self->button_unlock, !self->stale && self->device != NULL &&
+				fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_LOCKED));
 
 	/* verify button */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_verify"));
 #if FWUPD_CHECK_VERSION(1,3,3)
-	gtk_widget_set_visible (w, self->device != NULL &&
-				   !verification_matched &&
-				   fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE));
+	gtk_widget_set_visible (self->button_verify, !self->stale && self->device != NULL &&
+				!self->verification_matched &&
+				fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE));
 #else
-	gtk_widget_set_visible (w, verification_matched);
+	gtk_widget_set_visible (self->button_verify, self->verification_matched);
 #endif
 
 	/* verify update button */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_verify_update"));
 #if FWUPD_CHECK_VERSION(1,3,3)
-	gtk_widget_set_visible (w, self->device != NULL &&
-				   !verification_matched &&
-				   fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY));
+	gtk_widget_set_visible (self->button_verify_update, !self->stale && self->device != NULL &&
+				!self->verification_matched &&
+				fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_CAN_VERIFY));
 #else
-	gtk_widget_set_visible (w, verification_matched);
+	gtk_widget_set_visible (self->button_verify_update, self->verification_matched);
 #endif
+
 	/* releases button */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_releases"));
-	if (self->releases == NULL || self->releases->len == 0) {
-		gtk_widget_set_visible (w, FALSE);
-	} else {
-		gtk_widget_set_visible (w, TRUE);
-	}
+	gtk_widget_set_visible (self->button_releases,
+				self->releases != NULL && self->releases->len > 0);
+}
+
+static void
+gfu_main_invalidate (GfuMain *self, GfuMainSection sections)
+{
+	self->dirty |= sections;
 }
 
 static void
-gfu_main_remove_row (GtkWidget *row, GtkListBox *w)
+gfu_main_refresh_ui (GfuMain *self)
 {
-	gtk_container_remove (GTK_CONTAINER (w), row);
+	struct {
+		GfuMainSection	 section;
+		const gchar	*id;
+		void		(*func) (GfuMain *self);
+	} sections[] = {
+		{ GFU_MAIN_SECTION_STACK,	"stack",	gfu_main_refresh_stack },
+		{ GFU_MAIN_SECTION_DEVICE,	"device",	gfu_main_refresh_device },
+		{ GFU_MAIN_SECTION_RELEASE,	"release",	gfu_main_refresh_release },
+		{ GFU_MAIN_SECTION_ACTIONS,	"actions",	gfu_main_refresh_actions },
+	};
+	g_autoptr(GTimer) timer = NULL;
+
+	/* everything is dirty when the window gets built */
+	if (self->builder == NULL)
+		return;
+
+	/* only redraw what has changed; the device section sets the
+	 * verification result used by the actions */
+	for (guint i = 0; i < G_N_ELEMENTS (sections); i++) {
+		if ((self->dirty & sections[i].section) == 0)
+			continue;
+		if (timer == NULL)
+			timer = g_timer_new ();
+		g_timer_start (timer);
+		sections[i].func (self);
+		g_debug ("refreshed %s section in %.2fms",
+			 sections[i].id, g_timer_elapsed (timer, NULL) * 1000);
+	}
+	self->dirty = GFU_MAIN_SECTION_NONE;
 }
 
 /* updating devices while the application is open */
 
+static GtkWidget *
+gfu_main_device_row_create_cb (gpointer item, gpointer user_data)
+{
+	GfuMain *self = (GfuMain *) user_data;
+	GtkWidget *l = gfu_device_row_new (FWUPD_DEVICE (item));
+	gtk_widget_set_visible (l, TRUE);
+	gfu_stats_inc (GFU_STATS_COUNTER_ROWS_CREATED);
+	gfu_main_startup_mark (self, GFU_MAIN_STARTUP_FIRST_ROW);
+	return l;
+}
+
 static void
-gfu_main_device_added_cb (FwupdClient *client, FwupdDevice *device, GfuMain *self)
+gfu_main_select_first_device (GfuMain *self)
 {
-	GtkWidget *w;
-	GtkWidget *l;
+	GtkListBox *w;
+	GtkListBoxRow *l;
 
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_main"));
+	if (self->builder == NULL)
+		return;
+	w = GTK_LIST_BOX (gtk_builder_get_object (self->builder, "listbox_main"));
 
-	/* ignore if device can't be updated */
-	if (!fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+	/* if no row is selected and there are rows in the list, select the first one */
+	if (gtk_list_box_get_selected_row (w) != NULL)
 		return;
-	/* create and add new row for device */
-	l = gfu_device_row_new (device);
-	gtk_widget_set_visible (l, TRUE);
-	gtk_list_box_insert (GTK_LIST_BOX (w), l, -1);
+	l = gtk_list_box_get_row_at_index (w, 0);
+	if (l != NULL)
+		gtk_list_box_select_row (w, l);
+}
+
+static gboolean
+gfu_main_device_row_filter_cb (GtkListBoxRow *row, gpointer user_data)
+{
+	GfuMain *self = (GfuMain *) user_data;
+	FwupdDevice *device = gfu_device_row_get_device (GFU_DEVICE_ROW (row));
 
-	/* if no row is selected (list was previously empty), select the first one */
-	if (gtk_list_box_get_selected_row (GTK_LIST_BOX (w)) == NULL)
-		gtk_list_box_select_row (GTK_LIST_BOX (w), GTK_LIST_BOX_ROW (l));
+	/* identical devices are shown in the row of the first one */
+	return gfu_device_store_is_group_leader (self->devices, device);
 }
 
 static void
-gfu_main_remove_device_from_list (GtkWidget *row, GfuDeviceRowHelper *rowcheck)
+gfu_main_refresh_groups (GfuMain *self)
 {
-	FwupdDevice *result = rowcheck->row;
-	GtkListBox *w = rowcheck->list;
+	GtkListBox *w = GTK_LIST_BOX (gtk_builder_get_object (self->builder, "listbox_main"));
+	GtkListBoxRow *row;
+	gboolean changed = FALSE;
+
+	/* unchanged groups keep the same array */
+	for (guint i = 0; (row = gtk_list_box_get_row_at_index (w, i)) != NULL; i++) {
+		FwupdDevice *device = gfu_device_row_get_device (GFU_DEVICE_ROW (row));
+		g_autoptr(GPtrArray) group = NULL;
+		if (gfu_device_store_is_group_leader (self->devices, device))
+			group = gfu_device_store_get_group (self->devices, device);
+		if (gfu_device_row_get_group (GFU_DEVICE_ROW (row)) == group)
+			continue;
+		gfu_device_row_set_group (GFU_DEVICE_ROW (row), group);
+		changed = TRUE;
+	}
+	if (changed)
+		gtk_list_box_invalidate_filter (w);
+}
 
-	if (!FWUPD_IS_DEVICE (result))
-		return;
+static gboolean
+gfu_main_refresh_groups_cb (gpointer user_data)
+{
+	GfuMain *self = (GfuMain *) user_data;
+	self->groups_refresh_id = 0;
+	gfu_main_refresh_groups (self);
+	return FALSE;
+}
 
-	if (fwupd_device_compare (gfu_device_row_get_device (GFU_DEVICE_ROW (row)), result) == 0) {
-		/* if row to be removed is the currently selected row, select the first row of the list */
-		GtkListBoxRow *sel = gtk_list_box_get_selected_row (GTK_LIST_BOX (w));
-		if (fwupd_device_compare (gfu_device_row_get_device (GFU_DEVICE_ROW (sel)), result) == 0) {
-			GtkListBoxRow *l = gtk_list_box_get_row_at_index (GTK_LIST_BOX (w), 0);
-			if (l != NULL)
-				gtk_list_box_select_row (GTK_LIST_BOX (w), l);
-		}
-		/* remove row corresponding to the device */
-		gtk_container_remove (GTK_CONTAINER (w), row);
+static void
+gfu_main_devices_changed_cb (GListModel *model,
+			     guint position,
+			     guint removed,
+			     guint added,
+			     GfuMain *self)
+{
+	gfu_main_refresh_groups (self);
+	gfu_main_select_first_device (self);
+}
+
+static void
+gfu_main_device_changed_cb (GfuDeviceStore *devices, FwupdDevice *device, GfuMain *self)
+{
+	GtkListBox *w;
+	GtkListBoxRow *row;
+	guint position = 0;
+
+	/* libfwupd does not notify when the object is updated in place */
+	if (self->builder == NULL)
+		return;
+	if (!gfu_device_store_find (devices, fwupd_device_get_id (device), &position))
+		return;
+	w = GTK_LIST_BOX (gtk_builder_get_object (self->builder, "listbox_main"));
+	row = gtk_list_box_get_row_at_index (w, position);
+	if (row != NULL)
+		gfu_device_row_invalidate (GFU_DEVICE_ROW (row));
+	if (device == self->device) {
+		gfu_main_invalidate (self, GFU_MAIN_SECTION_DEVICE | GFU_MAIN_SECTION_ACTIONS);
+		gfu_main_refresh_ui (self);
 	}
+
+	/* a new version may split or join a group, done once for a whole reply */
+	if (!gfu_device_store_get_groups_valid (self->devices) && self->groups_refresh_id == 0)
+		self->groups_refresh_id = g_idle_add (gfu_main_refresh_groups_cb, self);
 }
 
 static void
-gfu_main_device_removed_cb (FwupdClient *client, FwupdDevice *device, GfuMain *self)
+gfu_main_device_added_cb (FwupdClient *client, FwupdDevice *device, GfuMain *self)
+{
+	/* ignore if device can't be updated */
+	if (!fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+		return;
+	gfu_device_store_add (self->devices, device);
+}
+
+static void
+gfu_main_remove_device (GfuMain *self, FwupdDevice *device)
 {
-	GtkContainer *w;
-	g_autofree GfuDeviceRowHelper *rowcheck = g_new0 (GfuDeviceRowHelper, 1);
+	g_autofree gchar *device_id = g_strdup (fwupd_device_get_id (device));
 
-	w = GTK_CONTAINER (gtk_builder_get_object (self->builder, "listbox_main"));
+	/* drop any cached release rows, unless they are being shown */
+	if (g_hash_table_lookup (self->release_rows, device_id) != self->release_rows_current)
+		g_hash_table_remove (self->release_rows, device_id);
 
-	/* package data */
-	rowcheck->list = GTK_LIST_BOX (w);
-	rowcheck->row = device;
+	/* if the removed row was selected, the first row gets selected */
+	gfu_device_store_remove (self->devices, device_id);
+}
 
-	gtk_container_foreach (w, (GtkCallback) gfu_main_remove_device_from_list, rowcheck);
+static void
+gfu_main_device_removed_cb (FwupdClient *client, FwupdDevice *device, GfuMain *self)
+{
+	gfu_main_remove_device (self, device);
 }
 
 static void
-gfu_main_reboot_shutdown_prompt (GfuMain *self)
+gfu_main_reboot_shutdown_prompt (GfuMain *self, guint64 flags)
 {
 	g_autoptr(GError) error = NULL;
-	guint64 flags = fwupd_device_get_flags (self->device);
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("install", "reboot-prompt");
 
 	/* if successful, prompt for reboot */
 	// FIXME: handle with device::changed instead of removing
@@ -531,6 +836,7 @@ gfu_main_reboot_shutdown_prompt (GfuMain *self)
 		/* shutdown prompt */
 		GtkWindow *window;
 		GtkWidget *dialog;
+		g_autoptr(GfuMainScope) scope = NULL;
 
 		window = GTK_WINDOW (gtk_builder_get_object (self->builder, "dialog_main"));
 		dialog = gtk_message_dialog_new (window,
@@ -543,18 +849,11 @@ gfu_main_reboot_shutdown_prompt (GfuMain *self)
 							  "Shutdown now?");
 		switch (gtk_dialog_run (GTK_DIALOG (dialog))) {
 		case GTK_RESPONSE_YES:
+			scope = gfu_main_scope_push (self, "logind shutdown");
 			if (!gfu_common_system_shutdown (&error)) {
 				/* remove device from list until system is rebooted */
-				GtkContainer *w;
-				g_autofree GfuDeviceRowHelper *rowcheck = g_new0 (GfuDeviceRowHelper, 1);
-				w = GTK_CONTAINER (gtk_builder_get_object (self->builder, "listbox_main"));
-
-				/* package data */
-				rowcheck->list = GTK_LIST_BOX (w);
-				rowcheck->row = self->device;
-
-				/* remove corresponding device */
-				gtk_container_foreach (w, (GtkCallback) gfu_main_remove_device_from_list, rowcheck);
+				if (self->device != NULL)
+					gfu_main_remove_device (self, self->device);
 
 				g_debug ("Failed to shutdown device: %s\n", error->message);
 
@@ -574,6 +873,7 @@ gfu_main_reboot_shutdown_prompt (GfuMain *self)
 		/* shutdown prompt */
 		GtkWindow *window;
 		GtkWidget *dialog;
+		g_autoptr(GfuMainScope) scope = NULL;
 
 		window = GTK_WINDOW (gtk_builder_get_object (self->builder, "dialog_main"));
 		dialog = gtk_message_dialog_new (window,
@@ -586,18 +886,11 @@ gfu_main_reboot_shutdown_prompt (GfuMain *self)
 							  "Restart now?");
 		switch (gtk_dialog_run (GTK_DIALOG (dialog))) {
 		case GTK_RESPONSE_YES:
+			scope = gfu_main_scope_push (self, "logind reboot");
 			if (!gfu_common_system_reboot (&error)) {
 				/* remove device from list until system is rebooted */
-				GtkContainer *w;
-				g_autofree GfuDeviceRowHelper *rowcheck = g_new0 (GfuDeviceRowHelper, 1);
-				w = GTK_CONTAINER (gtk_builder_get_object (self->builder, "listbox_main"));
-
-				/* package data */
-				rowcheck->list = GTK_LIST_BOX (w);
-				rowcheck->row = self->device;
-
-				/* remove corresponding device */
-				gtk_container_foreach (w, (GtkCallback) gfu_main_remove_device_from_list, rowcheck);
+				if (self->device != NULL)
+					gfu_main_remove_device (self, self->device);
 
 				g_debug ("Failed to reboot device: %s\n", error->message);
 
@@ -632,6 +925,7 @@ gfu_main_update_remotes_cb (GObject *source_object, GAsyncResult *res, gpointer
 	GtkWidget *w;
 	gboolean disabled_lvfs_remote = FALSE;
 	gboolean enabled_any_download_remote = FALSE;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("dbus", "GetRemotes");
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GVariant) val = g_dbus_proxy_call_finish (self->proxy, res, &error);
 	g_autoptr(GPtrArray) remotes = NULL;
@@ -658,306 +952,367 @@ gfu_main_update_remotes_cb (GObject *source_object, GAsyncResult *res, gpointer
 		}
 	}
 
+	self->lvfs_disabled = disabled_lvfs_remote && !enabled_any_download_remote;
+	if (self->builder == NULL)
+		return;
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "infobar_enable_lvfs"));
-	gtk_info_bar_set_revealed (GTK_INFO_BAR (w),
-				   disabled_lvfs_remote && !enabled_any_download_remote);
+	gtk_info_bar_set_revealed (GTK_INFO_BAR (w), self->lvfs_disabled);
 }
 
+static void gfu_main_update_title (GfuMain *self);
+static void gfu_main_update_releases (GfuMain *self, const gchar *device_id);
+
+/* the device the releases were asked for, as the selection may change */
+typedef struct {
+	GfuMain *self;
+	gchar *device_id;
+} GfuReleasesHelper;
+
 static void
-gfu_main_update_devices_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+gfu_main_releases_helper_free (GfuReleasesHelper *helper)
 {
-	GtkWidget *w;
-	GtkWidget *l = NULL;
-	GfuMain *self = (GfuMain *) user_data;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) devices = NULL;
-	g_autoptr(GVariant) tmp = g_dbus_proxy_call_finish (self->proxy, res, &error);
-
-	if (tmp == NULL) {
-		gfu_main_error_dialog (self, _("Failed to load device list"), error->message);
-		return;
-	}
+	g_free (helper->device_id);
+	g_free (helper);
+}
 
-	devices = fwupd_device_array_from_variant (tmp);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuReleasesHelper, gfu_main_releases_helper_free)
 
-	/* create a row in the listbox for each updatable device */
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_main"));
-	for (guint i = 0; i < devices->len; i++) {
-		FwupdDevice *device = g_ptr_array_index (devices, i);
-		/* skip devices that can't be updated */
-		if (!fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE) &&
-		    !fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_LOCKED)) {
-			g_debug ("ignoring non-updatable device: %s", fwupd_device_get_name (device));
-			continue;
-		}
-		l = gfu_device_row_new (device);
-		gtk_widget_set_visible (l, TRUE);
-		gtk_list_box_insert (GTK_LIST_BOX (w), l, -1);
-	}
+/* the last known devices and releases, shown until the daemon replies */
 
-	/* if no row is selected and there are rows in the list, select the first one */
-	if (gtk_list_box_get_selected_row (GTK_LIST_BOX (w)) == NULL && l != NULL) {
-		gtk_list_box_select_row (GTK_LIST_BOX (w),
-					 gtk_list_box_get_row_at_index (GTK_LIST_BOX (w), 0));
-	}
+static gboolean
+gfu_main_snapshot_save (GfuMain *self, GError **error)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder;
+	gpointer key, value;
+	g_autofree gchar *fn = gfu_get_user_cache_path ("snapshot.gvariant");
+	g_autoptr(GVariant) snapshot = NULL;
+	g_autoptr(GfuMainScope) scope = gfu_main_scope_push (self, "snapshot save");
+
+	if (self->snapshot_devices == NULL)
+		return TRUE;
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_hash_table_iter_init (&iter, self->snapshot_releases);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&builder, "{sv}", (const gchar *) key, (GVariant *) value);
+	snapshot = g_variant_ref_sink (g_variant_new ("(u@(aa{sv})a{sv})",
+						      (guint32) GFU_MAIN_SNAPSHOT_VERSION,
+						      self->snapshot_devices,
+						      &builder));
+	if (!gfu_common_mkdir_parent (fn, error))
+		return FALSE;
+	return g_file_set_contents (fn,
+				    g_variant_get_data (snapshot),
+				    g_variant_get_size (snapshot),
+				    error);
 }
 
-static void
-gfu_main_update_releases_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+static gboolean
+gfu_main_snapshot_save_cb (gpointer user_data)
 {
-	GtkWidget *w;
 	GfuMain *self = (GfuMain *) user_data;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GVariant) tmp = g_dbus_proxy_call_finish (self->proxy, res, &error);
-	if (tmp == NULL) {
-		/* No firmware found for this devices */
-		g_debug ("ignoring: %s", error->message);
-		return;
-	}
-	self->releases = fwupd_release_array_from_variant (tmp);
 
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_firmware"));
-	gfu_main_container_remove_all (GTK_CONTAINER (w));
-	for (guint i = 0; i < self->releases->len; i++) {
-		FwupdRelease *release = g_ptr_array_index (self->releases, i);
-		GtkWidget *l = gfu_release_row_new (release);
-		gtk_widget_set_visible (l, TRUE);
-		gtk_list_box_insert (GTK_LIST_BOX (w), l, -1);
-	}
+	self->snapshot_save_id = 0;
+	if (!gfu_main_snapshot_save (self, &error))
+		g_debug ("failed to save snapshot: %s", error->message);
+	return FALSE;
+}
 
-	gfu_main_refresh_ui (self);
+static void
+gfu_main_snapshot_queue_save (GfuMain *self)
+{
+	/* replies tend to come in bursts */
+	if (self->snapshot_save_id == 0)
+		self->snapshot_save_id = g_timeout_add_seconds (2, gfu_main_snapshot_save_cb, self);
 }
 
-/* installation code, some from fwupd-client */
+static gboolean
+gfu_main_snapshot_load (GfuMain *self, GError **error)
+{
+	GVariantIter iter;
+	GVariant *value;
+	gchar *data = NULL;
+	gchar *key;
+	gsize len = 0;
+	guint32 version = 0;
+	g_autofree gchar *fn = gfu_get_user_cache_path ("snapshot.gvariant");
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GVariant) devices_reply = NULL;
+	g_autoptr(GVariant) releases = NULL;
+	g_autoptr(GVariant) snapshot = NULL;
+
+	if (!g_file_get_contents (fn, &data, &len, error))
+		return FALSE;
+
+	/* untrusted, so malformed data reads back as empty values */
+	snapshot = g_variant_ref_sink (g_variant_new_from_data (G_VARIANT_TYPE (GFU_MAIN_SNAPSHOT_TYPE),
+								data, len, FALSE,
+								g_free, data));
+	g_variant_get (snapshot, "(u@(aa{sv})@a{sv})", &version, &devices_reply, &releases);
+	if (version != GFU_MAIN_SNAPSHOT_VERSION) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "snapshot version %u not supported", version);
+		return FALSE;
+	}
+	g_variant_iter_init (&iter, releases);
+	while (g_variant_iter_next (&iter, "{sv}", &key, &value))
+		g_hash_table_insert (self->snapshot_releases, key, value);
+
+	devices = gfu_common_device_array_from_variant (devices_reply);
+	g_debug ("loaded snapshot of %u devices", devices->len);
+	self->snapshot_devices = g_steal_pointer (&devices_reply);
+	self->stale = TRUE;
+	gfu_device_store_set_devices (self->devices, devices);
+	return TRUE;
+}
 
 static void
-gfu_main_set_install_loading_label (GfuMain *self, gchar *text)
+gfu_main_update_devices_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
-	GtkLabel *label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_device_label"));
-	gtk_label_set_label (label, text);
-	label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_release_label"));
-	gtk_label_set_label (label, text);
+	GfuMain *self = (GfuMain *) user_data;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("dbus", "GetDevices");
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GVariant) tmp = g_dbus_proxy_call_finish (self->proxy, res, &error);
+
+	if (tmp == NULL) {
+		gfu_main_error_dialog (self, _("Failed to load device list"), error->message);
+		return;
+	}
+
+	/* only updatable or locked devices are returned */
+	devices = gfu_common_device_array_from_variant (tmp);
+	gfu_device_store_set_devices (self->devices, devices);
+	gfu_main_select_first_device (self);
+
+	/* only what the rows show is kept for next time */
+	g_clear_pointer (&self->snapshot_devices, g_variant_unref);
+	self->snapshot_devices = g_variant_ref_sink (gfu_common_device_array_to_snapshot (devices));
+	gfu_main_snapshot_queue_save (self);
+	if (self->stale) {
+		self->stale = FALSE;
+		gfu_main_update_title (self);
+		if (self->device != NULL &&
+		    fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_UPDATABLE)) {
+			gfu_main_update_releases (self, fwupd_device_get_id (self->device));
+		}
+		gfu_main_invalidate (self, GFU_MAIN_SECTION_ALL);
+		gfu_main_refresh_ui (self);
+	}
 }
 
 static void
-gfu_main_set_install_status_label (GfuMain *self, gchar *text)
+gfu_main_releases_pending_stop (GfuMain *self)
 {
-	GtkLabel *label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_device_status_label"));
-	gtk_label_set_label (label, text);
-	label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_release_status_label"));
-	gtk_label_set_label (label, text);
-	g_debug ("Updated status label: %s", text);
+	if (self->releases_pending_id != 0) {
+		g_source_remove (self->releases_pending_id);
+		self->releases_pending_id = 0;
+	}
 }
 
 static void
-gfu_main_show_install_loading (GfuMain *self, gboolean show)
+gfu_main_add_release_row (GfuMain *self, guint idx)
 {
-	GtkWidget *w = GTK_WIDGET (gtk_builder_get_object (self->builder, "dialog_main"));
-	gtk_widget_set_sensitive (w, !show);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "install_spinner_device"));
-	gtk_widget_set_visible (w, show);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "install_spinner_release"));
-	gtk_widget_set_visible (w, show);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "box_release_metadata"));
-	gtk_widget_set_visible (w, !show);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "box_device_metadata"));
-	gtk_widget_set_visible (w, !show);
+	FwupdRelease *release = g_ptr_array_index (self->releases, idx);
+	GPtrArray *rows = self->release_rows_current;
+	GtkWidget *w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_firmware"));
+	GtkWidget *l;
+
+	if (idx < rows->len) {
+		l = g_ptr_array_index (rows, idx);
+		gfu_release_row_set_release (GFU_RELEASE_ROW (l), release);
+		gfu_stats_inc (GFU_STATS_COUNTER_ROWS_REUSED);
+	} else {
+		l = gfu_release_row_new (release);
+		g_ptr_array_add (rows, g_object_ref_sink (l));
+		gfu_stats_inc (GFU_STATS_COUNTER_ROWS_CREATED);
+	}
+	gtk_widget_set_visible (l, TRUE);
+	gtk_list_box_insert (GTK_LIST_BOX (w), l, -1);
 }
 
-static void
-gfu_main_download_chunk_cb (SoupMessage *msg, SoupBuffer *chunk, gpointer user_data)
+static gboolean
+gfu_main_releases_pending_cb (gpointer user_data)
 {
-	guint percentage;
-	goffset header_size;
-	goffset body_length;
 	GfuMain *self = (GfuMain *) user_data;
+	gint64 deadline = g_get_monotonic_time () + GFU_MAIN_RELEASES_BATCH_BUDGET;
 
-	/* if it's returning "Found" or an error, ignore the percentage */
-	if (msg->status_code != SOUP_STATUS_OK) {
-		g_debug ("ignoring status code %u (%s)",
-			 msg->status_code, msg->reason_phrase);
-		return;
+	/* give the frame clock a chance to run between batches */
+	while (self->releases_pending_idx < self->releases->len) {
+		gfu_main_add_release_row (self, self->releases_pending_idx++);
+		if (g_get_monotonic_time () > deadline)
+			return TRUE;
 	}
+	self->releases_pending_id = 0;
+	return FALSE;
+}
 
-	/* get data */
-	body_length = msg->response_body->length;
-	header_size = soup_message_headers_get_content_length (msg->response_headers);
+static void
+gfu_main_release_rows_rebuild (GfuMain *self)
+{
+	GtkWidget *w;
+	const gchar *device_id;
+	guint n_screenful;
 
-	/* size is not known */
-	if (header_size < body_length)
+	/* nothing to show them in yet */
+	gfu_main_releases_pending_stop (self);
+	if (self->box_firmware == NULL || self->releases == NULL || self->device == NULL)
 		return;
 
-	/* calculate percentage */
-	percentage = (guint) ((100 * body_length) / header_size);
-	g_debug ("progress: %u%%", percentage);
-	gfu_main_set_install_loading_label (self, g_strdup_printf ("%s (%u%%)",
-								   _("Downloading"),
-								   percentage));
+	/* rows are kept alive by the cache when removed */
+	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_firmware"));
+	gfu_main_container_remove_all (GTK_CONTAINER (w));
+	device_id = fwupd_device_get_id (self->device);
+	self->release_rows_current = g_hash_table_lookup (self->release_rows, device_id);
+	if (self->release_rows_current == NULL) {
+		self->release_rows_current = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		g_hash_table_insert (self->release_rows,
+				     g_strdup (device_id),
+				     self->release_rows_current);
+	}
+	if (self->release_rows_current->len > self->releases->len)
+		g_ptr_array_set_size (self->release_rows_current, self->releases->len);
+
+	/* show the first screenful now, and the rest when idle */
+	n_screenful = MIN (self->releases->len, GFU_MAIN_RELEASES_SCREENFUL);
+	for (guint i = 0; i < n_screenful; i++)
+		gfu_main_add_release_row (self, i);
+	self->releases_pending_idx = n_screenful;
+	if (n_screenful < self->releases->len)
+		self->releases_pending_id = g_idle_add (gfu_main_releases_pending_cb, self);
 }
 
-static gboolean
-gfu_main_download_file (GfuMain *self,
-			SoupURI *uri,
-			const gchar *fn,
-			const gchar *checksum_expected,
-			GError **error)
-{
-	GChecksumType checksum_type;
-	guint status_code;
-	g_autoptr(GError) error_local = NULL;
-	g_autofree gchar *checksum_actual = NULL;
-	g_autofree gchar *uri_str = NULL;
-	g_autoptr(SoupMessage) msg = NULL;
+static void
+gfu_main_set_releases (GfuMain *self, GVariant *tmp, gboolean live)
+{
+	/* heavy fields are only decoded when the release is shown */
+	g_clear_pointer (&self->releases, g_ptr_array_unref);
+	self->releases = gfu_common_release_array_from_variant (tmp);
+	self->releases_live = live;
+	gfu_main_release_rows_rebuild (self);
 
-	/* check if the file already exists with the right checksum */
-	checksum_type = fwupd_checksum_guess_kind (checksum_expected);
-	if (gfu_common_file_exists_with_checksum (fn, checksum_expected, checksum_type)) {
-		g_debug ("skipping download as file already exists");
-		gfu_main_set_install_loading_label (self, _("File already downloaded..."));
-		return TRUE;
+	/* a release picked from the snapshot has no checksums or description */
+	if (self->release != NULL) {
+		FwupdRelease *release = NULL;
+		for (guint i = 0; i < self->releases->len; i++) {
+			FwupdRelease *release_tmp = g_ptr_array_index (self->releases, i);
+			if (g_strcmp0 (fwupd_release_get_version (release_tmp),
+				       fwupd_release_get_version (self->release)) == 0) {
+				release = release_tmp;
+				break;
+			}
+		}
+		g_set_object (&self->release, release);
 	}
 
-	/* set up networking */
-	if (self->soup_session == NULL) {
-		self->soup_session = gfu_common_setup_networking (error);
-		if (self->soup_session == NULL)
-			return FALSE;
-	}
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_RELEASE | GFU_MAIN_SECTION_ACTIONS);
+	gfu_main_refresh_ui (self);
+}
 
-	/* download data */
-	uri_str = soup_uri_to_string (uri, FALSE);
-	g_debug ("downloading %s to %s", uri_str, fn);
-	gfu_main_set_install_loading_label (self, _("Downloading file..."));
-	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
-	if (msg == NULL) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "Failed to parse URI %s", uri_str);
-		return FALSE;
-	}
-	if (g_str_has_suffix (uri_str, ".asc") ||
-	    g_str_has_suffix (uri_str, ".p7b") ||
-	    g_str_has_suffix (uri_str, ".p7c")) {
-		/* TRANSLATORS: downloading new signing file */
-		g_debug ("%s %s\n", _("Fetching signature"), uri_str);
-		gfu_main_set_install_loading_label (self, _("Fetching signature..."));
-	} else if (g_str_has_suffix (uri_str, ".gz")) {
-		/* TRANSLATORS: downloading new metadata file */
-		g_debug ("%s %s\n", _("Fetching metadata"), uri_str);
-		gfu_main_set_install_loading_label (self, _("Fetching metadata..."));
-	} else if (g_str_has_suffix (uri_str, ".cab")) {
-		/* TRANSLATORS: downloading new firmware file */
-		g_debug ("%s %s\n", _("Fetching firmware"), uri_str);
-		gfu_main_set_install_loading_label (self, _("Fetching firmware..."));
-	} else {
-		/* TRANSLATORS: downloading unknown file */
-		g_debug ("%s %s\n", _("Fetching file"), uri_str);
-		gfu_main_set_install_loading_label (self, _("Fetching file..."));
-	}
-	g_signal_connect (msg, "got-chunk",
-			  G_CALLBACK (gfu_main_download_chunk_cb), self);
-	status_code = soup_session_send_message (self->soup_session, msg);
-	g_debug ("\n");
-	if (status_code == 429) {
-		g_autofree gchar *str = g_strndup (msg->response_body->data,
-						   msg->response_body->length);
-		if (g_strcmp0 (str, "Too Many Requests") == 0) {
-			g_set_error (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     /* TRANSLATORS: the server is rate-limiting downloads */
-				     "%s", _("Failed to download due to server limit"));
-			return FALSE;
-		}
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     _("Failed to download due to server limit: %s"), str);
-		return FALSE;
-	}
-	if (status_code != SOUP_STATUS_OK) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     _("Failed to download %s: %s"),
-			     uri_str, soup_status_get_phrase (status_code));
-		return FALSE;
+static void
+gfu_main_update_releases_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GfuReleasesHelper) helper = (GfuReleasesHelper *) user_data;
+	GfuMain *self = helper->self;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("dbus", "GetReleases");
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) tmp = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (tmp == NULL) {
+		/* No firmware found for this devices */
+		g_debug ("ignoring: %s", error->message);
+		return;
 	}
 
-	/* verify checksum */
-	if (checksum_expected != NULL) {
-		checksum_actual = g_compute_checksum_for_data (checksum_type,
-							       (guchar *) msg->response_body->data,
-							       (gsize) msg->response_body->length);
-		if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
-			g_set_error (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     _("Checksum invalid, expected %s got %s"),
-				     checksum_expected, checksum_actual);
-			return FALSE;
-		}
-	}
+	/* only the summaries are kept for next time */
+	g_hash_table_insert (self->snapshot_releases,
+			     g_strdup (helper->device_id),
+			     g_variant_ref_sink (gfu_common_release_reply_strip_details (tmp)));
+	gfu_main_snapshot_queue_save (self);
 
-	/* save file */
-	if (!g_file_set_contents (fn,
-				  msg->response_body->data,
-				  msg->response_body->length,
-				  &error_local)) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_WRITE,
-			     _("Failed to save file: %s"),
-			     error_local->message);
-		return FALSE;
-	}
-	return TRUE;
+	/* another device was selected while waiting */
+	if (self->device == NULL ||
+	    g_strcmp0 (fwupd_device_get_id (self->device), helper->device_id) != 0)
+		return;
+	gfu_main_set_releases (self, tmp, TRUE);
 }
 
-static gboolean
-gfu_main_download_metadata_for_remote (GfuMain *self,
-				       FwupdRemote *remote,
-				       GError **error)
-{
-	g_autofree gchar *basename_asc = NULL;
-	g_autofree gchar *basename_id_asc = NULL;
-	g_autofree gchar *basename_id = NULL;
-	g_autofree gchar *basename = NULL;
-	g_autofree gchar *filename = NULL;
-	g_autofree gchar *filename_asc = NULL;
-	g_autoptr(SoupURI) uri = NULL;
-	g_autoptr(SoupURI) uri_sig = NULL;
+static void
+gfu_main_update_releases (GfuMain *self, const gchar *device_id)
+{
+	GfuReleasesHelper *helper = g_new0 (GfuReleasesHelper, 1);
+	helper->self = self;
+	helper->device_id = g_strdup (device_id);
+	g_dbus_proxy_call (self->proxy,
+			   "GetReleases",
+			   g_variant_new ("(s)", device_id),
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1,
+			   self->cancellable,
+			   (GAsyncReadyCallback) gfu_main_update_releases_cb,
+			   helper);
+}
 
-	/* generate some plausible local filenames */
-	basename = g_path_get_basename (fwupd_remote_get_filename_cache (remote));
-	basename_id = g_strdup_printf ("%s-%s", fwupd_remote_get_id (remote), basename);
+/* installation code, some from fwupd-client */
 
-	/* download the metadata */
-	filename = gfu_get_user_cache_path (basename_id);
-	gfu_main_set_install_loading_label (self, _("Creating cache path..."));
-	if (!gfu_common_mkdir_parent (filename, error))
-		return FALSE;
-	uri = soup_uri_new (fwupd_remote_get_metadata_uri (remote));
-	gfu_main_set_install_loading_label (self, _("Preparing to download file..."));
-	if (!gfu_main_download_file (self, uri, filename, NULL, error))
-		return FALSE;
+static void
+gfu_main_set_install_loading_label (GfuMain *self, const gchar *text)
+{
+	GtkLabel *label;
 
-	/* download the signature */
-	basename_asc = g_path_get_basename (fwupd_remote_get_filename_cache_sig (remote));
-	basename_id_asc = g_strdup_printf ("%s-%s", fwupd_remote_get_id (remote), basename_asc);
-	filename_asc = gfu_get_user_cache_path (basename_id_asc);
-	uri_sig = soup_uri_new (fwupd_remote_get_metadata_uri_sig (remote));
-	gfu_main_set_install_loading_label (self, _("Preparing to download file..."));
-	if (!gfu_main_download_file (self, uri_sig, filename_asc, NULL, error))
-		return FALSE;
+	if (self->builder == NULL)
+		return;
+	label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_device_label"));
+	gtk_label_set_label (label, text);
+	if (self->box_firmware == NULL)
+		return;
+	label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_release_label"));
+	gtk_label_set_label (label, text);
+}
+
+static void
+gfu_main_engine_status_changed_cb (GfuEngine *engine, const gchar *text, GfuMain *self)
+{
+	gfu_main_set_install_loading_label (self, text);
+}
+
+static void
+gfu_main_set_install_status_label (GfuMain *self, const gchar *text)
+{
+	GtkLabel *label;
+
+	g_debug ("Updated status label: %s", text);
+	if (self->builder == NULL)
+		return;
+	label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_device_status_label"));
+	gtk_label_set_label (label, text);
+	if (self->box_firmware == NULL)
+		return;
+	label = GTK_LABEL (gtk_builder_get_object (self->builder, "install_spinner_release_status_label"));
+	gtk_label_set_label (label, text);
+}
+
+static void
+gfu_main_show_install_loading (GfuMain *self, gboolean show)
+{
+	GtkWidget *w;
 
-	/* send all this to fwupd */
-	return fwupd_client_update_metadata (self->client,
-					     fwupd_remote_get_id (remote),
-					     filename,
-					     filename_asc,
-					     NULL, error);
+	if (self->builder == NULL)
+		return;
+	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "dialog_main"));
+	gtk_widget_set_sensitive (w, !show);
+	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "install_spinner_device"));
+	gtk_widget_set_visible (w, show);
+	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "box_device_metadata"));
+	gtk_widget_set_visible (w, !show);
+	if (self->box_firmware == NULL)
+		return;
+	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "install_spinner_release"));
+	gtk_widget_set_visible (w, show);
+	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "box_release_metadata"));
+	gtk_widget_set_visible (w, !show);
 }
 
 static void
@@ -966,6 +1321,7 @@ gfu_main_enable_lvfs_cb (GtkWidget *widget, GfuMain *self)
 	GtkWidget *w;
 	g_autoptr(FwupdRemote) remote = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GfuMainScope) scope = gfu_main_scope_push (self, "enable LVFS");
 
 	/* hide notification */
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "infobar_enable_lvfs"));
@@ -986,7 +1342,7 @@ gfu_main_enable_lvfs_cb (GtkWidget *widget, GfuMain *self)
 		gfu_main_show_install_loading (self, FALSE);
 		return;
 	}
-	if (!gfu_main_download_metadata_for_remote (self, remote, &error)) {
+	if (!gfu_engine_refresh_remote (self->engine, remote, &error)) {
 		gfu_main_error_dialog (self, _("Failed to download metadata for LVFS"), error->message);
 		gfu_main_show_install_loading (self, FALSE);
 		return;
@@ -997,30 +1353,14 @@ gfu_main_enable_lvfs_cb (GtkWidget *widget, GfuMain *self)
 static gboolean
 gfu_main_download_metadata (GfuMain *self, GError **error)
 {
-	g_autoptr(GPtrArray) remotes = NULL;
+	gboolean ret;
+	g_autoptr(GfuMainScope) scope = gfu_main_scope_push (self, "metadata refresh");
 
 	/* begin downloading, show loading animation */
 	gfu_main_show_install_loading (self, TRUE);
-
-	remotes = fwupd_client_get_remotes (self->client, NULL, error);
-	if (remotes == NULL) {
-		gfu_main_show_install_loading (self, FALSE);
-		return FALSE;
-	}
-	for (guint i = 0; i < remotes->len; i++) {
-		FwupdRemote *remote = g_ptr_array_index (remotes, i);
-		if (!fwupd_remote_get_enabled (remote))
-			continue;
-		if (fwupd_remote_get_kind (remote) != FWUPD_REMOTE_KIND_DOWNLOAD)
-			continue;
-		if (!gfu_main_download_metadata_for_remote (self, remote, error)) {
-			gfu_main_show_install_loading (self, FALSE);
-			return FALSE;
-		}
-	}
-
+	ret = gfu_engine_refresh_metadata (self->engine, 0, error);
 	gfu_main_show_install_loading (self, FALSE);
-	return TRUE;
+	return ret;
 }
 
 static void
@@ -1032,149 +1372,567 @@ gfu_main_activate_refresh_metadata (GSimpleAction *simple, GVariant *parameter,
 		gfu_main_error_dialog (self, _("Failed to download metadata"), error->message);
 }
 
+static gboolean
+gfu_main_install_file_to_device (GfuMain *self,
+				 FwupdDevice *dev,
+				 const gchar *fn,
+				 GError **error)
+{
+	gboolean ret;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GfuMainScope) scope = gfu_main_scope_push (self, "install");
+
+	/* learn how long each phase takes for next time */
+	gfu_estimator_start (self->estimator, dev);
+	ret = gfu_engine_install (self->engine, dev, fn, self->flags, error);
+	if (!gfu_estimator_finish (self->estimator, ret, &error_local))
+		g_warning ("failed to save install durations: %s", error_local->message);
+	return ret;
+}
+
+static gchar *
+gfu_main_fetch_release (GfuMain *self, FwupdRelease *rel, GError **error)
+{
+	g_autoptr(GfuMainScope) scope = gfu_main_scope_push (self, "download");
+	return gfu_engine_fetch_release (self->engine, rel, error);
+}
+
+static gboolean
+gfu_main_install_fetched_to_device (GfuMain *self,
+				    FwupdDevice *dev,
+				    const gchar *fn,
+				    GError **error)
+{
+	g_autofree gchar *install_str = NULL;
+
+	install_str = gfu_operation_to_string (self->current_operation, dev);
+	gfu_main_set_install_loading_label (self, install_str);
+	return gfu_main_install_file_to_device (self, dev, fn, error);
+}
+
 static gboolean
 gfu_main_install_release_to_device (GfuMain *self,
 				    FwupdDevice *dev,
 				    FwupdRelease *rel,
 				    GError **error)
 {
-	GPtrArray *checksums;
-	const gchar *remote_id;
-	const gchar *uri_tmp;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("install", "install-release");
 	g_autofree gchar *fn = NULL;
-	g_autofree gchar *uri_str = NULL;
-	g_autofree gchar *install_str = NULL;
-	g_autoptr(SoupURI) uri = NULL;
 
-	/* work out what remote-specific URI fields this should use */
-	uri_tmp = fwupd_release_get_uri (rel);
-	remote_id = fwupd_release_get_remote_id (rel);
-	if (remote_id != NULL) {
-		g_autoptr(FwupdRemote) remote = NULL;
-		remote = fwupd_client_get_remote_by_id (self->client,
-							remote_id,
-							NULL,
-							error);
-		if (remote == NULL)
-			return FALSE;
+	gfu_trace_span_add_arg (span, "device", fwupd_device_get_id (dev));
+	gfu_trace_span_add_arg (span, "version", fwupd_release_get_version (rel));
+	fn = gfu_main_fetch_release (self, rel, error);
+	if (fn == NULL)
+		return FALSE;
+	return gfu_main_install_fetched_to_device (self, dev, fn, error);
+}
 
-		/* local and directory remotes have the firmware already */
-		if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_LOCAL) {
-			const gchar *fn_cache = fwupd_remote_get_filename_cache (remote);
-			g_autofree gchar *path = g_path_get_dirname (fn_cache);
+static gboolean
+gfu_main_install_release_to_group (GfuMain *self,
+				   GPtrArray *group,
+				   FwupdRelease *rel,
+				   GError **error)
+{
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GString) failed = g_string_new (NULL);
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("install", "install-group");
 
-			fn = g_build_filename (path, uri_tmp, NULL);
-		} else if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
-			fn = g_strdup (uri_tmp + 7);
-		}
-		/* install with flags chosen by the user */
-		if (fn != NULL) {
-			return fwupd_client_install (self->client,
-						     fwupd_device_get_id (dev),
-						     fn, self->flags, NULL, error);
-		}
+	gfu_trace_span_add_arg (span, "version", fwupd_release_get_version (rel));
 
-		uri_str = fwupd_remote_build_firmware_uri (remote, uri_tmp, error);
-		if (uri_str == NULL)
-			return FALSE;
-	} else {
-		uri_str = g_strdup (uri_tmp);
-	}
-
-	/* download file */
-	g_debug ("Downloading %s for %s...\n",
-		 fwupd_release_get_version (rel),
-		 fwupd_device_get_name (dev));
-	gfu_main_set_install_loading_label (self, _("Preparing to download file..."));
-	/* place in gfu cache directory */
-	fn = gfu_get_user_cache_path (uri_str);
-	/* TRANSLATORS: creating directory for the firmware download */
-	gfu_main_set_install_loading_label (self, _("Creating cache path..."));
-	if (!gfu_common_mkdir_parent (fn, error))
+	/* the payload is downloaded and verified once for all the devices */
+	fn = gfu_main_fetch_release (self, rel, error);
+	if (fn == NULL)
 		return FALSE;
-	checksums = fwupd_release_get_checksums (rel);
-	uri = soup_uri_new (uri_str);
-	if (!gfu_main_download_file (self, uri, fn,
-				    fwupd_checksum_get_best (checksums),
-				    error))
+
+	/* the daemon flashes one device at a time, so keep going on failure */
+	for (guint i = 0; i < group->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (group, i);
+		const gchar *serial = fwupd_device_get_serial (dev);
+		g_autoptr(GError) error_local = NULL;
+		if (!gfu_main_install_fetched_to_device (self, dev, fn, &error_local)) {
+			g_string_append_printf (failed, "%s: %s\n",
+						serial != NULL ? serial : fwupd_device_get_id (dev),
+						error_local->message);
+		}
+	}
+	if (failed->len > 0) {
+		g_string_truncate (failed, failed->len - 1);
+		g_set_error_literal (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL, failed->str);
 		return FALSE;
-	/* if the device specifies ONLY_OFFLINE automatically set this flag */
-	if (fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_ONLY_OFFLINE))
-		self->flags |= FWUPD_INSTALL_FLAG_OFFLINE;
-	install_str = gfu_operation_to_string (self->current_operation, dev);
-	gfu_main_set_install_loading_label (self, install_str);
-	g_timer_start (self->time_elapsed);
-        return fwupd_client_install (self->client,
-				     fwupd_device_get_id (dev), fn,
-				     self->flags, NULL, error);
+	}
+	return TRUE;
 }
 
-/* used to retrieve the current device post-install */
+/* one device in an "update all" run */
 typedef struct {
-	GfuMain *self;
-	gchar *device_id;
-} GfuPostInstallHelper;
+	GfuMain		*self;
+	FwupdDevice	*device;
+	FwupdRelease	*release;
+	gchar		*fn;		/* the verified payload */
+	gchar		*uri;
+	GError		*error;
+	gboolean	 asking;	/* for the upgrades, only when prefetching */
+	gboolean	 fetching;
+	gboolean	 fetched;
+	gboolean	 installed;
+	gboolean	 covered;	/* updated by the parent composite update */
+	gpointer	 parent;	/* closest GfuUpdateAllJob ancestor */
+} GfuUpdateAllJob;
 
 static void
-gfu_main_update_devices_post_install_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+gfu_main_update_all_job_free (GfuUpdateAllJob *job)
 {
-	GtkContainer *w;
-	GtkWidget *l = NULL;
-	GPtrArray *devices;
-	GfuPostInstallHelper *helper = (GfuPostInstallHelper*)user_data;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GVariant) tmp = g_dbus_proxy_call_finish (helper->self->proxy, res, &error);
-
-	/* clear out device list */
-	w = GTK_CONTAINER (gtk_builder_get_object (helper->self->builder, "listbox_main"));
-	gtk_list_box_unselect_all (GTK_LIST_BOX (w));
-	gtk_container_foreach (w, (GtkCallback) gfu_main_remove_row, w);
+	g_object_unref (job->device);
+	if (job->release != NULL)
+		g_object_unref (job->release);
+	g_free (job->fn);
+	g_free (job->uri);
+	g_clear_error (&job->error);
+	g_free (job);
+}
 
-	if (tmp == NULL) {
-		gfu_main_error_dialog (helper->self, _("Failed to load device list"), error->message);
-		return;
-	}
+static gboolean gfu_main_update_all_next_cb (gpointer user_data);
 
-	devices = fwupd_device_array_from_variant (tmp);
+static void
+gfu_main_update_all_schedule (GfuMain *self)
+{
+	if (self->update_all_id == 0)
+		self->update_all_id = g_idle_add (gfu_main_update_all_next_cb, self);
+}
 
-	/* create a row in the listbox for each updatable device */
-	for (guint i = 0; i < devices->len; i++) {
-		FwupdDevice *device = g_ptr_array_index (devices, i);
-		/* skip devices that can't be updated */
-		if (!fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE) &&
-		    !fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_LOCKED)) {
-			g_debug ("ignoring non-updatable device: %s", fwupd_device_get_name (device));
-			continue;
-		}
-		l = gfu_device_row_new (device);
-		gtk_widget_set_visible (l, TRUE);
-		gtk_list_box_insert (GTK_LIST_BOX (w), l, -1);
-
-		/* update our current device now that new firmware has been installed */
-		if (g_strcmp0 (helper->device_id, fwupd_device_get_id (device)) == 0) {
-			helper->self->device = device;
-			gtk_list_box_select_row (GTK_LIST_BOX (w), GTK_LIST_BOX_ROW (l));
-		}
-	}
+static void
+gfu_main_update_all_fetch_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	GfuUpdateAllJob *job = (GfuUpdateAllJob *) user_data;
+	GfuMain *self = job->self;
+	GPtrArray *checksums = fwupd_release_get_checksums (job->release);
+
+	job->fetching = FALSE;
+	job->fetched = gfu_engine_download_check (msg, job->uri, job->fn,
+						 fwupd_checksum_get_best (checksums),
+						 &job->error);
+	g_debug ("prefetched %s: %s", job->uri,
+		 job->fetched ? "ok" : job->error->message);
+	if (job->fetched)
+		gfu_engine_add_prefetched (self->engine, job->fn);
+
+	/* the flash in progress picks this up when it is done */
+	if (self->update_all != NULL && !self->update_all_flashing)
+		gfu_main_update_all_schedule (self);
+}
 
-	/* reboot or shutdown if necessary (UEFI update) */
-	gfu_main_reboot_shutdown_prompt (helper->self);
+static void
+gfu_main_update_all_fetch_start (GfuMain *self, GfuUpdateAllJob *job)
+{
+	GPtrArray *checksums;
+	SoupMessage *msg;
+	SoupSession *soup_session;
+	g_autoptr(SoupURI) uri = NULL;
 
-	/* if no row is selected and there are rows in the list, select the first one */
-	if (gtk_list_box_get_selected_row (GTK_LIST_BOX (w)) == NULL && l != NULL) {
-		gtk_list_box_select_row (GTK_LIST_BOX (w),
-					 gtk_list_box_get_row_at_index (GTK_LIST_BOX (w), 0));
+	if (job->fetching || job->fetched || job->error != NULL)
+		return;
+	if (!gfu_engine_release_resolve (self->engine, job->release, &job->fn, &job->uri, &job->error))
+		return;
+	if (job->uri == NULL) {
+		job->fetched = TRUE;
+		return;
 	}
+	if (!gfu_common_mkdir_parent (job->fn, &job->error))
+		return;
 
-	/* update release list */
-	g_dbus_proxy_call (helper->self->proxy,
-			   "GetReleases",
-			   g_variant_new ("(s)", helper->device_id),
+	/* check if the file already exists with the right checksum */
+	gfu_common_release_ensure_details (job->release);
+	checksums = fwupd_release_get_checksums (job->release);
+	if (fwupd_checksum_get_best (checksums) == NULL) {
+		g_set_error (&job->error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     _("No checksum to verify version %s"),
+			     fwupd_release_get_version (job->release));
+		return;
+	}
+	if (gfu_common_file_exists_with_checksum (job->fn,
+						  fwupd_checksum_get_best (checksums),
+						  fwupd_checksum_guess_kind (fwupd_checksum_get_best (checksums)))) {
+		job->fetched = TRUE;
+		return;
+	}
+
+	/* set up networking */
+	soup_session = gfu_engine_get_soup_session (self->engine, &job->error);
+	if (soup_session == NULL)
+		return;
+
+	/* runs from the main loop, including while the daemon is flashing */
+	uri = soup_uri_new (job->uri);
+	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
+	if (msg == NULL) {
+		g_set_error (&job->error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     _("Failed to parse URI %s"), job->uri);
+		return;
+	}
+	g_debug ("prefetching %s to %s", job->uri, job->fn);
+	job->fetching = TRUE;
+	gfu_engine_download_watch (msg);
+	soup_session_queue_message (soup_session, msg,
+				    gfu_main_update_all_fetch_cb, job);
+}
+
+static void
+gfu_main_update_all_done (GfuMain *self)
+{
+	GtkWindow *window;
+	GtkWidget *dialog;
+	guint64 flags = 0;
+	guint success = 0;
+	g_autoptr(GPtrArray) jobs = g_steal_pointer (&self->update_all);
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	gfu_main_show_install_loading (self, FALSE);
+	self->flags = FWUPD_INSTALL_FLAG_NONE;
+
+	/* one line for each device */
+	for (guint i = 0; i < jobs->len; i++) {
+		GfuUpdateAllJob *job = g_ptr_array_index (jobs, i);
+		if (str->len > 0)
+			g_string_append_c (str, '\n');
+		if (job->error != NULL) {
+			g_string_append_printf (str, "%s: %s",
+						fwupd_device_get_name (job->device),
+						job->error->message);
+			continue;
+		}
+		if (job->covered) {
+			/* TRANSLATORS: %1 is a device name, %2 is the version */
+			g_string_append_printf (str, _("%s: updated to %s with its parent device"),
+						fwupd_device_get_name (job->device),
+						fwupd_release_get_version (job->release));
+			success++;
+			continue;
+		}
+		/* TRANSLATORS: %1 is a device name, %2 is the version */
+		g_string_append_printf (str, _("%s: updated to %s"),
+					fwupd_device_get_name (job->device),
+					fwupd_release_get_version (job->release));
+		flags |= fwupd_device_get_flags (job->device);
+		success++;
+	}
+
+	window = GTK_WINDOW (gtk_builder_get_object (self->builder, "dialog_main"));
+	dialog = gtk_message_dialog_new (window,
+					 GTK_DIALOG_MODAL,
+					 success == jobs->len ? GTK_MESSAGE_INFO : GTK_MESSAGE_WARNING,
+					 GTK_BUTTONS_OK,
+					 /* TRANSLATORS: %1 is the number that worked, %2 the number tried */
+					 ngettext ("Updated %u of %u device",
+						   "Updated %u of %u devices",
+						   jobs->len),
+					 success, jobs->len);
+	gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog), "%s", str->str);
+	gtk_dialog_run (GTK_DIALOG (dialog));
+	gtk_widget_destroy (dialog);
+
+	/* new versions */
+	g_dbus_proxy_call (self->proxy,
+			   "GetDevices",
+			   NULL,
 			   G_DBUS_CALL_FLAGS_NONE,
 			   -1,
-			   helper->self->cancellable,
-			   (GAsyncReadyCallback) gfu_main_update_releases_cb,
-			   helper->self);
+			   self->cancellable,
+			   (GAsyncReadyCallback) gfu_main_update_devices_cb,
+			   self);
+	gfu_main_reboot_shutdown_prompt (self, flags);
+}
+
+static gboolean
+gfu_main_update_all_next_cb (gpointer user_data)
+{
+	GfuMain *self = (GfuMain *) user_data;
+
+	self->update_all_id = 0;
+	while (self->update_all_idx < self->update_all->len) {
+		GfuUpdateAllJob *job = g_ptr_array_index (self->update_all, self->update_all_idx);
+		GfuUpdateAllJob *job_next = NULL;
+
+		/* waiting for the download, which schedules this again */
+		gfu_main_update_all_fetch_start (self, job);
+		if (job->fetching)
+			return FALSE;
+		if (job->error != NULL) {
+			self->update_all_idx++;
+			continue;
+		}
+
+		/* the composite update of the parent may have done this already */
+		if (job->parent != NULL && ((GfuUpdateAllJob *) job->parent)->installed) {
+			FwupdDevice *device = gfu_device_store_lookup (self->devices,
+								       fwupd_device_get_id (job->device));
+			if (device == NULL)
+				device = job->device;
+			if (g_strcmp0 (fwupd_device_get_version (device),
+				       fwupd_release_get_version (job->release)) == 0) {
+				g_debug ("%s already updated by parent",
+					 fwupd_device_get_id (device));
+				job->covered = TRUE;
+				self->update_all_idx++;
+				continue;
+			}
+		}
+
+		/* download the next payload while this one is flashed */
+		if (self->update_all_idx + 1 < self->update_all->len) {
+			job_next = g_ptr_array_index (self->update_all, self->update_all_idx + 1);
+			gfu_main_update_all_fetch_start (self, job_next);
+		}
+		self->flags = FWUPD_INSTALL_FLAG_NONE;
+		self->update_all_flashing = TRUE;
+		job->installed = gfu_main_install_fetched_to_device (self, job->device,
+								     job->fn, &job->error);
+		self->update_all_flashing = FALSE;
+		self->update_all_idx++;
+	}
+	gfu_main_update_all_done (self);
+	return FALSE;
+}
+
+/* the newest upgrade for each device, asked for without blocking the UI */
+typedef struct {
+	GfuMain		*self;
+	GPtrArray	*jobs;		/* of GfuUpdateAllJob, in model order */
+	guint		 pending;
+} GfuUpdateAllQuery;
+
+typedef struct {
+	GfuUpdateAllQuery	*query;
+	GfuUpdateAllJob		*job;
+} GfuUpdateAllQueryHelper;
+
+static void
+gfu_main_update_all_query_free (GfuUpdateAllQuery *query)
+{
+	g_ptr_array_foreach (query->jobs, (GFunc) gfu_main_update_all_job_free, NULL);
+	g_ptr_array_unref (query->jobs);
+	g_free (query);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuUpdateAllQuery, gfu_main_update_all_query_free)
+
+/* fwupd_client_get_upgrades() does this for the sync call */
+static gboolean
+gfu_main_error_is_nothing_to_do (const GError *error)
+{
+	g_autofree gchar *name = g_dbus_error_get_remote_error (error);
+	if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO))
+		return TRUE;
+	return name != NULL && fwupd_error_from_string (name) == FWUPD_ERROR_NOTHING_TO_DO;
+}
+
+static void
+gfu_main_update_all_confirm (GfuMain *self)
+{
+	GtkWindow *window;
+	GtkWidget *dialog;
+	gint response;
+	g_autoptr(GfuUpdateAllQuery) query = g_steal_pointer (&self->update_all_query);
+	g_autoptr(GHashTable) jobs_by_device = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_autoptr(GPtrArray) devices = g_ptr_array_new ();
+	g_autoptr(GPtrArray) jobs = NULL;
+	g_autoptr(GPtrArray) order = NULL;
+
+	/* devices that are already up to date are dropped */
+	for (guint i = 0; i < query->jobs->len; i++) {
+		GfuUpdateAllJob *job = g_ptr_array_index (query->jobs, i);
+		if (job->release == NULL && job->error == NULL) {
+			gfu_main_update_all_job_free (job);
+			continue;
+		}
+		g_ptr_array_add (devices, job->device);
+		g_hash_table_insert (jobs_by_device, job->device, job);
+	}
+	g_ptr_array_set_size (query->jobs, 0);
+
+	/* parents and children of composite devices go in the right order */
+	order = gfu_device_store_get_install_order (self->devices, devices);
+	jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) gfu_main_update_all_job_free);
+	for (guint i = 0; i < order->len; i++) {
+		FwupdDevice *device = g_ptr_array_index (order, i);
+		GfuUpdateAllJob *job = g_hash_table_lookup (jobs_by_device, device);
+		FwupdDevice *ancestor = gfu_device_store_get_ancestor (self->devices, device, devices);
+		if (ancestor != NULL)
+			job->parent = g_hash_table_lookup (jobs_by_device, ancestor);
+		g_ptr_array_add (jobs, job);
+	}
+
+	window = GTK_WINDOW (gtk_builder_get_object (self->builder, "dialog_main"));
+	if (jobs->len == 0) {
+		dialog = gtk_message_dialog_new (window,
+						 GTK_DIALOG_MODAL,
+						 GTK_MESSAGE_INFO,
+						 GTK_BUTTONS_OK,
+						 /* TRANSLATORS: there are no upgrades for any device */
+						 "%s", _("All devices are up to date"));
+		gtk_dialog_run (GTK_DIALOG (dialog));
+		gtk_widget_destroy (dialog);
+		return;
+	}
+	dialog = gtk_message_dialog_new (window,
+					 GTK_DIALOG_MODAL,
+					 GTK_MESSAGE_QUESTION,
+					 GTK_BUTTONS_OK_CANCEL,
+					 /* TRANSLATORS: %u is the number of devices */
+					 ngettext ("Update %u device?",
+						   "Update %u devices?",
+						   jobs->len),
+					 jobs->len);
+	gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
+						  _("Devices may be unusable while the updates are installing"));
+	response = gtk_dialog_run (GTK_DIALOG (dialog));
+	gtk_widget_destroy (dialog);
+	if (response != GTK_RESPONSE_OK)
+		return;
+
+	/* start with the first download, the rest follow each flash */
+	self->flags = FWUPD_INSTALL_FLAG_NONE;
+	self->current_operation = GFU_OPERATION_UPDATE;
+	self->update_all = g_steal_pointer (&jobs);
+	self->update_all_idx = 0;
+	gfu_main_show_install_loading (self, TRUE);
+	gfu_main_set_install_loading_label (self, _("Downloading file..."));
+	gfu_main_update_all_schedule (self);
+}
+
+static void
+gfu_main_update_all_upgrades_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	g_autofree GfuUpdateAllQueryHelper *helper = (GfuUpdateAllQueryHelper *) user_data;
+	GfuUpdateAllJob *job = helper->job;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) tmp = NULL;
+
+	/* the query has already been freed */
+	tmp = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+	if (tmp == NULL) {
+		if (!gfu_main_error_is_nothing_to_do (error)) {
+			g_dbus_error_strip_remote_error (error);
+			job->error = g_steal_pointer (&error);
+		}
+	} else {
+		g_autoptr(GPtrArray) releases = gfu_common_release_array_from_variant (tmp);
+		if (releases->len > 0) {
+			job->release = g_object_ref (g_ptr_array_index (releases, 0));
+			gfu_common_release_ensure_details (job->release);
+		}
+	}
+	if (--helper->query->pending == 0)
+		gfu_main_update_all_confirm (helper->query->self);
+}
+
+static void
+gfu_main_activate_update_all (GSimpleAction *simple, GVariant *parameter, gpointer user_data)
+{
+	GfuMain *self = (GfuMain *) user_data;
+	GListModel *model = gfu_device_store_get_model (self->devices);
+	GfuUpdateAllQuery *query;
+	guint n_items = g_list_model_get_n_items (model);
+
+	/* already running, or not connected yet */
+	if (self->update_all != NULL || self->update_all_query != NULL ||
+	    self->stale || self->proxy == NULL)
+		return;
+
+	/* the confirmation is shown when every device has replied */
+	query = g_new0 (GfuUpdateAllQuery, 1);
+	query->self = self;
+	query->jobs = g_ptr_array_new ();
+	self->update_all_query = query;
+	for (guint i = 0; i < n_items; i++) {
+		GfuUpdateAllJob *job;
+		GfuUpdateAllQueryHelper *helper;
+		g_autoptr(FwupdDevice) device = g_list_model_get_item (model, i);
+
+		if (!fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+			continue;
+		job = g_new0 (GfuUpdateAllJob, 1);
+		job->self = self;
+		job->device = g_object_ref (device);
+		g_ptr_array_add (query->jobs, job);
+		helper = g_new0 (GfuUpdateAllQueryHelper, 1);
+		helper->query = query;
+		helper->job = job;
+		query->pending++;
+		g_dbus_proxy_call (self->proxy,
+				   "GetUpgrades",
+				   g_variant_new ("(s)", fwupd_device_get_id (device)),
+				   G_DBUS_CALL_FLAGS_NONE,
+				   -1,
+				   self->cancellable,
+				   (GAsyncReadyCallback) gfu_main_update_all_upgrades_cb,
+				   helper);
+	}
+	if (query->pending == 0)
+		gfu_main_update_all_confirm (self);
+}
+
+/* used to retrieve the current device post-install */
+typedef struct {
+	GfuMain *self;
+	gchar *device_id;
+} GfuPostInstallHelper;
+
+static void
+gfu_main_post_install_helper_free (GfuPostInstallHelper *helper)
+{
+	g_free (helper->device_id);
+	g_free (helper);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuPostInstallHelper, gfu_main_post_install_helper_free)
+
+static void
+gfu_main_update_devices_post_install_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	GtkListBox *w;
+	guint position = 0;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("dbus", "GetDevices");
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GfuPostInstallHelper) helper = (GfuPostInstallHelper*)user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) tmp = g_dbus_proxy_call_finish (helper->self->proxy, res, &error);
+
+	/* clear out device list */
+	w = GTK_LIST_BOX (gtk_builder_get_object (helper->self->builder, "listbox_main"));
+	gtk_list_box_unselect_all (w);
+
+	if (tmp == NULL) {
+		gfu_device_store_clear (helper->self->devices);
+		gfu_main_error_dialog (helper->self, _("Failed to load device list"), error->message);
+		return;
+	}
+
+	/* only updatable or locked devices are returned */
+	devices = gfu_common_device_array_from_variant (tmp);
+	gfu_device_store_set_devices (helper->self->devices, devices);
+
+	/* update our current device now that new firmware has been installed */
+	if (gfu_device_store_find (helper->self->devices, helper->device_id, &position)) {
+		g_set_object (&helper->self->device,
+			      gfu_device_store_lookup (helper->self->devices, helper->device_id));
+		gtk_list_box_select_row (w, gtk_list_box_get_row_at_index (w, position));
+	}
+
+	/* reboot or shutdown if necessary (UEFI update) */
+	if (helper->self->device != NULL)
+		gfu_main_reboot_shutdown_prompt (helper->self, fwupd_device_get_flags (helper->self->device));
+
+	/* if no row is selected and there are rows in the list, select the first one */
+	gfu_main_select_first_device (helper->self);
+
+	/* update release list */
+	gfu_main_update_releases (helper->self, helper->device_id);
 }
 
 static void
@@ -1183,7 +1941,9 @@ gfu_main_release_install_file_cb (GtkWidget *widget, GfuMain *self)
 	GtkWidget *window;
 	GtkWidget *dialog;
 	const gchar *title_string = NULL;
+	gint response;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) group = gfu_device_store_get_group (self->devices, self->device);
 	gboolean upgrade = fwupd_release_has_flag (self->release, FWUPD_RELEASE_FLAG_IS_UPGRADE);
 	gboolean downgrade = fwupd_release_has_flag (self->release, FWUPD_RELEASE_FLAG_IS_DOWNGRADE);
 	gboolean reinstall = !downgrade && !upgrade;
@@ -1227,6 +1987,14 @@ gfu_main_release_install_file_cb (GtkWidget *widget, GfuMain *self)
 			gtk_dialog_add_button (GTK_DIALOG (dialog), _("Downgrade"), GTK_RESPONSE_OK);
 		}
 	}
+	if (group->len > 1) {
+		g_autofree gchar *label = NULL;
+		/* TRANSLATORS: install the same firmware on all the identical devices */
+		label = g_strdup_printf (ngettext ("Install on %u Device",
+						   "Install on %u Devices",
+						   group->len), group->len);
+		gtk_dialog_add_button (GTK_DIALOG (dialog), label, GTK_RESPONSE_APPLY);
+	}
 #if FWUPD_CHECK_VERSION(1,3,3)
 	if (fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE))
 		gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
@@ -1240,9 +2008,12 @@ gfu_main_release_install_file_cb (GtkWidget *widget, GfuMain *self)
 #endif
 
 	/* handle dialog response */
-	switch (gtk_dialog_run (GTK_DIALOG (dialog))) {
+	response = gtk_dialog_run (GTK_DIALOG (dialog));
+	switch (response) {
+	case GTK_RESPONSE_APPLY:
 	case GTK_RESPONSE_OK:
 	{
+		gboolean ret;
 		/* keep track of which device is being installed upon */
 		g_autoptr(GString) device_id = g_string_new (NULL);
 		g_string_assign (device_id, fwupd_device_get_id (self->device));
@@ -1252,7 +2023,11 @@ gfu_main_release_install_file_cb (GtkWidget *widget, GfuMain *self)
 		/* begin installing, show loading animation */
 		gfu_main_show_install_loading (self, TRUE);
 
-		if (!gfu_main_install_release_to_device (self, self->device, self->release, &error)) {
+		if (response == GTK_RESPONSE_APPLY)
+			ret = gfu_main_install_release_to_group (self, group, self->release, &error);
+		else
+			ret = gfu_main_install_release_to_device (self, self->device, self->release, &error);
+		if (!ret) {
 			gfu_main_show_install_loading (self, FALSE);
 			gfu_main_error_dialog (self, _("Failed to install firmware release"), error->message);
 		} else {
@@ -1260,7 +2035,7 @@ gfu_main_release_install_file_cb (GtkWidget *widget, GfuMain *self)
 			GfuPostInstallHelper *helper = g_new0 (GfuPostInstallHelper, 1);
 			guint64 flags = fwupd_device_get_flags (self->device);
 			helper->self = self;
-			helper->device_id = device_id->str;
+			helper->device_id = g_strdup (device_id->str);
 
 			/* update device list */
 			g_dbus_proxy_call (self->proxy,
@@ -1309,17 +2084,63 @@ gfu_main_release_install_file_cb (GtkWidget *widget, GfuMain *self)
 	}
 }
 
+static void gfu_main_release_row_selected_cb (GtkListBox *box, GtkListBoxRow *row, GfuMain *self);
+
+/* most sessions never look at releases, so the page is not parsed at startup */
+static gboolean
+gfu_main_ensure_release_page (GfuMain *self, GError **error)
+{
+	GtkWidget *w;
+	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(GfuMainScope) scope = NULL;
+
+	if (self->box_firmware != NULL)
+		return TRUE;
+	scope = gfu_main_scope_push (self, "release page");
+	timer = g_timer_new ();
+	if (gtk_builder_add_from_resource (self->builder,
+					   "/org/gnome/Firmware/gfu-release-page.ui",
+					   error) == 0)
+		return FALSE;
+	self->box_firmware = GTK_WIDGET (gtk_builder_get_object (self->builder, "box_firmware"));
+	gtk_stack_add_titled (GTK_STACK (self->stack_main), self->box_firmware,
+			      "firmware", _("Firmware"));
+	self->button_install = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_install"));
+	g_signal_connect (self->button_install, "clicked",
+			  G_CALLBACK (gfu_main_release_install_file_cb), self);
+	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_firmware"));
+	g_signal_connect (w, "row-selected",
+			  G_CALLBACK (gfu_main_release_row_selected_cb), self);
+	g_debug ("built release page in %.2fms", g_timer_elapsed (timer, NULL) * 1000);
+
+	/* catch up with what arrived while it did not exist */
+	gfu_main_release_rows_rebuild (self);
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_RELEASE | GFU_MAIN_SECTION_ACTIONS);
+	return TRUE;
+}
+
 static void
 gfu_main_device_releases_cb (GtkWidget *widget, GfuMain *self)
 {
+	g_autoptr(GError) error = NULL;
+
+	if (!gfu_main_ensure_release_page (self, &error)) {
+		g_warning ("failed to load release page: %s", error->message);
+		return;
+	}
 	self->mode = GFU_MAIN_MODE_RELEASE;
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_STACK | GFU_MAIN_SECTION_ACTIONS);
 	gfu_main_refresh_ui (self);
 }
 
 static void
 gfu_main_button_back_cb (GtkWidget *widget, GfuMain *self)
 {
-	self->mode = GFU_MAIN_MODE_DEVICE;
+	if (self->mode == GFU_MAIN_MODE_DIAGNOSTICS)
+		self->mode = self->diagnostics_mode_prev;
+	else
+		self->mode = GFU_MAIN_MODE_DEVICE;
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_STACK | GFU_MAIN_SECTION_ACTIONS);
 	gfu_main_refresh_ui (self);
 }
 
@@ -1329,6 +2150,7 @@ gfu_main_device_verify_cb (GtkWidget *widget, GfuMain *self)
 	GtkWidget *dialog;
 	GtkWidget *window = GTK_WIDGET (gtk_builder_get_object (self->builder, "dialog_main"));
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GfuMainScope) scope = NULL;
 
 	dialog = gtk_message_dialog_new (GTK_WINDOW (window),
 					 GTK_DIALOG_MODAL,
@@ -1342,6 +2164,7 @@ gfu_main_device_verify_cb (GtkWidget *widget, GfuMain *self)
 	case GTK_RESPONSE_YES:
 		gtk_widget_destroy (dialog);
 		g_clear_error (&error);
+		scope = gfu_main_scope_push (self, "verify");
 		if (!fwupd_client_verify (self->client,
 					  fwupd_device_get_id (self->device),
 					  self->cancellable,
@@ -1376,6 +2199,7 @@ gfu_main_device_verify_update_cb (GtkWidget *widget, GfuMain *self)
 	GtkWidget *dialog;
 	GtkWidget *window = GTK_WIDGET (gtk_builder_get_object (self->builder, "dialog_main"));
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GfuMainScope) scope = NULL;
 
 	dialog = gtk_message_dialog_new (GTK_WINDOW (window),
 					 GTK_DIALOG_MODAL,
@@ -1389,6 +2213,7 @@ gfu_main_device_verify_update_cb (GtkWidget *widget, GfuMain *self)
 	case GTK_RESPONSE_YES:
 		gtk_widget_destroy (dialog);
 		g_clear_error (&error);
+		scope = gfu_main_scope_push (self, "verify update");
 		if (!fwupd_client_verify_update (self->client,
 						 fwupd_device_get_id (self->device),
 						 self->cancellable,
@@ -1396,6 +2221,7 @@ gfu_main_device_verify_update_cb (GtkWidget *widget, GfuMain *self)
 			/* TRANSLATORS: verify means checking the actual checksum of the firmware */
 			gfu_main_error_dialog (self, _("Failed to update checksums"), error->message);
 		}
+		gfu_main_invalidate (self, GFU_MAIN_SECTION_DEVICE | GFU_MAIN_SECTION_ACTIONS);
 		gfu_main_refresh_ui (self);
 		return;
 	default:
@@ -1407,8 +2233,11 @@ static void
 gfu_main_update_title (GfuMain *self)
 {
 	GtkWidget *w;
+	if (self->builder == NULL)
+		return;
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "header"));
-	gtk_header_bar_set_subtitle (GTK_HEADER_BAR (w), NULL);
+	/* TRANSLATORS: the devices are from last time, the daemon has not replied yet */
+	gtk_header_bar_set_subtitle (GTK_HEADER_BAR (w), self->stale ? _("Showing cached devices…") : NULL);
 }
 
 static void
@@ -1448,243 +2277,888 @@ gfu_main_quit_activated_cb (GSimpleAction *action, GVariant *parameter, gpointer
 	g_application_quit (G_APPLICATION (self->application));
 }
 
-static GActionEntry actions[] = {
-	{ "about",	gfu_main_about_activated_cb, NULL, NULL, NULL },
-	{ "refresh",	gfu_main_activate_refresh_metadata, NULL, NULL, NULL },
-	{ "quit",	gfu_main_quit_activated_cb, NULL, NULL, NULL }
-};
+/* hidden diagnostics page, so support can see why a machine is slow */
+
+static gboolean
+gfu_main_diagnostics_refresh_cb (gpointer user_data)
+{
+	GfuMain *self = (GfuMain *) user_data;
+	g_autofree gchar *str = NULL;
+
+	/* only updated while it can be seen */
+	if (self->mode != GFU_MAIN_MODE_DIAGNOSTICS) {
+		self->diagnostics_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	str = gfu_stats_to_string ();
+	gtk_label_set_text (GTK_LABEL (self->label_diagnostics), str);
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+gfu_main_ensure_diagnostics_page (GfuMain *self)
+{
+	GtkWidget *sw;
+
+	if (self->label_diagnostics != NULL)
+		return;
+
+	/* not translated, and selectable so it can be pasted into a bug */
+	self->label_diagnostics = gtk_label_new (NULL);
+	gtk_label_set_selectable (GTK_LABEL (self->label_diagnostics), TRUE);
+	gtk_label_set_xalign (GTK_LABEL (self->label_diagnostics), 0.f);
+	gtk_label_set_yalign (GTK_LABEL (self->label_diagnostics), 0.f);
+	gtk_widget_set_margin_start (self->label_diagnostics, 12);
+	gtk_widget_set_margin_end (self->label_diagnostics, 12);
+	gtk_widget_set_margin_top (self->label_diagnostics, 12);
+	gtk_widget_set_margin_bottom (self->label_diagnostics, 12);
+	gtk_style_context_add_class (gtk_widget_get_style_context (self->label_diagnostics),
+				     "monospace");
+	sw = gtk_scrolled_window_new (NULL, NULL);
+	gtk_container_add (GTK_CONTAINER (sw), self->label_diagnostics);
+	gtk_widget_show_all (sw);
+	gtk_stack_add_titled (GTK_STACK (self->stack_main), sw,
+			      /* TRANSLATORS: hidden page with timings and counters */
+			      "diagnostics", _("Diagnostics"));
+}
+
+static void
+gfu_main_diagnostics_activated_cb (GSimpleAction *action, GVariant *parameter, gpointer user_data)
+{
+	GfuMain *self = (GfuMain *) user_data;
+
+	/* no window yet, or already showing */
+	if (self->builder == NULL || self->mode == GFU_MAIN_MODE_DIAGNOSTICS)
+		return;
+	gfu_main_ensure_diagnostics_page (self);
+	self->diagnostics_mode_prev = self->mode;
+	self->mode = GFU_MAIN_MODE_DIAGNOSTICS;
+	gfu_main_diagnostics_refresh_cb (self);
+	if (self->diagnostics_id == 0)
+		self->diagnostics_id = g_timeout_add_seconds (1, gfu_main_diagnostics_refresh_cb, self);
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_STACK | GFU_MAIN_SECTION_ACTIONS);
+	gfu_main_refresh_ui (self);
+}
+
+static GActionEntry actions[] = {
+	{ "about",	gfu_main_about_activated_cb, NULL, NULL, NULL },
+	{ "refresh",	gfu_main_activate_refresh_metadata, NULL, NULL, NULL },
+	{ "update-all",	gfu_main_activate_update_all, NULL, NULL, NULL },
+	{ "diagnostics", gfu_main_diagnostics_activated_cb, NULL, NULL, NULL },
+	{ "quit",	gfu_main_quit_activated_cb, NULL, NULL, NULL }
+};
+
+static void
+gfu_main_release_row_selected_cb (GtkListBox *box, GtkListBoxRow *row, GfuMain *self)
+{
+	FwupdRelease *release;
+
+	/* Ignore if not in the "release" view */
+	if (!GFU_IS_RELEASE_ROW (GFU_RELEASE_ROW (row)))
+		return;
+
+	release = gfu_release_row_get_release (GFU_RELEASE_ROW (row));
+	g_set_object (&self->release, release);
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_RELEASE | GFU_MAIN_SECTION_ACTIONS);
+	gfu_main_refresh_ui (self);
+}
+
+static void
+gfu_main_device_row_selected_cb (GtkListBox *box, GtkListBoxRow *row, GfuMain *self)
+{
+	FwupdDevice *device;
+	g_autoptr(GError) error = NULL;
+
+	if (row == NULL)
+		return;
+
+	device = gfu_device_row_get_device (GFU_DEVICE_ROW (row));
+
+	self->mode = GFU_MAIN_MODE_DEVICE;
+	gfu_main_releases_pending_stop (self);
+	g_clear_pointer (&self->releases, g_ptr_array_unref);
+	self->releases_live = FALSE;
+	g_clear_object (&self->release);
+	g_set_object (&self->device, device);
+
+	/* show the last known releases, then ask for the full ones */
+	if (fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_UPDATABLE)) {
+		GVariant *releases = g_hash_table_lookup (self->snapshot_releases,
+							  fwupd_device_get_id (self->device));
+		if (releases != NULL) {
+			gfu_stats_inc (GFU_STATS_COUNTER_RELEASE_CACHE_HITS);
+			gfu_main_set_releases (self, releases, FALSE);
+		} else {
+			gfu_stats_inc (GFU_STATS_COUNTER_RELEASE_CACHE_MISSES);
+		}
+	}
+	if (fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_UPDATABLE) && self->proxy != NULL) {
+		gfu_main_update_releases (self, fwupd_device_get_id (self->device));
+	}
+
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_ALL);
+	gfu_main_refresh_ui (self);
+}
+
+static gchar *
+gfu_main_time_remaining_str (GfuMain *self)
+{
+	gdouble remaining = gfu_estimator_get_remaining (self->estimator);
+
+	/* unknown, or less than 5 seconds remaining */
+	if (remaining < 5)
+		return NULL;
+
+	/* less than 60 seconds remaining */
+	if (remaining < 60) {
+		/* TRANSLATORS: time remaining for completing firmware flash */
+		return g_strdup (_("Less than one minute remaining"));
+	}
+
+	/* more than a minute */
+	return g_strdup_printf (ngettext ("%.0f minute remaining",
+					  "%.0f minutes remaining",
+					  remaining / 60),
+					  remaining / 60);
+}
+
+static void
+gfu_main_signals_cb (GDBusProxy *proxy,
+		     const gchar *sender_name,
+		     const gchar *signal_name,
+		     GVariant *parameters,
+		     GfuMain *self)
+{
+	g_autoptr(FwupdDevice) dev = NULL;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("dbus", "signal");
+
+	gfu_trace_span_add_arg (span, "name", signal_name);
+	gfu_stats_inc (GFU_STATS_COUNTER_SIGNALS);
+	if (g_strcmp0 (signal_name, "DeviceAdded") == 0) {
+		/* a replug shows up as a removal followed by this */
+		gfu_trace_instant ("dbus", "device-added");
+		dev = fwupd_device_from_variant (parameters);
+		g_debug ("Emitting ::device-added(%s)",
+			 fwupd_device_get_id (dev));
+		gfu_main_device_added_cb (self->client, dev, self);
+		return;
+	}
+	if (g_strcmp0 (signal_name, "DeviceRemoved") == 0) {
+		gfu_trace_instant ("dbus", "device-removed");
+		dev = fwupd_device_from_variant (parameters);
+		g_debug ("Emitting ::device-removed(%s)",
+			 fwupd_device_get_id (dev));
+		gfu_main_device_removed_cb (self->client, dev, self);
+		return;
+	}
+	if (g_strcmp0 (signal_name, "DeviceChanged") == 0) {
+		FwupdStatus status = fwupd_client_get_status (self->client);
+		gint percentage;
+		g_autoptr(GString) status_str = g_string_new (NULL);
+		g_autofree gchar *device_str = NULL;
+		g_autofree gchar *remaining = NULL;
+
+		dev = fwupd_device_from_variant (parameters);
+
+		/* the row and the details share the object that is updated */
+		gfu_device_store_update (self->devices, dev);
+
+		/* update progress */
+		percentage = fwupd_client_get_percentage (self->client);
+		gfu_trace_counter ("status", status);
+		gfu_trace_counter ("percentage", percentage);
+		g_string_append_printf (status_str, "%s: %d%%\n",
+					gfu_status_to_string (status),
+					percentage);
+
+		/* show an estimate of time remaining from the first tick */
+		gfu_estimator_set_progress (self->estimator, status, percentage);
+		remaining = gfu_main_time_remaining_str (self);
+		if (remaining != NULL)
+			g_string_append_printf (status_str, "%s…", remaining);
+		gfu_main_set_install_status_label (self, status_str->str);
+
+		/* same as last time, so ignore */
+		if (self->device != NULL &&
+		    fwupd_device_compare (self->device, dev) == 0) {
+			gfu_stats_inc (GFU_STATS_COUNTER_SIGNALS_COALESCED);
+			return;
+		}
+
+		device_str = gfu_operation_to_string (self->current_operation,
+						      dev);
+		gfu_main_set_install_loading_label (self, device_str);
+
+		return;
+	}
+
+	g_debug ("Unknown signal name '%s' from %s", signal_name, sender_name);
+}
+
+/* D-Bus recording, and how long each reply and signal took to handle */
+
+static void
+gfu_main_latency_clear (gpointer data)
+{
+	GfuMainLatency *item = (GfuMainLatency *) data;
+	g_free (item->member);
+}
+
+/* this runs just before the real callback, as it was queued first */
+static void
+gfu_main_recorder_dispatched_cb (GfuRecorder *recorder,
+				 GDBusMessage *message,
+				 const gchar *member,
+				 guint64 arrival,
+				 GfuMain *self)
+{
+	GfuMainLatency item = { NULL };
+	GdkFrameClock *clock;
+	GtkWidget *window;
+
+	item.member = g_strdup (member);
+	item.type = g_dbus_message_get_message_type (message);
+	item.arrival = (gint64) arrival;
+	item.dispatched = g_get_monotonic_time ();
+	g_array_append_val (self->latencies, item);
+
+	/* make sure a frame follows so the cost of handling it is visible */
+	if (self->builder == NULL)
+		return;
+	window = GTK_WIDGET (gtk_builder_get_object (self->builder, "dialog_main"));
+	clock = gtk_widget_get_frame_clock (window);
+	if (clock != NULL)
+		gdk_frame_clock_request_phase (clock, GDK_FRAME_CLOCK_PHASE_PAINT);
+}
+
+static void
+gfu_main_frame_after_paint_cb (GdkFrameClock *clock, GfuMain *self)
+{
+	gint64 now = g_get_monotonic_time ();
+	for (guint i = self->latencies_painted; i < self->latencies->len; i++) {
+		GfuMainLatency *item = &g_array_index (self->latencies, GfuMainLatency, i);
+		item->painted = now;
+	}
+	self->latencies_painted = self->latencies->len;
+}
+
+static gint
+gfu_main_latency_sort_cb (gconstpointer a, gconstpointer b)
+{
+	gint64 v1 = *((const gint64 *) a);
+	gint64 v2 = *((const gint64 *) b);
+	if (v1 < v2)
+		return -1;
+	return v1 > v2;
+}
+
+/* in ms, the array must be sorted */
+static gdouble
+gfu_main_latency_percentile (GArray *values, guint pct)
+{
+	if (values->len == 0)
+		return 0.f;
+	return g_array_index (values, gint64, ((values->len - 1) * pct) / 100) / 1000.f;
+}
+
+static void
+gfu_main_latency_report (GfuMain *self)
+{
+	gint64 start;
+	g_autoptr(GArray) loop = g_array_new (FALSE, FALSE, sizeof(gint64));
+	g_autoptr(GArray) frame = g_array_new (FALSE, FALSE, sizeof(gint64));
+
+	if (self->latencies->len == 0) {
+		g_print ("No D-Bus events were received\n");
+		return;
+	}
+	start = g_array_index (self->latencies, GfuMainLatency, 0).arrival;
+	g_print ("%10s  %-6s  %-24s  %10s  %10s\n",
+		 "Time/ms", "Type", "Member", "Loop/ms", "Frame/ms");
+	for (guint i = 0; i < self->latencies->len; i++) {
+		GfuMainLatency *item = &g_array_index (self->latencies, GfuMainLatency, i);
+		const gchar *type = "reply";
+		gint64 loop_delay = item->dispatched - item->arrival;
+		g_autofree gchar *frame_str = NULL;
+
+		if (item->type == G_DBUS_MESSAGE_TYPE_SIGNAL)
+			type = "signal";
+		else if (item->type == G_DBUS_MESSAGE_TYPE_ERROR)
+			type = "error";
+		g_array_append_val (loop, loop_delay);
+		if (item->painted > 0) {
+			gint64 frame_delay = item->painted - item->arrival;
+			g_array_append_val (frame, frame_delay);
+			frame_str = g_strdup_printf ("%.2f", frame_delay / 1000.f);
+		}
+		g_print ("%10.1f  %-6s  %-24s  %10.2f  %10s\n",
+			 (item->arrival - start) / 1000.f, type, item->member,
+			 loop_delay / 1000.f, frame_str != NULL ? frame_str : "-");
+	}
+
+	g_array_sort (loop, gfu_main_latency_sort_cb);
+	g_array_sort (frame, gfu_main_latency_sort_cb);
+	g_print ("%u events, main loop p50 %.2fms p99 %.2fms max %.2fms\n",
+		 self->latencies->len,
+		 gfu_main_latency_percentile (loop, 50),
+		 gfu_main_latency_percentile (loop, 99),
+		 gfu_main_latency_percentile (loop, 100));
+	g_print ("%u frames, frame p50 %.2fms p99 %.2fms max %.2fms\n",
+		 frame->len,
+		 gfu_main_latency_percentile (frame, 50),
+		 gfu_main_latency_percentile (frame, 99),
+		 gfu_main_latency_percentile (frame, 100));
+}
+
+static gboolean
+gfu_main_recorder_start (GfuMain *self, GError **error)
+{
+	g_autoptr(GDBusConnection) connection = NULL;
+
+	/* the same shared connection that the proxy and libfwupd use */
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, self->cancellable, error);
+	if (connection == NULL)
+		return FALSE;
+	self->recorder = gfu_recorder_new ();
+	if (self->record_filename != NULL &&
+	    !gfu_recorder_set_filename (self->recorder, self->record_filename, error))
+		return FALSE;
+	if (self->latencies != NULL) {
+		gfu_recorder_set_measure (self->recorder, TRUE);
+		g_signal_connect (self->recorder, "message-dispatched",
+				  G_CALLBACK (gfu_main_recorder_dispatched_cb), self);
+	}
+	gfu_recorder_attach (self->recorder, connection, NULL);
+	return TRUE;
+}
+
+static void
+gfu_main_recorder_stop (GfuMain *self)
+{
+	g_autoptr(GError) error = NULL;
+
+	if (self->recorder == NULL)
+		return;
+	if (!gfu_recorder_close (self->recorder, &error))
+		g_printerr ("Failed to save D-Bus trace: %s\n", error->message);
+	if (self->latencies != NULL)
+		gfu_main_latency_report (self);
+}
+
+static void
+gfu_main_proxy_name_owner_cb (GDBusProxy *proxy, GParamSpec *pspec, GfuMain *self)
+{
+	g_autofree gchar *name_owner = g_dbus_proxy_get_name_owner (proxy);
+	gfu_recorder_set_name_owner (self->recorder, name_owner);
+}
+
+static void
+gfu_main_proxy_new_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+	GfuMain *self = (GfuMain *) user_data;
+	self->proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+	gfu_main_startup_mark (self, GFU_MAIN_STARTUP_DBUS);
+
+	if (self->proxy == NULL) {
+		gfu_main_error_dialog (self, _("Error connecting to fwupd"), error->message);
+		return;
+	}
+	gfu_stats_watch_connection (g_dbus_proxy_get_connection (self->proxy));
+	if (self->recorder != NULL) {
+		gfu_main_proxy_name_owner_cb (self->proxy, NULL, self);
+		g_signal_connect (self->proxy, "notify::g-name-owner",
+				  G_CALLBACK (gfu_main_proxy_name_owner_cb), self);
+	}
+
+	/* async call for devices */
+	g_dbus_proxy_call (self->proxy,
+			   "GetDevices",
+			   NULL,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1,
+			   self->cancellable,
+			   (GAsyncReadyCallback) gfu_main_update_devices_cb,
+			   self);
+
+	/* async call for remotes */
+	g_dbus_proxy_call (self->proxy,
+			   "GetRemotes",
+			   NULL,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1,
+			   self->cancellable,
+			   (GAsyncReadyCallback) gfu_main_update_remotes_cb,
+			   self);
+
+	/* connecting signals for updating devices */
+	g_signal_connect (self->proxy, "g-signal",
+			  G_CALLBACK (gfu_main_signals_cb), self);
+}
+
+static void
+gfu_main_device_unlock_cb (GtkWidget *widget, GfuMain *self)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GfuMainScope) scope = gfu_main_scope_push (self, "unlock");
+	if (!fwupd_client_unlock (self->client,
+				  fwupd_device_get_id (self->device),
+				  self->cancellable,
+				  &error)) {
+		gfu_main_error_dialog (self, _("Failed to unlock device"), error->message);
+	} else {
+		gfu_main_reboot_shutdown_prompt (self, fwupd_device_get_flags (self->device));
+	}
+}
+
+static void
+gfu_main_infobar_close_cb (GtkInfoBar *infobar, gpointer user_data)
+{
+	gtk_info_bar_set_revealed (infobar, FALSE);
+}
+
+static void
+gfu_main_infobar_response_cb (GtkInfoBar *infobar, gint response_id, gpointer user_data)
+{
+	if (response_id == GTK_RESPONSE_CLOSE)
+		gtk_info_bar_set_revealed (infobar, FALSE);
+}
+
+static gboolean
+gfu_main_window_map_event_cb (GtkWidget *widget, GdkEvent *event, GfuMain *self)
+{
+	gfu_main_startup_mark (self, GFU_MAIN_STARTUP_MAP);
+	if (self->latencies != NULL) {
+		GdkFrameClock *clock = gtk_widget_get_frame_clock (widget);
+		g_signal_handlers_disconnect_by_func (clock, gfu_main_frame_after_paint_cb, self);
+		g_signal_connect (clock, "after-paint",
+				  G_CALLBACK (gfu_main_frame_after_paint_cb), self);
+	}
+	return FALSE;
+}
+
+/* background service */
+
+static void
+gfu_main_service_releases_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GfuReleasesHelper) helper = (GfuReleasesHelper *) user_data;
+	GfuMain *self = helper->self;
+	g_autoptr(GfuTraceSpan) span = gfu_trace_span_begin ("dbus", "GetReleases");
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) tmp = g_dbus_proxy_call_finish (self->proxy, res, &error);
+
+	if (tmp == NULL) {
+		g_debug ("ignoring: %s", error->message);
+		return;
+	}
+	g_hash_table_insert (self->snapshot_releases,
+			     g_steal_pointer (&helper->device_id),
+			     g_variant_ref_sink (gfu_common_release_reply_strip_details (tmp)));
+	gfu_main_snapshot_queue_save (self);
+}
+
+typedef struct {
+	GfuMain		*self;
+	GfuUpdateAllJob	*job;
+} GfuServicePrefetchHelper;
 
 static void
-gfu_main_release_row_selected_cb (GtkListBox *box, GtkListBoxRow *row, GfuMain *self)
+gfu_main_service_upgrades_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
-	FwupdRelease *release;
+	g_autofree GfuServicePrefetchHelper *helper = (GfuServicePrefetchHelper *) user_data;
+	GfuUpdateAllJob *job = helper->job;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) releases = NULL;
+	g_autoptr(GVariant) tmp = NULL;
 
-	/* Ignore if not in the "release" view */
-	if (!GFU_IS_RELEASE_ROW (GFU_RELEASE_ROW (row)))
+	/* the job has already been freed */
+	tmp = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+	job->asking = FALSE;
+	if (tmp == NULL) {
+		g_debug ("no upgrades for %s: %s",
+			 fwupd_device_get_id (job->device), error->message);
 		return;
+	}
 
-	release = gfu_release_row_get_release (GFU_RELEASE_ROW (row));
-	g_set_object (&self->release, release);
-	gfu_main_refresh_ui (self);
+	/* the payload that "Update All" would install */
+	releases = gfu_common_release_array_from_variant (tmp);
+	if (releases->len == 0)
+		return;
+	job->release = g_object_ref (g_ptr_array_index (releases, 0));
+	gfu_main_update_all_fetch_start (helper->self, job);
+	if (job->error != NULL)
+		g_debug ("not prefetching: %s", job->error->message);
 }
 
 static void
-gfu_main_device_row_selected_cb (GtkListBox *box, GtkListBoxRow *row, GfuMain *self)
+gfu_main_service_prefetch (GfuMain *self)
 {
-	FwupdDevice *device;
-	g_autoptr(GError) error = NULL;
+	GListModel *model = gfu_device_store_get_model (self->devices);
 
-	if (row == NULL)
-		return;
+	/* still busy from last time */
+	for (guint i = 0; self->prefetch != NULL && i < self->prefetch->len; i++) {
+		GfuUpdateAllJob *job = g_ptr_array_index (self->prefetch, i);
+		if (job->asking || job->fetching)
+			return;
+	}
+	g_clear_pointer (&self->prefetch, g_ptr_array_unref);
+	self->prefetch = g_ptr_array_new_with_free_func ((GDestroyNotify) gfu_main_update_all_job_free);
 
-	device = gfu_device_row_get_device (GFU_DEVICE_ROW (row));
+	for (guint i = 0; i < g_list_model_get_n_items (model); i++) {
+		g_autoptr(FwupdDevice) device = g_list_model_get_item (model, i);
+		GfuReleasesHelper *helper;
+		GfuServicePrefetchHelper *helper_upgrades;
+		GfuUpdateAllJob *job;
 
-	self->mode = GFU_MAIN_MODE_DEVICE;
-	g_clear_pointer (&self->releases, g_ptr_array_unref);
-	g_set_object (&self->device, device);
+		if (!fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+			continue;
 
-	/* async call for releases */
-	if (fwupd_device_has_flag (self->device, FWUPD_DEVICE_FLAG_UPDATABLE)) {
+		/* so that the release list is ready when the device is selected */
+		helper = g_new0 (GfuReleasesHelper, 1);
+		helper->self = self;
+		helper->device_id = g_strdup (fwupd_device_get_id (device));
 		g_dbus_proxy_call (self->proxy,
 				   "GetReleases",
-				   g_variant_new ("(s)", fwupd_device_get_id (self->device)),
+				   g_variant_new ("(s)", fwupd_device_get_id (device)),
+				   G_DBUS_CALL_FLAGS_NONE,
+				   -1,
+				   self->cancellable,
+				   (GAsyncReadyCallback) gfu_main_service_releases_cb,
+				   helper);
+
+		/* the download starts when the daemon replies */
+		job = g_new0 (GfuUpdateAllJob, 1);
+		job->self = self;
+		job->device = g_object_ref (device);
+		job->asking = TRUE;
+		g_ptr_array_add (self->prefetch, job);
+		helper_upgrades = g_new0 (GfuServicePrefetchHelper, 1);
+		helper_upgrades->self = self;
+		helper_upgrades->job = job;
+		g_dbus_proxy_call (self->proxy,
+				   "GetUpgrades",
+				   g_variant_new ("(s)", fwupd_device_get_id (device)),
 				   G_DBUS_CALL_FLAGS_NONE,
 				   -1,
 				   self->cancellable,
-				   (GAsyncReadyCallback) gfu_main_update_releases_cb,
-				   self);
+				   gfu_main_service_upgrades_cb,
+				   helper_upgrades);
 	}
+}
 
-	gfu_main_refresh_ui (self);
+/* each remote is downloaded and sent to the daemon in turn, all from the
+ * main loop so that an attached window is never blocked */
+typedef struct {
+	GfuMain		*self;
+	GPtrArray	*remotes;	/* of FwupdRemote */
+	guint		 idx;
+	gchar		*fn;
+	gchar		*fn_asc;
+} GfuServiceRefreshHelper;
+
+static void
+gfu_main_service_refresh_helper_free (GfuServiceRefreshHelper *helper)
+{
+	g_ptr_array_unref (helper->remotes);
+	g_free (helper->fn);
+	g_free (helper->fn_asc);
+	g_free (helper);
+}
+
+static void gfu_main_service_refresh_next (GfuServiceRefreshHelper *helper);
+
+static void
+gfu_main_service_refresh_done (GfuServiceRefreshHelper *helper, const GError *error)
+{
+	GfuMain *self = helper->self;
+
+	if (error != NULL)
+		g_warning ("failed to refresh metadata: %s", error->message);
+	gfu_main_service_refresh_helper_free (helper);
+	self->service_refreshing = FALSE;
+	gfu_main_service_prefetch (self);
 }
 
 static gboolean
-gfu_main_estimate_ready (GfuMain *self, guint percentage)
+gfu_main_service_refresh_queue (GfuServiceRefreshHelper *helper,
+				const gchar *uri_str,
+				SoupSessionCallback callback,
+				GError **error)
 {
-	gdouble old;
-	gdouble elapsed;
+	SoupMessage *msg;
+	SoupSession *soup_session;
+	g_autoptr(SoupURI) uri = NULL;
 
-	if (percentage == 0 || percentage == 100)
+	soup_session = gfu_engine_get_soup_session (helper->self->engine, error);
+	if (soup_session == NULL)
 		return FALSE;
+	uri = soup_uri_new (uri_str);
+	msg = uri != NULL ? soup_message_new_from_uri (SOUP_METHOD_GET, uri) : NULL;
+	if (msg == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     _("Failed to parse URI %s"), uri_str);
+		return FALSE;
+	}
+	g_debug ("refreshing %s", uri_str);
+	gfu_engine_download_watch (msg);
+	soup_session_queue_message (soup_session, msg, callback, helper);
+	return TRUE;
+}
 
-	old = self->last_estimate;
-	elapsed = g_timer_elapsed (self->time_elapsed, NULL);
-	self->last_estimate = elapsed / percentage * (100 - percentage);
+static void
+gfu_main_service_update_metadata_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	GfuServiceRefreshHelper *helper = (GfuServiceRefreshHelper *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) tmp = NULL;
 
-	/* estimate is ready if we have decreased */
-	return old > self->last_estimate;
+	/* GfuMain has already been freed */
+	tmp = g_dbus_proxy_call_with_unix_fd_list_finish (G_DBUS_PROXY (source_object),
+							  NULL, res, &error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		gfu_main_service_refresh_helper_free (helper);
+		return;
+	}
+	if (tmp == NULL) {
+		gfu_main_service_refresh_done (helper, error);
+		return;
+	}
+	helper->idx++;
+	gfu_main_service_refresh_next (helper);
 }
 
-static gchar *
-gfu_main_time_remaining_str (GfuMain *self)
+static gboolean
+gfu_main_service_fd_list_append (GUnixFDList *fd_list, const gchar *fn, GError **error)
 {
-	/* less than 5 seconds remaining */
-	if (self->last_estimate < 5)
-		return NULL;
+	gint fd = g_open (fn, O_RDONLY, 0);
+	gint idx;
 
-	/* less than 60 seconds remaining */
-	if (self->last_estimate < 60) {
-		/* TRANSLATORS: time remaining for completing firmware flash */
-		return g_strdup (_("Less than one minute remaining"));
+	if (fd < 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     g_io_error_from_errno (errno),
+			     "failed to open %s: %s", fn, g_strerror (errno));
+		return FALSE;
 	}
-
-	/* more than a minute */
-	return g_strdup_printf (ngettext ("%.0f minute remaining",
-					  "%.0f minutes remaining",
-					  self->last_estimate / 60),
-					  self->last_estimate / 60);
+	idx = g_unix_fd_list_append (fd_list, fd, error);
+	g_close (fd, NULL);
+	return idx >= 0;
 }
 
 static void
-gfu_main_signals_cb (GDBusProxy *proxy,
-		     const gchar *sender_name,
-		     const gchar *signal_name,
-		     GVariant *parameters,
-		     GfuMain *self)
+gfu_main_service_signature_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
 {
-	g_autoptr(FwupdDevice) dev = NULL;
-	if (g_strcmp0 (signal_name, "DeviceAdded") == 0) {
-		dev = fwupd_device_from_variant (parameters);
-		g_debug ("Emitting ::device-added(%s)",
-			 fwupd_device_get_id (dev));
-		gfu_main_device_added_cb (self->client, dev, self);
+	GfuServiceRefreshHelper *helper = (GfuServiceRefreshHelper *) user_data;
+	GfuMain *self = helper->self;
+	FwupdRemote *remote = g_ptr_array_index (helper->remotes, helper->idx);
+	g_autofree gchar *uri_str = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
+	g_autoptr(GError) error = NULL;
+	GUnixFDList *fd_list;
+
+	/* aborted from gfu_main_free() */
+	if (msg->status_code == SOUP_STATUS_CANCELLED) {
+		gfu_main_service_refresh_helper_free (helper);
 		return;
 	}
-	if (g_strcmp0 (signal_name, "DeviceRemoved") == 0) {
-		dev = fwupd_device_from_variant (parameters);
-		g_debug ("Emitting ::device-removed(%s)",
-			 fwupd_device_get_id (dev));
-		gfu_main_device_removed_cb (self->client, dev, self);
+	if (!gfu_engine_download_check (msg, uri_str, helper->fn_asc, NULL, &error)) {
+		gfu_main_service_refresh_done (helper, error);
 		return;
 	}
-	if (g_strcmp0 (signal_name, "DeviceChanged") == 0) {
-		FwupdStatus status = fwupd_client_get_status (self->client);
-		gint percentage;
-		g_autoptr(GString) status_str = g_string_new (NULL);
-		g_autofree gchar *device_str = NULL;
 
-		dev = fwupd_device_from_variant (parameters);
+	/* the daemon reads the files from the descriptors */
+	fd_list = g_unix_fd_list_new ();
+	if (!gfu_main_service_fd_list_append (fd_list, helper->fn, &error) ||
+	    !gfu_main_service_fd_list_append (fd_list, helper->fn_asc, &error)) {
+		g_object_unref (fd_list);
+		gfu_main_service_refresh_done (helper, error);
+		return;
+	}
+	g_dbus_proxy_call_with_unix_fd_list (self->proxy,
+					     "UpdateMetadata",
+					     g_variant_new ("(shh)", fwupd_remote_get_id (remote), 0, 1),
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1,
+					     fd_list,
+					     self->cancellable,
+					     gfu_main_service_update_metadata_cb,
+					     helper);
+	g_object_unref (fd_list);
+}
 
-		/* update progress */
-		percentage = fwupd_client_get_percentage (self->client);
-		g_string_append_printf (status_str, "%s: %d%%\n",
-					gfu_status_to_string (status),
-					percentage);
+static void
+gfu_main_service_metadata_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	GfuServiceRefreshHelper *helper = (GfuServiceRefreshHelper *) user_data;
+	FwupdRemote *remote = g_ptr_array_index (helper->remotes, helper->idx);
+	g_autofree gchar *uri_str = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
+	g_autoptr(GError) error = NULL;
 
-		/* once we have good data show an estimate of time remaining */
-		if (gfu_main_estimate_ready (self, percentage)) {
-			g_autofree gchar *remaining = gfu_main_time_remaining_str (self);
-			if (remaining != NULL)
-				g_string_append_printf (status_str, "%s…", remaining);
-		}
-		gfu_main_set_install_status_label (self, status_str->str);
+	/* aborted from gfu_main_free() */
+	if (msg->status_code == SOUP_STATUS_CANCELLED) {
+		gfu_main_service_refresh_helper_free (helper);
+		return;
+	}
+	if (!gfu_engine_download_check (msg, uri_str, helper->fn, NULL, &error) ||
+	    !gfu_main_service_refresh_queue (helper,
+					     fwupd_remote_get_metadata_uri_sig (remote),
+					     gfu_main_service_signature_cb,
+					     &error))
+		gfu_main_service_refresh_done (helper, error);
+}
 
-		/* same as last time, so ignore */
-		if (self->device != NULL &&
-		    fwupd_device_compare (self->device, dev) == 0)
-			return;
+static void
+gfu_main_service_refresh_next (GfuServiceRefreshHelper *helper)
+{
+	g_autoptr(GError) error = NULL;
 
-		device_str = gfu_operation_to_string (self->current_operation,
-						      dev);
-		gfu_main_set_install_loading_label (self, device_str);
+	for (; helper->idx < helper->remotes->len; helper->idx++) {
+		FwupdRemote *remote = g_ptr_array_index (helper->remotes, helper->idx);
+		if (!fwupd_remote_get_enabled (remote))
+			continue;
+		if (fwupd_remote_get_kind (remote) != FWUPD_REMOTE_KIND_DOWNLOAD)
+			continue;
 
+		/* only metadata older than the interval is downloaded */
+		if (fwupd_remote_get_age (remote) < GFU_MAIN_SERVICE_REFRESH_INTERVAL) {
+			g_debug ("%s is recent enough", fwupd_remote_get_id (remote));
+			continue;
+		}
+		g_free (helper->fn);
+		g_free (helper->fn_asc);
+		helper->fn = gfu_engine_remote_cache_path (remote, fwupd_remote_get_filename_cache (remote));
+		helper->fn_asc = gfu_engine_remote_cache_path (remote, fwupd_remote_get_filename_cache_sig (remote));
+		if (!gfu_common_mkdir_parent (helper->fn, &error) ||
+		    !gfu_main_service_refresh_queue (helper,
+						     fwupd_remote_get_metadata_uri (remote),
+						     gfu_main_service_metadata_cb,
+						     &error)) {
+			gfu_main_service_refresh_done (helper, error);
+		}
 		return;
 	}
-
-	g_debug ("Unknown signal name '%s' from %s", signal_name, sender_name);
+	gfu_main_service_refresh_done (helper, NULL);
 }
 
 static void
-gfu_main_proxy_new_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+gfu_main_service_remotes_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
+	GfuServiceRefreshHelper *helper = (GfuServiceRefreshHelper *) user_data;
 	g_autoptr(GError) error = NULL;
-	GfuMain *self = (GfuMain *) user_data;
-	self->proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+	g_autoptr(GVariant) tmp = NULL;
 
-	if (self->proxy == NULL) {
-		gfu_main_error_dialog (self, _("Error connecting to fwupd"), error->message);
+	/* GfuMain has already been freed */
+	tmp = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_free (helper);
+		return;
+	}
+	if (tmp == NULL) {
+		helper->remotes = g_ptr_array_new ();
+		gfu_main_service_refresh_done (helper, error);
 		return;
 	}
+	helper->remotes = fwupd_remote_array_from_variant (tmp);
+	gfu_main_service_refresh_next (helper);
+}
 
-	/* async call for devices */
-	g_dbus_proxy_call (self->proxy,
-			   "GetDevices",
-			   NULL,
-			   G_DBUS_CALL_FLAGS_NONE,
-			   -1,
-			   self->cancellable,
-			   (GAsyncReadyCallback) gfu_main_update_devices_cb,
-			   self);
+static void
+gfu_main_service_refresh (GfuMain *self)
+{
+	GfuServiceRefreshHelper *helper;
 
-	/* async call for remotes */
+	/* the user is doing something already, or the last one is still going */
+	if (self->proxy == NULL || self->stale || self->update_all != NULL ||
+	    self->service_refreshing)
+		return;
+	self->service_refreshing = TRUE;
+	helper = g_new0 (GfuServiceRefreshHelper, 1);
+	helper->self = self;
 	g_dbus_proxy_call (self->proxy,
 			   "GetRemotes",
 			   NULL,
 			   G_DBUS_CALL_FLAGS_NONE,
 			   -1,
 			   self->cancellable,
-			   (GAsyncReadyCallback) gfu_main_update_remotes_cb,
-			   self);
-
-	/* connecting signals for updating devices */
-	g_signal_connect (self->proxy, "g-signal",
-			  G_CALLBACK (gfu_main_signals_cb), self);
+			   gfu_main_service_remotes_cb,
+			   helper);
 }
 
-static void
-gfu_main_device_unlock_cb (GtkWidget *widget, GfuMain *self)
+static gboolean
+gfu_main_service_refresh_cb (gpointer user_data)
 {
-	g_autoptr(GError) error = NULL;
-	if (!fwupd_client_unlock (self->client,
-				  fwupd_device_get_id (self->device),
-				  self->cancellable,
-				  &error)) {
-		gfu_main_error_dialog (self, _("Failed to unlock device"), error->message);
-	} else {
-		gfu_main_reboot_shutdown_prompt (self);
-	}
-}
+	GfuMain *self = (GfuMain *) user_data;
+	guint delay;
 
-static void
-gfu_main_infobar_close_cb (GtkInfoBar *infobar, gpointer user_data)
-{
-	gtk_info_bar_set_revealed (infobar, FALSE);
+	gfu_main_service_refresh (self);
+
+	/* spread machines that booted at the same time across the window */
+	delay = GFU_MAIN_SERVICE_REFRESH_INTERVAL +
+		g_random_int_range (-GFU_MAIN_SERVICE_REFRESH_JITTER,
+				    GFU_MAIN_SERVICE_REFRESH_JITTER);
+	g_debug ("next metadata refresh in %us", delay);
+	self->service_refresh_id = g_timeout_add_seconds (delay, gfu_main_service_refresh_cb, self);
+	return FALSE;
 }
 
-static void
-gfu_main_infobar_response_cb (GtkInfoBar *infobar, gint response_id, gpointer user_data)
+static gboolean
+gfu_main_window_delete_event_cb (GtkWidget *widget, GdkEvent *event, GfuMain *self)
 {
-	if (response_id == GTK_RESPONSE_CLOSE)
-		gtk_info_bar_set_revealed (infobar, FALSE);
+	/* keep the widgets for next time */
+	if (self->service)
+		return gtk_widget_hide_on_delete (widget);
+	return FALSE;
 }
 
-static void
-gfu_main_startup_cb (GApplication *application, GfuMain *self)
+static gboolean
+gfu_main_ensure_ui (GfuMain *self, GError **error)
 {
 	GtkWidget *w;
 	GtkWidget *main_window;
 	gint retval;
-	g_autofree gchar *filename = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GBytes) ui = NULL;
 
-	/* add application menu items */
-	g_action_map_add_action_entries (G_ACTION_MAP (application),
-					 actions, G_N_ELEMENTS (actions),
-					 self);
+	if (self->builder != NULL)
+		return TRUE;
 
-	/* get UI */
+	/* get UI, decompressed separately so that it can be timed */
+	ui = g_resources_lookup_data ("/org/gnome/Firmware/gfu-main.ui",
+				      G_RESOURCE_LOOKUP_FLAGS_NONE,
+				      error);
+	if (ui == NULL)
+		return FALSE;
+	gfu_main_startup_mark (self, GFU_MAIN_STARTUP_RESOURCE);
 	self->builder = gtk_builder_new ();
-	retval = gtk_builder_add_from_resource (self->builder,
-						"/org/gnome/Firmware/gfu-main.ui",
-						&error);
+	retval = gtk_builder_add_from_string (self->builder,
+					      g_bytes_get_data (ui, NULL),
+					      g_bytes_get_size (ui),
+					      error);
 	if (retval == 0) {
-		g_warning ("failed to load ui: %s", error->message);
-		return;
+		g_clear_object (&self->builder);
+		return FALSE;
 	}
+	gfu_main_startup_mark (self, GFU_MAIN_STARTUP_BUILDER);
+
+	/* widgets used on every refresh */
+	self->stack_main = GTK_WIDGET (gtk_builder_get_object (self->builder, "stack_main"));
+	self->grid_device_flags = GTK_WIDGET (gtk_builder_get_object (self->builder, "grid_device_flags"));
+	self->menu_button = GTK_WIDGET (gtk_builder_get_object (self->builder, "menu_button"));
+	self->button_back = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_back"));
+	self->button_unlock = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_unlock"));
+	self->button_verify = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_verify"));
+	self->button_verify_update = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_verify_update"));
+	self->button_releases = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_releases"));
 
 	main_window = GTK_WIDGET (gtk_builder_get_object (self->builder, "dialog_main"));
 	gtk_application_add_window (self->application, GTK_WINDOW (main_window));
+	g_signal_connect (main_window, "map-event",
+			  G_CALLBACK (gfu_main_window_map_event_cb), self);
+	g_signal_connect (main_window, "delete-event",
+			  G_CALLBACK (gfu_main_window_delete_event_cb), self);
 
 	/* hide window first so that the dialogue resizes itself without redrawing */
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "stack_main"));
@@ -1706,29 +3180,75 @@ gfu_main_startup_cb (GApplication *application, GfuMain *self)
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_back"));
 	g_signal_connect (w, "clicked",
 			  G_CALLBACK (gfu_main_button_back_cb), self);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_install"));
-	g_signal_connect (w, "clicked",
-			  G_CALLBACK (gfu_main_release_install_file_cb), self);
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "button_infobar_enable_lvfs"));
 	g_signal_connect (w, "clicked",
 			  G_CALLBACK (gfu_main_enable_lvfs_cb), self);
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_main"));
+	gtk_list_box_bind_model (GTK_LIST_BOX (w), gfu_device_store_get_model (self->devices),
+				 gfu_main_device_row_create_cb, self, NULL);
+	g_signal_connect_after (gfu_device_store_get_model (self->devices), "items-changed",
+				G_CALLBACK (gfu_main_devices_changed_cb), self);
+	gtk_list_box_set_filter_func (GTK_LIST_BOX (w), gfu_main_device_row_filter_cb, self, NULL);
 	g_signal_connect (w, "row-selected",
 			  G_CALLBACK (gfu_main_device_row_selected_cb), self);
-	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "listbox_firmware"));
-	g_signal_connect (w, "row-selected",
-			  G_CALLBACK (gfu_main_release_row_selected_cb), self);
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "infobar_enable_lvfs"));
 	g_signal_connect (w, "close",
 			  G_CALLBACK (gfu_main_infobar_close_cb), self);
 	w = GTK_WIDGET (gtk_builder_get_object (self->builder, "infobar_enable_lvfs"));
 	g_signal_connect (w, "response",
 			  G_CALLBACK (gfu_main_infobar_response_cb), self);
+	gtk_info_bar_set_revealed (GTK_INFO_BAR (w), self->lvfs_disabled);
+
+	/* the devices may have been loaded before the window */
+	gfu_main_refresh_groups (self);
+	gfu_main_select_first_device (self);
 
 	/* show main UI */
 	gfu_main_update_title (self);
+	gfu_main_invalidate (self, GFU_MAIN_SECTION_ALL);
 	gfu_main_refresh_ui (self);
 	gtk_widget_show (main_window);
+	return TRUE;
+}
+
+static void
+gfu_main_startup_cb (GApplication *application, GfuMain *self)
+{
+	const gchar *accels_diagnostics[] = { "<Primary><Shift>d", NULL };
+	g_autoptr(GError) error = NULL;
+
+	/* add application menu items */
+	g_action_map_add_action_entries (G_ACTION_MAP (application),
+					 actions, G_N_ELEMENTS (actions),
+					 self);
+
+	/* not in any menu */
+	gtk_application_set_accels_for_action (GTK_APPLICATION (application),
+					       "app.diagnostics", accels_diagnostics);
+
+	/* show the last known devices in the first frame */
+	if (!gfu_main_snapshot_load (self, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_debug ("ignoring snapshot: %s", error->message);
+		g_clear_error (&error);
+	}
+
+	/* stay running with no window, and refresh soon after boot */
+	if (self->service) {
+		g_application_hold (application);
+		self->service_refresh_id =
+			g_timeout_add_seconds (g_random_int_range (GFU_MAIN_SERVICE_REFRESH_FIRST,
+								   2 * GFU_MAIN_SERVICE_REFRESH_FIRST),
+					       gfu_main_service_refresh_cb, self);
+	}
+
+	/* watch the daemon traffic from the very first call */
+	if (self->record_filename != NULL || self->latencies != NULL) {
+		if (!gfu_main_recorder_start (self, &error)) {
+			gfu_main_error_dialog (self, _("Failed to record D-Bus traffic"), error->message);
+			g_clear_error (&error);
+		}
+	}
 
 	g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
 				  G_DBUS_PROXY_FLAGS_NONE,
@@ -1744,25 +3264,74 @@ gfu_main_startup_cb (GApplication *application, GfuMain *self)
 static void
 gfu_main_free (GfuMain *self)
 {
-	if (self->builder != NULL)
-		g_object_unref (self->builder);
+	/* the aborted prefetches call back into the jobs, so do this first */
+	if (self->cancellable != NULL)
+		g_cancellable_cancel (self->cancellable);
+	if (self->engine != NULL)
+		gfu_engine_abort (self->engine);
+	if (self->update_all != NULL)
+		g_ptr_array_unref (self->update_all);
+	if (self->update_all_query != NULL)
+		gfu_main_update_all_query_free (self->update_all_query);
+	if (self->prefetch != NULL)
+		g_ptr_array_unref (self->prefetch);
+	if (self->update_all_id != 0)
+		g_source_remove (self->update_all_id);
+	if (self->groups_refresh_id != 0)
+		g_source_remove (self->groups_refresh_id);
+
+	g_clear_object (&self->builder);
 	if (self->cancellable != NULL)
 		g_object_unref (self->cancellable);
 	if (self->device != NULL)
 		g_object_unref (self->device);
 	if (self->release != NULL)
 		g_object_unref (self->release);
-	if (self->client != NULL)
-		g_object_unref (self->client);
 	if (self->application != NULL)
 		g_object_unref (self->application);
 	if (self->releases != NULL)
 		g_ptr_array_unref (self->releases);
 	if (self->proxy != NULL)
 		g_object_unref (self->proxy);
-	if (self->soup_session != NULL)
-		g_object_unref (self->soup_session);
-	g_timer_destroy (self->time_elapsed);
+	if (self->engine != NULL)
+		g_object_unref (self->engine);
+	if (self->snapshot_save_id != 0) {
+		g_autoptr(GError) error = NULL;
+		g_source_remove (self->snapshot_save_id);
+		if (!gfu_main_snapshot_save (self, &error))
+			g_debug ("failed to save snapshot: %s", error->message);
+	}
+	if (self->snapshot_devices != NULL)
+		g_variant_unref (self->snapshot_devices);
+	if (self->snapshot_releases != NULL)
+		g_hash_table_unref (self->snapshot_releases);
+	if (self->service_refresh_id != 0)
+		g_source_remove (self->service_refresh_id);
+	if (self->estimator != NULL)
+		g_object_unref (self->estimator);
+	if (self->devices != NULL)
+		g_object_unref (self->devices);
+	if (self->release_rows != NULL)
+		g_hash_table_unref (self->release_rows);
+	if (self->releases_pending_id != 0)
+		g_source_remove (self->releases_pending_id);
+	if (self->diagnostics_id != 0)
+		g_source_remove (self->diagnostics_id);
+	if (self->labels != NULL)
+		g_hash_table_unref (self->labels);
+	if (self->descriptions != NULL)
+		g_hash_table_unref (self->descriptions);
+	if (self->scratch != NULL)
+		g_string_free (self->scratch, TRUE);
+	if (self->startup_timer != NULL)
+		g_timer_destroy (self->startup_timer);
+	if (self->recorder != NULL)
+		g_object_unref (self->recorder);
+	if (self->watchdog != NULL)
+		g_object_unref (self->watchdog);
+	if (self->latencies != NULL)
+		g_array_unref (self->latencies);
+	g_free (self->record_filename);
 	g_free (self);
 }
 
@@ -1772,6 +3341,11 @@ int
 main (int argc, char **argv)
 {
 	gboolean verbose = FALSE;
+	gboolean measure_latency = FALSE;
+	gint stall_threshold = -1;
+	gint status;
+	g_autofree gchar *trace = NULL;
+	g_autofree gchar *bus = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GfuMain) self = g_new0 (GfuMain, 1);
 	g_autoptr(GOptionContext) context = NULL;
@@ -1779,9 +3353,29 @@ main (int argc, char **argv)
 		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
 			/* TRANSLATORS: command line option */
 			_("Show extra debugging information"), NULL },
+		{ "gapplication-service", '\0', 0, G_OPTION_ARG_NONE, &self->service,
+			/* TRANSLATORS: command line option */
+			_("Keep running in the background and refresh metadata"), NULL },
+		{ "bus", '\0', 0, G_OPTION_ARG_STRING, &bus,
+			/* TRANSLATORS: command line option */
+			_("Talk to fwupd on system, session or a bus address"), NULL },
+		{ "record", '\0', 0, G_OPTION_ARG_FILENAME, &self->record_filename,
+			/* TRANSLATORS: command line option */
+			_("Record the D-Bus traffic with fwupd to a file"), _("FILENAME") },
+		{ "measure-latency", '\0', 0, G_OPTION_ARG_NONE, &measure_latency,
+			/* TRANSLATORS: command line option */
+			_("Show how long each D-Bus event took to handle when quitting"), NULL },
+		{ "stall-threshold", '\0', 0, G_OPTION_ARG_INT, &stall_threshold,
+			/* TRANSLATORS: command line option */
+			_("Log when the window is blocked for longer than this, 0 to disable"), _("MILLISECONDS") },
+		{ "trace", '\0', 0, G_OPTION_ARG_FILENAME, &trace,
+			/* TRANSLATORS: command line option */
+			_("Write a trace that can be opened in a trace viewer"), _("FILENAME") },
 		{ NULL}
 	};
 
+	/* everything before the first frame is measured from here */
+	self->startup_timer = g_timer_new ();
 	setlocale (LC_ALL, "");
 
 	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
@@ -1798,21 +3392,68 @@ main (int argc, char **argv)
 			 error->message);
 		return EXIT_FAILURE;
 	}
+	if (!gfu_common_set_bus (bus, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	if (trace != NULL && !gfu_trace_start (trace, &error)) {
+		g_printerr ("Failed to start trace: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
 
 	self->cancellable = g_cancellable_new ();
-	self->client = fwupd_client_new ();
-	self->time_elapsed = g_timer_new ();
+	self->engine = gfu_engine_new ();
+	self->client = gfu_engine_get_client (self->engine);
+	g_signal_connect (self->engine, "status-changed",
+			  G_CALLBACK (gfu_main_engine_status_changed_cb), self);
+	self->estimator = gfu_estimator_new ();
+	self->devices = gfu_device_store_new ();
+	self->snapshot_releases = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free, (GDestroyNotify) g_variant_unref);
+	g_signal_connect (self->devices, "device-changed",
+			  G_CALLBACK (gfu_main_device_changed_cb), self);
+	self->release_rows = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->labels = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	self->descriptions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	self->scratch = g_string_sized_new (1024);
+	self->device_flags_shown = G_MAXUINT64;
+	if (measure_latency) {
+		self->latencies = g_array_new (FALSE, TRUE, sizeof(GfuMainLatency));
+		g_array_set_clear_func (self->latencies, gfu_main_latency_clear);
+	}
 
 	/* ensure single instance */
-	self->application = gtk_application_new ("org.gnome.Firmware", 0);
+	self->application = gtk_application_new ("org.gnome.Firmware",
+						 self->service ? G_APPLICATION_IS_SERVICE :
+								 G_APPLICATION_FLAGS_NONE);
 	g_signal_connect (self->application, "startup",
 			  G_CALLBACK (gfu_main_startup_cb), self);
 	g_signal_connect (self->application, "activate",
 			  G_CALLBACK (gfu_main_activate_cb), self);
 	/* set verbose? */
-	if (verbose)
+	if (verbose) {
 		g_setenv ("G_MESSAGES_DEBUG", "all", FALSE);
+		gfu_common_flag_info_check ();
+	}
+
+	/* watch for stalls by default only when debugging */
+	if (stall_threshold < 0)
+		stall_threshold = verbose ? GFU_MAIN_STALL_THRESHOLD : 0;
+	if (stall_threshold > 0)
+		self->watchdog = gfu_watchdog_new (stall_threshold);
 
 	/* wait */
-	return g_application_run (G_APPLICATION (self->application), argc, argv);
+	status = g_application_run (G_APPLICATION (self->application), argc, argv);
+
+	/* the loop is not running now, so stop before it looks like a stall */
+	if (self->watchdog != NULL) {
+		g_autofree gchar *stalls = gfu_watchdog_to_string (self->watchdog);
+		g_debug ("main loop stalls: %s", stalls);
+		g_clear_object (&self->watchdog);
+	}
+	gfu_main_recorder_stop (self);
+	if (!gfu_trace_stop (&error))
+		g_printerr ("Failed to save trace: %s\n", error->message);
+	return status;
 }
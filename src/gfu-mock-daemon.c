@@ -0,0 +1,991 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <fwupd.h>
+
+#include "gfu-common.h"
+#include "gfu-recorder.h"
+
+/* only the subset of org.freedesktop.fwupd and logind that the GUI and CLI use */
+static const gchar gfu_mock_introspection[] =
+	"<node>"
+	"  <interface name='org.freedesktop.fwupd'>"
+	"    <property name='DaemonVersion' type='s' access='read'/>"
+	"    <property name='Tainted' type='b' access='read'/>"
+	"    <property name='Status' type='u' access='read'/>"
+	"    <property name='Percentage' type='u' access='read'/>"
+	"    <method name='GetDevices'>"
+	"      <arg type='aa{sv}' name='devices' direction='out'/>"
+	"    </method>"
+	"    <method name='GetReleases'>"
+	"      <arg type='s' name='device_id' direction='in'/>"
+	"      <arg type='aa{sv}' name='releases' direction='out'/>"
+	"    </method>"
+	"    <method name='GetUpgrades'>"
+	"      <arg type='s' name='device_id' direction='in'/>"
+	"      <arg type='aa{sv}' name='releases' direction='out'/>"
+	"    </method>"
+	"    <method name='GetDowngrades'>"
+	"      <arg type='s' name='device_id' direction='in'/>"
+	"      <arg type='aa{sv}' name='releases' direction='out'/>"
+	"    </method>"
+	"    <method name='GetRemotes'>"
+	"      <arg type='aa{sv}' name='remotes' direction='out'/>"
+	"    </method>"
+	"    <method name='GetDetails'>"
+	"      <arg type='h' name='handle' direction='in'/>"
+	"      <arg type='aa{sv}' name='results' direction='out'/>"
+	"    </method>"
+	"    <method name='Install'>"
+	"      <arg type='s' name='device_id' direction='in'/>"
+	"      <arg type='h' name='handle' direction='in'/>"
+	"      <arg type='a{sv}' name='options' direction='in'/>"
+	"    </method>"
+	"    <method name='Verify'>"
+	"      <arg type='s' name='device_id' direction='in'/>"
+	"    </method>"
+	"    <method name='VerifyUpdate'>"
+	"      <arg type='s' name='device_id' direction='in'/>"
+	"    </method>"
+	"    <method name='Unlock'>"
+	"      <arg type='s' name='device_id' direction='in'/>"
+	"    </method>"
+	"    <method name='ModifyRemote'>"
+	"      <arg type='s' name='remote_id' direction='in'/>"
+	"      <arg type='s' name='key' direction='in'/>"
+	"      <arg type='s' name='value' direction='in'/>"
+	"    </method>"
+	"    <method name='UpdateMetadata'>"
+	"      <arg type='s' name='remote_id' direction='in'/>"
+	"      <arg type='h' name='data' direction='in'/>"
+	"      <arg type='h' name='signature' direction='in'/>"
+	"    </method>"
+	"    <signal name='Changed'/>"
+	"    <signal name='DeviceAdded'>"
+	"      <arg type='a{sv}' name='device'/>"
+	"    </signal>"
+	"    <signal name='DeviceRemoved'>"
+	"      <arg type='a{sv}' name='device'/>"
+	"    </signal>"
+	"    <signal name='DeviceChanged'>"
+	"      <arg type='a{sv}' name='device'/>"
+	"    </signal>"
+	"  </interface>"
+	"  <interface name='org.freedesktop.login1.Manager'>"
+	"    <method name='Reboot'>"
+	"      <arg type='b' name='interactive' direction='in'/>"
+	"    </method>"
+	"    <method name='PowerOff'>"
+	"      <arg type='b' name='interactive' direction='in'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+#define GFU_MOCK_LOGIND_SERVICE		"org.freedesktop.login1"
+#define GFU_MOCK_LOGIND_PATH		"/org/freedesktop/login1"
+
+typedef struct {
+	gchar			*id;
+	gchar			*name;
+	gchar			*guid;
+	gint			 version;		/* release index */
+	guint64			 flags;
+	gboolean		 busy;
+} GfuMockDevice;
+
+typedef struct {
+	GMainLoop		*loop;
+	GDBusConnection		*connection;
+	GDBusNodeInfo		*introspection;
+	GPtrArray		*devices;		/* of GfuMockDevice */
+	GRand			*rand;
+	guint			 owner_id;
+	guint			 registration_id;
+	guint			 logind_owner_id;
+	guint			 logind_registration_id;
+	guint			 replug_id;
+	gint			 n_devices;
+	gint			 n_releases;
+	gdouble			 install_duration;	/* s */
+	gdouble			 signal_rate;		/* Hz */
+	gdouble			 replug_rate;		/* Hz */
+	FwupdStatus		 status;
+	guint			 percentage;
+	gchar			*tmpdir;
+	gchar			*payload_fn;
+	gchar			*payload_checksum;
+	gsize			 payload_size;
+	GPtrArray		*replay;		/* of GfuRecorderEvent, NULL unless replaying */
+	gboolean		*replay_consumed;	/* calls already answered */
+	GHashTable		*replay_calls;		/* recorded serial : live call */
+	GHashTable		*replay_held;		/* recorded serial : reply without a call yet */
+	gboolean		 replay_realtime;
+	guint			 replay_filter_id;
+} GfuMock;
+
+typedef struct {
+	GfuMock			*self;
+	GfuMockDevice		*device;
+	GDBusMethodInvocation	*invocation;
+	guint			 step;
+	guint			 steps;
+} GfuMockInstallHelper;
+
+static void
+gfu_mock_device_free (GfuMockDevice *device)
+{
+	g_free (device->id);
+	g_free (device->name);
+	g_free (device->guid);
+	g_free (device);
+}
+
+static void
+gfu_mock_free (GfuMock *self)
+{
+	if (self->replug_id != 0)
+		g_source_remove (self->replug_id);
+	if (self->registration_id != 0)
+		g_dbus_connection_unregister_object (self->connection, self->registration_id);
+	if (self->logind_registration_id != 0)
+		g_dbus_connection_unregister_object (self->connection, self->logind_registration_id);
+	if (self->logind_owner_id != 0)
+		g_bus_unown_name (self->logind_owner_id);
+	if (self->replay_filter_id != 0)
+		g_dbus_connection_remove_filter (self->connection, self->replay_filter_id);
+	if (self->owner_id != 0)
+		g_bus_unown_name (self->owner_id);
+	if (self->connection != NULL)
+		g_object_unref (self->connection);
+	if (self->introspection != NULL)
+		g_dbus_node_info_unref (self->introspection);
+	if (self->devices != NULL)
+		g_ptr_array_unref (self->devices);
+	if (self->rand != NULL)
+		g_rand_free (self->rand);
+	if (self->loop != NULL)
+		g_main_loop_unref (self->loop);
+	if (self->payload_fn != NULL) {
+		g_unlink (self->payload_fn);
+		g_free (self->payload_fn);
+	}
+	if (self->tmpdir != NULL) {
+		g_rmdir (self->tmpdir);
+		g_free (self->tmpdir);
+	}
+	if (self->replay != NULL)
+		g_ptr_array_unref (self->replay);
+	if (self->replay_calls != NULL)
+		g_hash_table_unref (self->replay_calls);
+	if (self->replay_held != NULL)
+		g_hash_table_unref (self->replay_held);
+	g_free (self->replay_consumed);
+	g_free (self->payload_checksum);
+	g_free (self);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuMock, gfu_mock_free)
+
+static gchar *
+gfu_mock_release_version (gint idx)
+{
+	return g_strdup_printf ("1.0.%i", idx);
+}
+
+static GfuMockDevice *
+gfu_mock_get_device (GfuMock *self, const gchar *device_id)
+{
+	for (guint i = 0; i < self->devices->len; i++) {
+		GfuMockDevice *device = g_ptr_array_index (self->devices, i);
+		if (g_strcmp0 (device->id, device_id) == 0)
+			return device;
+	}
+	return NULL;
+}
+
+static GVariant *
+gfu_mock_device_to_variant (GfuMockDevice *device)
+{
+	GVariantBuilder builder;
+	const gchar *guids[] = { device->guid, NULL };
+	g_autofree gchar *version = gfu_mock_release_version (device->version);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_DEVICE_ID,
+			       g_variant_new_string (device->id));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_NAME,
+			       g_variant_new_string (device->name));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_VENDOR,
+			       g_variant_new_string ("Mock Industries"));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_PLUGIN,
+			       g_variant_new_string ("mock"));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_GUID,
+			       g_variant_new_strv (guids, -1));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_VERSION,
+			       g_variant_new_string (version));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_FLAGS,
+			       g_variant_new_uint64 (device->flags));
+	return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+gfu_mock_release_to_variant (GfuMock *self, GfuMockDevice *device, gint idx)
+{
+	GVariantBuilder builder;
+	guint64 flags = FWUPD_RELEASE_FLAG_TRUSTED_PAYLOAD;
+	g_autofree gchar *version = gfu_mock_release_version (idx);
+	g_autofree gchar *uri = g_strdup_printf ("file://%s", self->payload_fn);
+	g_autofree gchar *description = NULL;
+
+	if (idx > device->version)
+		flags |= FWUPD_RELEASE_FLAG_IS_UPGRADE;
+	else if (idx < device->version)
+		flags |= FWUPD_RELEASE_FLAG_IS_DOWNGRADE;
+	description = g_strdup_printf ("<p>This release of %s fixes %i issues.</p>",
+				       device->name, idx);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_VERSION,
+			       g_variant_new_string (version));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_REMOTE_ID,
+			       g_variant_new_string ("mock"));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_URI,
+			       g_variant_new_string (uri));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_CHECKSUM,
+			       g_variant_new_string (self->payload_checksum));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_SIZE,
+			       g_variant_new_uint64 (self->payload_size));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_SUMMARY,
+			       g_variant_new_string ("Firmware for a mock device"));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_DESCRIPTION,
+			       g_variant_new_string (description));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_VENDOR,
+			       g_variant_new_string ("Mock Industries"));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_FLAGS,
+			       g_variant_new_uint64 (flags));
+	return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+gfu_mock_remote_to_variant (void)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_REMOTE_ID,
+			       g_variant_new_string ("mock"));
+	g_variant_builder_add (&builder, "{sv}", "Enabled",
+			       g_variant_new_boolean (TRUE));
+	g_variant_builder_add (&builder, "{sv}", "Type",
+			       g_variant_new_uint32 (FWUPD_REMOTE_KIND_DIRECTORY));
+	return g_variant_builder_end (&builder);
+}
+
+static void
+gfu_mock_emit_signal (GfuMock *self, const gchar *signal_name, GVariant *parameters)
+{
+	g_autoptr(GError) error = NULL;
+	if (!g_dbus_connection_emit_signal (self->connection,
+					    NULL,
+					    FWUPD_DBUS_PATH,
+					    FWUPD_DBUS_INTERFACE,
+					    signal_name,
+					    parameters,
+					    &error))
+		g_warning ("failed to emit %s: %s", signal_name, error->message);
+}
+
+static void
+gfu_mock_emit_device (GfuMock *self, const gchar *signal_name, GfuMockDevice *device)
+{
+	GVariant *val = gfu_mock_device_to_variant (device);
+	gfu_mock_emit_signal (self, signal_name, g_variant_new_tuple (&val, 1));
+}
+
+static void
+gfu_mock_set_status (GfuMock *self, FwupdStatus status, guint percentage)
+{
+	GVariantBuilder builder;
+
+	if (self->status == status && self->percentage == percentage)
+		return;
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	if (self->status != status) {
+		self->status = status;
+		g_variant_builder_add (&builder, "{sv}", "Status",
+				       g_variant_new_uint32 (status));
+	}
+	if (self->percentage != percentage) {
+		self->percentage = percentage;
+		g_variant_builder_add (&builder, "{sv}", "Percentage",
+				       g_variant_new_uint32 (percentage));
+	}
+	g_dbus_connection_emit_signal (self->connection,
+				       NULL,
+				       FWUPD_DBUS_PATH,
+				       "org.freedesktop.DBus.Properties",
+				       "PropertiesChanged",
+				       g_variant_new ("(sa{sv}as)",
+						      FWUPD_DBUS_INTERFACE,
+						      &builder, NULL),
+				       NULL);
+}
+
+static GVariant *
+gfu_mock_get_releases (GfuMock *self, GfuMockDevice *device, gint direction)
+{
+	GVariantBuilder builder;
+
+	/* newest first, like the daemon */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	for (gint i = self->n_releases - 1; i >= 0; i--) {
+		if (direction > 0 && i <= device->version)
+			continue;
+		if (direction < 0 && i >= device->version)
+			continue;
+		g_variant_builder_add_value (&builder,
+					     gfu_mock_release_to_variant (self, device, i));
+	}
+	return g_variant_new ("(aa{sv})", &builder);
+}
+
+static gboolean
+gfu_mock_install_cb (gpointer user_data)
+{
+	GfuMockInstallHelper *helper = (GfuMockInstallHelper *) user_data;
+	GfuMock *self = helper->self;
+	GfuMockDevice *device = helper->device;
+
+	/* still writing */
+	if (++helper->step < helper->steps) {
+		gfu_mock_set_status (self, FWUPD_STATUS_DEVICE_WRITE,
+				     (helper->step * 100) / helper->steps);
+		gfu_mock_emit_device (self, "DeviceChanged", device);
+		return G_SOURCE_CONTINUE;
+	}
+
+	/* always ends up on the newest version */
+	device->version = self->n_releases - 1;
+	device->busy = FALSE;
+	gfu_mock_set_status (self, FWUPD_STATUS_IDLE, 0);
+	gfu_mock_emit_device (self, "DeviceChanged", device);
+	gfu_mock_emit_signal (self, "Changed", NULL);
+	g_dbus_method_invocation_return_value (helper->invocation, NULL);
+	g_free (helper);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gfu_mock_install (GfuMock *self,
+		  GfuMockDevice *device,
+		  GDBusMethodInvocation *invocation)
+{
+	GfuMockInstallHelper *helper;
+	guint interval = MAX (1000 / self->signal_rate, 1);
+
+	if (device->busy) {
+		g_dbus_method_invocation_return_error (invocation,
+						       FWUPD_ERROR,
+						       FWUPD_ERROR_INTERNAL,
+						       "%s is already being updated",
+						       device->id);
+		return;
+	}
+	device->busy = TRUE;
+	helper = g_new0 (GfuMockInstallHelper, 1);
+	helper->self = self;
+	helper->device = device;
+	helper->invocation = invocation;
+	helper->steps = MAX (self->install_duration * self->signal_rate, 1);
+	gfu_mock_set_status (self, FWUPD_STATUS_DEVICE_WRITE, 0);
+	g_timeout_add (interval, gfu_mock_install_cb, helper);
+}
+
+static void
+gfu_mock_method_call_cb (GDBusConnection *connection,
+			 const gchar *sender,
+			 const gchar *object_path,
+			 const gchar *interface_name,
+			 const gchar *method_name,
+			 GVariant *parameters,
+			 GDBusMethodInvocation *invocation,
+			 gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+	GfuMockDevice *device = NULL;
+	const gchar *device_id = NULL;
+
+	g_debug ("%s%s", method_name, g_variant_get_type_string (parameters));
+
+	if (g_strcmp0 (method_name, "GetDevices") == 0) {
+		GVariantBuilder builder;
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+		for (guint i = 0; i < self->devices->len; i++) {
+			device = g_ptr_array_index (self->devices, i);
+			g_variant_builder_add_value (&builder,
+						     gfu_mock_device_to_variant (device));
+		}
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(aa{sv})", &builder));
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetRemotes") == 0) {
+		GVariant *val = gfu_mock_remote_to_variant ();
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(@aa{sv})",
+								      g_variant_new_array (NULL, &val, 1)));
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetDetails") == 0) {
+		g_dbus_method_invocation_return_error (invocation,
+						       FWUPD_ERROR,
+						       FWUPD_ERROR_NOT_SUPPORTED,
+						       "the mock daemon cannot parse archives");
+		return;
+	}
+	if (g_strcmp0 (method_name, "ModifyRemote") == 0 ||
+	    g_strcmp0 (method_name, "UpdateMetadata") == 0) {
+		g_dbus_method_invocation_return_value (invocation, NULL);
+		return;
+	}
+
+	/* everything else is about a device */
+	g_variant_get_child (parameters, 0, "&s", &device_id);
+	device = gfu_mock_get_device (self, device_id);
+	if (device == NULL) {
+		g_dbus_method_invocation_return_error (invocation,
+						       FWUPD_ERROR,
+						       FWUPD_ERROR_NOT_FOUND,
+						       "no device %s", device_id);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetReleases") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       gfu_mock_get_releases (self, device, 0));
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetUpgrades") == 0 ||
+	    g_strcmp0 (method_name, "GetDowngrades") == 0) {
+		gint direction = g_strcmp0 (method_name, "GetUpgrades") == 0 ? 1 : -1;
+		g_autoptr(GVariant) val = gfu_mock_get_releases (self, device, direction);
+		g_autoptr(GVariant) rels = g_variant_get_child_value (val, 0);
+		if (g_variant_n_children (rels) == 0) {
+			g_dbus_method_invocation_return_error (invocation,
+							       FWUPD_ERROR,
+							       FWUPD_ERROR_NOTHING_TO_DO,
+							       "no releases for %s",
+							       device_id);
+			return;
+		}
+		g_dbus_method_invocation_return_value (invocation, g_steal_pointer (&val));
+		return;
+	}
+	if (g_strcmp0 (method_name, "Install") == 0) {
+		gfu_mock_install (self, device, invocation);
+		return;
+	}
+	if (g_strcmp0 (method_name, "Verify") == 0 ||
+	    g_strcmp0 (method_name, "VerifyUpdate") == 0 ||
+	    g_strcmp0 (method_name, "Unlock") == 0) {
+		g_dbus_method_invocation_return_value (invocation, NULL);
+		return;
+	}
+	g_dbus_method_invocation_return_error (invocation,
+					       G_DBUS_ERROR,
+					       G_DBUS_ERROR_UNKNOWN_METHOD,
+					       "no such method %s", method_name);
+}
+
+static GVariant *
+gfu_mock_get_property_cb (GDBusConnection *connection,
+			  const gchar *sender,
+			  const gchar *object_path,
+			  const gchar *interface_name,
+			  const gchar *property_name,
+			  GError **error,
+			  gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+
+	if (g_strcmp0 (property_name, "DaemonVersion") == 0)
+		return g_variant_new_string (VERSION);
+	if (g_strcmp0 (property_name, "Tainted") == 0)
+		return g_variant_new_boolean (FALSE);
+	if (g_strcmp0 (property_name, "Status") == 0)
+		return g_variant_new_uint32 (self->status);
+	if (g_strcmp0 (property_name, "Percentage") == 0)
+		return g_variant_new_uint32 (self->percentage);
+	g_set_error (error,
+		     G_DBUS_ERROR,
+		     G_DBUS_ERROR_UNKNOWN_PROPERTY,
+		     "no such property %s", property_name);
+	return NULL;
+}
+
+static gboolean
+gfu_mock_replug_cb (gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+	GfuMockDevice *device;
+
+	if (self->devices->len == 0)
+		return G_SOURCE_CONTINUE;
+	device = g_ptr_array_index (self->devices,
+				    g_rand_int_range (self->rand, 0, self->devices->len));
+	if (device->busy)
+		return G_SOURCE_CONTINUE;
+	g_debug ("replugging %s", device->id);
+	gfu_mock_emit_device (self, "DeviceRemoved", device);
+	gfu_mock_emit_device (self, "DeviceAdded", device);
+	return G_SOURCE_CONTINUE;
+}
+
+/* replaying a trace recorded with firmware-update --record */
+
+typedef struct {
+	GfuMock			*self;
+	GDBusMessage		*message;
+} GfuMockReplayHelper;
+
+static void
+gfu_mock_replay_helper_free (GfuMockReplayHelper *helper)
+{
+	g_object_unref (helper->message);
+	g_free (helper);
+}
+
+static void
+gfu_mock_replay_reply (GfuMock *self, GDBusMessage *call, GDBusMessage *recorded)
+{
+	g_autoptr(GDBusMessage) reply = NULL;
+	g_autoptr(GError) error = NULL;
+
+	if (g_dbus_message_get_message_type (recorded) == G_DBUS_MESSAGE_TYPE_ERROR) {
+		const gchar *text = NULL;
+		GVariant *body = g_dbus_message_get_body (recorded);
+		if (body != NULL && g_variant_is_of_type (body, G_VARIANT_TYPE ("(s)")))
+			g_variant_get (body, "(&s)", &text);
+		reply = g_dbus_message_new_method_error_literal (call,
+								 g_dbus_message_get_error_name (recorded),
+								 text != NULL ? text : "");
+	} else {
+		reply = g_dbus_message_new_method_reply (call);
+		if (g_dbus_message_get_body (recorded) != NULL)
+			g_dbus_message_set_body (reply, g_dbus_message_get_body (recorded));
+	}
+	if (!g_dbus_connection_send_message (self->connection, reply,
+					     G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+					     NULL, &error))
+		g_warning ("failed to send reply: %s", error->message);
+}
+
+static void
+gfu_mock_replay_event (GfuMock *self, GDBusMessage *recorded)
+{
+	gpointer serial;
+	GDBusMessage *call;
+	g_autoptr(GError) error = NULL;
+
+	if (g_dbus_message_get_message_type (recorded) == G_DBUS_MESSAGE_TYPE_SIGNAL) {
+		if (!g_dbus_connection_emit_signal (self->connection,
+						    NULL,
+						    g_dbus_message_get_path (recorded),
+						    g_dbus_message_get_interface (recorded),
+						    g_dbus_message_get_member (recorded),
+						    g_dbus_message_get_body (recorded),
+						    &error))
+			g_warning ("failed to emit signal: %s", error->message);
+		return;
+	}
+
+	/* the call may not have been made yet if the client reordered them */
+	serial = GUINT_TO_POINTER (g_dbus_message_get_reply_serial (recorded));
+	call = g_hash_table_lookup (self->replay_calls, serial);
+	if (call == NULL) {
+		g_hash_table_insert (self->replay_held, serial, g_object_ref (recorded));
+		return;
+	}
+	gfu_mock_replay_reply (self, call, recorded);
+	g_hash_table_remove (self->replay_calls, serial);
+}
+
+static gboolean
+gfu_mock_replay_event_cb (gpointer user_data)
+{
+	GfuMockReplayHelper *helper = (GfuMockReplayHelper *) user_data;
+	gfu_mock_replay_event (helper->self, helper->message);
+	return G_SOURCE_REMOVE;
+}
+
+/* everything recorded after a call and before the next one */
+static void
+gfu_mock_replay_segment (GfuMock *self, guint idx, guint64 base)
+{
+	for (guint i = idx; i < self->replay->len; i++) {
+		GfuRecorderEvent *event = g_ptr_array_index (self->replay, i);
+		GfuMockReplayHelper *helper;
+
+		if (g_dbus_message_get_message_type (event->message) == G_DBUS_MESSAGE_TYPE_METHOD_CALL)
+			break;
+		if (!self->replay_realtime) {
+			gfu_mock_replay_event (self, event->message);
+			continue;
+		}
+		helper = g_new0 (GfuMockReplayHelper, 1);
+		helper->self = self;
+		helper->message = g_object_ref (event->message);
+		g_timeout_add_full (G_PRIORITY_DEFAULT,
+				    (event->timestamp - base) / 1000,
+				    gfu_mock_replay_event_cb, helper,
+				    (GDestroyNotify) gfu_mock_replay_helper_free);
+	}
+}
+
+/* the first unused call with the same method, preferring the same arguments */
+static gint
+gfu_mock_replay_match (GfuMock *self, GDBusMessage *call)
+{
+	GVariant *body = g_dbus_message_get_body (call);
+	gint idx = -1;
+
+	for (guint i = 0; i < self->replay->len; i++) {
+		GfuRecorderEvent *event = g_ptr_array_index (self->replay, i);
+		GVariant *body_tmp;
+
+		if (self->replay_consumed[i])
+			continue;
+		if (g_dbus_message_get_message_type (event->message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL)
+			continue;
+		if (g_strcmp0 (g_dbus_message_get_interface (event->message),
+			       g_dbus_message_get_interface (call)) != 0 ||
+		    g_strcmp0 (g_dbus_message_get_member (event->message),
+			       g_dbus_message_get_member (call)) != 0)
+			continue;
+		body_tmp = g_dbus_message_get_body (event->message);
+		if (body == body_tmp ||
+		    (body != NULL && body_tmp != NULL && g_variant_equal (body, body_tmp)))
+			return i;
+		if (idx < 0)
+			idx = i;
+	}
+	return idx;
+}
+
+static gboolean
+gfu_mock_replay_call_cb (gpointer user_data)
+{
+	GfuMockReplayHelper *helper = (GfuMockReplayHelper *) user_data;
+	GfuMock *self = helper->self;
+	GfuRecorderEvent *event;
+	GDBusMessage *recorded;
+	gpointer serial;
+	gint idx;
+
+	idx = gfu_mock_replay_match (self, helper->message);
+	g_debug ("%s -> %i", g_dbus_message_get_member (helper->message), idx);
+	if (idx < 0) {
+		g_autoptr(GDBusMessage) reply = NULL;
+		reply = g_dbus_message_new_method_error (helper->message,
+							 "org.freedesktop.DBus.Error.Failed",
+							 "%s was not recorded",
+							 g_dbus_message_get_member (helper->message));
+		g_dbus_connection_send_message (self->connection, reply,
+						G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+						NULL, NULL);
+		return G_SOURCE_REMOVE;
+	}
+	self->replay_consumed[idx] = TRUE;
+	event = g_ptr_array_index (self->replay, idx);
+
+	/* the reply may already be due */
+	serial = GUINT_TO_POINTER (g_dbus_message_get_serial (event->message));
+	recorded = g_hash_table_lookup (self->replay_held, serial);
+	if (recorded != NULL) {
+		gfu_mock_replay_reply (self, helper->message, recorded);
+		g_hash_table_remove (self->replay_held, serial);
+	} else {
+		g_hash_table_insert (self->replay_calls, serial,
+				     g_object_ref (helper->message));
+	}
+	gfu_mock_replay_segment (self, idx + 1, event->timestamp);
+	return G_SOURCE_REMOVE;
+}
+
+/* runs in the GDBus worker, so only hand the call over to the main thread */
+static GDBusMessage *
+gfu_mock_replay_filter_cb (GDBusConnection *connection,
+			   GDBusMessage *message,
+			   gboolean incoming,
+			   gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+	GfuMockReplayHelper *helper;
+
+	if (!incoming ||
+	    g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL)
+		return message;
+	helper = g_new0 (GfuMockReplayHelper, 1);
+	helper->self = self;
+	helper->message = message;
+	g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT,
+				    gfu_mock_replay_call_cb, helper,
+				    (GDestroyNotify) gfu_mock_replay_helper_free);
+	return NULL;
+}
+
+static gboolean
+gfu_mock_replay_load (GfuMock *self, const gchar *filename, GError **error)
+{
+	self->replay = gfu_recorder_load (filename, error);
+	if (self->replay == NULL)
+		return FALSE;
+	self->replay_consumed = g_new0 (gboolean, self->replay->len);
+	self->replay_calls = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						    NULL, g_object_unref);
+	self->replay_held = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						   NULL, g_object_unref);
+	return TRUE;
+}
+
+/* the reboot prompt after an install, which must not do anything real */
+static void
+gfu_mock_logind_method_call_cb (GDBusConnection *connection,
+				const gchar *sender,
+				const gchar *object_path,
+				const gchar *interface_name,
+				const gchar *method_name,
+				GVariant *parameters,
+				GDBusMethodInvocation *invocation,
+				gpointer user_data)
+{
+	g_print ("Ignoring %s from %s\n", method_name, sender);
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static void
+gfu_mock_logind_name_acquired_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+	static const GDBusInterfaceVTable vtable = {
+		gfu_mock_logind_method_call_cb,
+		NULL,
+		NULL
+	};
+	g_autoptr(GError) error = NULL;
+
+	self->logind_registration_id = g_dbus_connection_register_object (connection,
+									  GFU_MOCK_LOGIND_PATH,
+									  self->introspection->interfaces[1],
+									  &vtable,
+									  self,
+									  NULL,
+									  &error);
+	if (self->logind_registration_id == 0) {
+		g_printerr ("Failed to register logind object: %s\n", error->message);
+		return;
+	}
+	g_print ("Acquired %s\n", name);
+}
+
+/* not fatal, as only the reboot prompt needs it */
+static void
+gfu_mock_logind_name_lost_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+	g_printerr ("Not mocking %s, is logind running on this bus?\n", name);
+}
+
+static void
+gfu_mock_bus_acquired_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+	g_autoptr(GError) error = NULL;
+	static const GDBusInterfaceVTable vtable = {
+		gfu_mock_method_call_cb,
+		gfu_mock_get_property_cb,
+		NULL
+	};
+
+	self->connection = g_object_ref (connection);
+	if (self->replay != NULL) {
+		self->replay_filter_id = g_dbus_connection_add_filter (connection,
+								       gfu_mock_replay_filter_cb,
+								       self, NULL);
+		return;
+	}
+	self->registration_id = g_dbus_connection_register_object (connection,
+								   FWUPD_DBUS_PATH,
+								   self->introspection->interfaces[0],
+								   &vtable,
+								   self,
+								   NULL,
+								   &error);
+	if (self->registration_id == 0) {
+		g_printerr ("Failed to register object: %s\n", error->message);
+		g_main_loop_quit (self->loop);
+	}
+}
+
+static void
+gfu_mock_name_acquired_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+
+	/* anything recorded before the first call */
+	if (self->replay != NULL) {
+		g_print ("Acquired %s replaying %u events\n", name, self->replay->len);
+		if (self->replay->len > 0) {
+			GfuRecorderEvent *event = g_ptr_array_index (self->replay, 0);
+			gfu_mock_replay_segment (self, 0, event->timestamp);
+		}
+		return;
+	}
+	g_print ("Acquired %s with %u devices\n", name, self->devices->len);
+	if (self->replug_rate > 0) {
+		self->replug_id = g_timeout_add (MAX (1000 / self->replug_rate, 1),
+						 gfu_mock_replug_cb, self);
+	}
+}
+
+static void
+gfu_mock_name_lost_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+	GfuMock *self = (GfuMock *) user_data;
+	g_printerr ("Lost %s, is fwupd already running on this bus?\n", name);
+	g_main_loop_quit (self->loop);
+}
+
+static gboolean
+gfu_mock_setup (GfuMock *self, GError **error)
+{
+	g_autofree gchar *data = NULL;
+
+	/* every release points at the same local payload */
+	self->tmpdir = g_dir_make_tmp ("gfu-mock-XXXXXX", error);
+	if (self->tmpdir == NULL)
+		return FALSE;
+	self->payload_fn = g_build_filename (self->tmpdir, "firmware.bin", NULL);
+	self->payload_size = 0x4000;
+	data = g_malloc (self->payload_size);
+	for (gsize i = 0; i < self->payload_size; i++)
+		data[i] = (gchar) (i & 0xff);
+	if (!g_file_set_contents (self->payload_fn, data, self->payload_size, error))
+		return FALSE;
+	self->payload_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+							      (const guchar *) data,
+							      self->payload_size);
+
+	/* identical GUIDs every ten devices so that grouping gets exercised */
+	for (gint i = 0; i < self->n_devices; i++) {
+		GfuMockDevice *device = g_new0 (GfuMockDevice, 1);
+		g_autofree gchar *guid_src = g_strdup_printf ("MOCK\\DEV_%04X", i % 10);
+		g_autofree gchar *id_src = g_strdup_printf ("mock-%i", i);
+		device->id = g_compute_checksum_for_string (G_CHECKSUM_SHA1, id_src, -1);
+		device->name = g_strdup_printf ("Mock Device %i", i % 10);
+		device->guid = fwupd_guid_hash_string (guid_src);
+		device->version = self->n_releases / 2;
+		device->flags = FWUPD_DEVICE_FLAG_UPDATABLE | FWUPD_DEVICE_FLAG_SUPPORTED;
+		g_ptr_array_add (self->devices, device);
+	}
+	return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+	gboolean verbose = FALSE;
+	g_autofree gchar *bus = NULL;
+	g_autofree gchar *replay = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GfuMock) self = g_new0 (GfuMock, 1);
+	g_autoptr(GOptionContext) context = NULL;
+	const GOptionEntry options[] = {
+		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+			"Show extra debugging information", NULL },
+		{ "bus", '\0', 0, G_OPTION_ARG_STRING, &bus,
+			"Own the name on system, session or a bus address", NULL },
+		{ "devices", '\0', 0, G_OPTION_ARG_INT, &self->n_devices,
+			"Number of devices", "N" },
+		{ "releases", '\0', 0, G_OPTION_ARG_INT, &self->n_releases,
+			"Number of releases for each device", "N" },
+		{ "install-duration", '\0', 0, G_OPTION_ARG_DOUBLE, &self->install_duration,
+			"Seconds taken to install a release", "SECONDS" },
+		{ "signal-rate", '\0', 0, G_OPTION_ARG_DOUBLE, &self->signal_rate,
+			"Progress signals per second while installing", "HZ" },
+		{ "replug-rate", '\0', 0, G_OPTION_ARG_DOUBLE, &self->replug_rate,
+			"Devices removed and added again per second", "HZ" },
+		{ "replay", '\0', 0, G_OPTION_ARG_FILENAME, &replay,
+			"Answer with the traffic from a recorded trace", "FILENAME" },
+		{ "realtime", '\0', 0, G_OPTION_ARG_NONE, &self->replay_realtime,
+			"Replay at the original timing rather than as fast as possible", NULL },
+		{ NULL}
+	};
+
+	setlocale (LC_ALL, "");
+
+	/* sensible defaults for a laptop-sized system */
+	self->n_devices = 10;
+	self->n_releases = 5;
+	self->install_duration = 5.f;
+	self->signal_rate = 10.f;
+	context = g_option_context_new ("- mock fwupd daemon");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("Failed to parse command line options: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	if (self->n_devices < 0 || self->n_releases < 1 || self->signal_rate <= 0) {
+		g_printerr ("Invalid --devices, --releases or --signal-rate\n");
+		return EXIT_FAILURE;
+	}
+	if (verbose)
+		g_setenv ("G_MESSAGES_DEBUG", "all", FALSE);
+	if (!gfu_common_set_bus (bus, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	self->loop = g_main_loop_new (NULL, FALSE);
+	self->rand = g_rand_new_with_seed (0);
+	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) gfu_mock_device_free);
+	self->introspection = g_dbus_node_info_new_for_xml (gfu_mock_introspection, &error);
+	if (self->introspection == NULL) {
+		g_printerr ("Failed to parse introspection: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	if (replay != NULL) {
+		if (!gfu_mock_replay_load (self, replay, &error)) {
+			g_printerr ("Failed to load trace: %s\n", error->message);
+			return EXIT_FAILURE;
+		}
+	} else if (!gfu_mock_setup (self, &error)) {
+		g_printerr ("Failed to create devices: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	self->owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
+					 FWUPD_DBUS_SERVICE,
+					 G_BUS_NAME_OWNER_FLAGS_NONE,
+					 gfu_mock_bus_acquired_cb,
+					 gfu_mock_name_acquired_cb,
+					 gfu_mock_name_lost_cb,
+					 self, NULL);
+	if (replay == NULL) {
+		self->logind_owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
+							GFU_MOCK_LOGIND_SERVICE,
+							G_BUS_NAME_OWNER_FLAGS_NONE,
+							NULL,
+							gfu_mock_logind_name_acquired_cb,
+							gfu_mock_logind_name_lost_cb,
+							self, NULL);
+	}
+	g_main_loop_run (self->loop);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <fwupd.h>
+
+#include "gfu-recorder.h"
+
+/*
+ * The trace is a short header followed by one record per message:
+ *
+ *   "GFUTRACE" | guint32 version
+ *   guint64 timestamp | guint32 size | D-Bus wire format blob
+ *
+ * All integers are little endian. The direction is implied by the message
+ * type, as only method calls are ever sent to the daemon.
+ */
+#define GFU_RECORDER_MAGIC		"GFUTRACE"
+#define GFU_RECORDER_VERSION		1
+#define GFU_RECORDER_HEADER_SIZE	(8 + 4)
+#define GFU_RECORDER_RECORD_SIZE	(8 + 4)
+
+struct _GfuRecorder {
+	GObject			 parent_instance;
+	GMutex			 mutex;		/* the filter runs in the GDBus worker */
+	GDBusConnection		*connection;
+	GMainContext		*context;
+	GOutputStream		*stream;	/* NULL unless recording */
+	gchar			*name_owner;
+	GHashTable		*serials;	/* serial : member, awaiting a reply */
+	guint			 filter_id;
+	gint64			 start;
+	gboolean		 measure;
+};
+
+enum {
+	SIGNAL_MESSAGE_DISPATCHED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+G_DEFINE_TYPE (GfuRecorder, gfu_recorder, G_TYPE_OBJECT)
+
+typedef struct {
+	GfuRecorder		*self;
+	GDBusMessage		*message;
+	gchar			*member;
+	gint64			 arrival;
+} GfuRecorderDispatchHelper;
+
+static void
+gfu_recorder_dispatch_helper_free (GfuRecorderDispatchHelper *helper)
+{
+	g_object_unref (helper->self);
+	g_object_unref (helper->message);
+	g_free (helper->member);
+	g_free (helper);
+}
+
+/* runs at the same priority as the GDBus callbacks it is standing in for */
+static gboolean
+gfu_recorder_dispatch_cb (gpointer user_data)
+{
+	GfuRecorderDispatchHelper *helper = (GfuRecorderDispatchHelper *) user_data;
+	g_signal_emit (helper->self, signals[SIGNAL_MESSAGE_DISPATCHED], 0,
+		       helper->message, helper->member, (guint64) helper->arrival);
+	return G_SOURCE_REMOVE;
+}
+
+/* returns the method name, or NULL if not to or from the daemon */
+static gchar *
+gfu_recorder_is_relevant (GfuRecorder *self, GDBusMessage *message, gboolean incoming)
+{
+	const gchar *name;
+	gchar *member;
+	guint32 serial;
+
+	/* everything for the daemon goes to the well-known name */
+	if (!incoming) {
+		name = g_dbus_message_get_destination (message);
+		if (g_strcmp0 (name, FWUPD_DBUS_SERVICE) != 0 &&
+		    g_strcmp0 (name, self->name_owner) != 0)
+			return NULL;
+		serial = g_dbus_message_get_serial (message);
+		g_hash_table_insert (self->serials, GUINT_TO_POINTER (serial),
+				     g_strdup (g_dbus_message_get_member (message)));
+		return g_strdup (g_dbus_message_get_member (message));
+	}
+
+	/* replies are matched by serial, so the owner can be learned from them */
+	serial = g_dbus_message_get_reply_serial (message);
+	member = g_hash_table_lookup (self->serials, GUINT_TO_POINTER (serial));
+	if (member != NULL) {
+		g_hash_table_steal (self->serials, GUINT_TO_POINTER (serial));
+		if (self->name_owner == NULL)
+			self->name_owner = g_strdup (g_dbus_message_get_sender (message));
+		return member;
+	}
+	name = g_dbus_message_get_sender (message);
+	if (name == NULL || g_strcmp0 (name, self->name_owner) != 0)
+		return NULL;
+	return g_strdup (g_dbus_message_get_member (message));
+}
+
+static void
+gfu_recorder_write (GfuRecorder *self, GDBusMessage *message, gint64 now)
+{
+	gsize blob_size = 0;
+	guchar hdr[GFU_RECORDER_RECORD_SIZE];
+	guint64 timestamp = GUINT64_TO_LE (now - self->start);
+	guint32 size;
+	g_autofree guchar *blob = NULL;
+	g_autoptr(GError) error = NULL;
+
+	blob = g_dbus_message_to_blob (message, &blob_size,
+				       G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING,
+				       &error);
+	if (blob == NULL) {
+		g_warning ("failed to serialize message: %s", error->message);
+		return;
+	}
+	size = GUINT32_TO_LE ((guint32) blob_size);
+	memcpy (hdr, &timestamp, sizeof(timestamp));
+	memcpy (hdr + 8, &size, sizeof(size));
+	if (!g_output_stream_write_all (self->stream, hdr, sizeof(hdr), NULL, NULL, &error) ||
+	    !g_output_stream_write_all (self->stream, blob, blob_size, NULL, NULL, &error)) {
+		g_warning ("failed to write trace, stopping: %s", error->message);
+		g_clear_object (&self->stream);
+	}
+}
+
+static GDBusMessage *
+gfu_recorder_filter_cb (GDBusConnection *connection,
+			GDBusMessage *message,
+			gboolean incoming,
+			gpointer user_data)
+{
+	GfuRecorder *self = GFU_RECORDER (user_data);
+	gint64 now = g_get_monotonic_time ();
+	g_autofree gchar *member = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+
+	member = gfu_recorder_is_relevant (self, message, incoming);
+	if (member == NULL)
+		return message;
+	if (self->stream != NULL)
+		gfu_recorder_write (self, message, now);
+	if (self->measure && incoming) {
+		GfuRecorderDispatchHelper *helper = g_new0 (GfuRecorderDispatchHelper, 1);
+		helper->self = g_object_ref (self);
+		helper->message = g_object_ref (message);
+		helper->member = g_steal_pointer (&member);
+		helper->arrival = now;
+		g_main_context_invoke_full (self->context, G_PRIORITY_DEFAULT,
+					    gfu_recorder_dispatch_cb, helper,
+					    (GDestroyNotify) gfu_recorder_dispatch_helper_free);
+	}
+	return message;
+}
+
+/* starts a new trace, replacing any existing file */
+gboolean
+gfu_recorder_set_filename (GfuRecorder *self, const gchar *filename, GError **error)
+{
+	guchar hdr[GFU_RECORDER_HEADER_SIZE];
+	guint32 version = GUINT32_TO_LE (GFU_RECORDER_VERSION);
+	g_autoptr(GFile) file = g_file_new_for_path (filename);
+	g_autoptr(GFileOutputStream) stream = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+
+	g_return_val_if_fail (GFU_IS_RECORDER (self), FALSE);
+
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return FALSE;
+	memcpy (hdr, GFU_RECORDER_MAGIC, 8);
+	memcpy (hdr + 8, &version, sizeof(version));
+	if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), hdr, sizeof(hdr),
+					NULL, NULL, error))
+		return FALSE;
+	g_clear_object (&self->stream);
+	self->stream = g_buffered_output_stream_new (G_OUTPUT_STREAM (stream));
+	self->start = g_get_monotonic_time ();
+	return TRUE;
+}
+
+/* emit ::message-dispatched for each reply and signal from the daemon */
+void
+gfu_recorder_set_measure (GfuRecorder *self, gboolean measure)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+	g_return_if_fail (GFU_IS_RECORDER (self));
+	self->measure = measure;
+}
+
+/* the daemon gets a new unique name each time it is started, NULL is unknown */
+void
+gfu_recorder_set_name_owner (GfuRecorder *self, const gchar *name_owner)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+	g_return_if_fail (GFU_IS_RECORDER (self));
+	g_free (self->name_owner);
+	self->name_owner = g_strdup (name_owner);
+}
+
+/* also sees the traffic of anything else sharing the connection, e.g. libfwupd */
+void
+gfu_recorder_attach (GfuRecorder *self,
+		     GDBusConnection *connection,
+		     const gchar *name_owner)
+{
+	g_return_if_fail (GFU_IS_RECORDER (self));
+	g_return_if_fail (G_IS_DBUS_CONNECTION (connection));
+	g_return_if_fail (self->connection == NULL);
+
+	gfu_recorder_set_name_owner (self, name_owner);
+	self->connection = g_object_ref (connection);
+	self->context = g_main_context_ref_thread_default ();
+	self->filter_id = g_dbus_connection_add_filter (connection,
+							gfu_recorder_filter_cb,
+							g_object_ref (self),
+							g_object_unref);
+}
+
+/* detaches from the connection and flushes the trace to disk */
+gboolean
+gfu_recorder_close (GfuRecorder *self, GError **error)
+{
+	g_autoptr(GOutputStream) stream = NULL;
+
+	g_return_val_if_fail (GFU_IS_RECORDER (self), FALSE);
+
+	if (self->filter_id != 0) {
+		g_dbus_connection_remove_filter (self->connection, self->filter_id);
+		self->filter_id = 0;
+	}
+	g_mutex_lock (&self->mutex);
+	stream = g_steal_pointer (&self->stream);
+	self->measure = FALSE;
+	g_mutex_unlock (&self->mutex);
+	if (stream == NULL)
+		return TRUE;
+	return g_output_stream_close (stream, NULL, error);
+}
+
+static void
+gfu_recorder_event_free (GfuRecorderEvent *event)
+{
+	g_object_unref (event->message);
+	g_free (event);
+}
+
+/* returns an array of GfuRecorderEvent in the order they were recorded */
+GPtrArray *
+gfu_recorder_load (const gchar *filename, GError **error)
+{
+	gsize bufsz = 0;
+	gsize offset = GFU_RECORDER_HEADER_SIZE;
+	guint32 version;
+	g_autofree gchar *buf = NULL;
+	g_autoptr(GPtrArray) events = NULL;
+
+	if (!g_file_get_contents (filename, &buf, &bufsz, error))
+		return NULL;
+	if (bufsz < GFU_RECORDER_HEADER_SIZE ||
+	    memcmp (buf, GFU_RECORDER_MAGIC, 8) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "%s is not a trace", filename);
+		return NULL;
+	}
+	memcpy (&version, buf + 8, sizeof(version));
+	if (GUINT32_FROM_LE (version) != GFU_RECORDER_VERSION) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "trace version %u not supported",
+			     GUINT32_FROM_LE (version));
+		return NULL;
+	}
+
+	events = g_ptr_array_new_with_free_func ((GDestroyNotify) gfu_recorder_event_free);
+	while (offset < bufsz) {
+		guint64 timestamp;
+		guint32 size;
+		GDBusMessage *message;
+		GfuRecorderEvent *event;
+
+		if (bufsz - offset < GFU_RECORDER_RECORD_SIZE) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "truncated record at 0x%x", (guint) offset);
+			return NULL;
+		}
+		memcpy (&timestamp, buf + offset, sizeof(timestamp));
+		memcpy (&size, buf + offset + 8, sizeof(size));
+		offset += GFU_RECORDER_RECORD_SIZE;
+		size = GUINT32_FROM_LE (size);
+		if (bufsz - offset < size) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "truncated message at 0x%x", (guint) offset);
+			return NULL;
+		}
+		message = g_dbus_message_new_from_blob ((guchar *) buf + offset, size,
+							G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING,
+							error);
+		if (message == NULL)
+			return NULL;
+		offset += size;
+
+		event = g_new0 (GfuRecorderEvent, 1);
+		event->timestamp = GUINT64_FROM_LE (timestamp);
+		event->message = message;
+		g_ptr_array_add (events, event);
+	}
+	return g_steal_pointer (&events);
+}
+
+static void
+gfu_recorder_finalize (GObject *object)
+{
+	GfuRecorder *self = GFU_RECORDER (object);
+
+	if (self->stream != NULL)
+		g_object_unref (self->stream);
+	if (self->connection != NULL)
+		g_object_unref (self->connection);
+	if (self->context != NULL)
+		g_main_context_unref (self->context);
+	g_free (self->name_owner);
+	g_hash_table_unref (self->serials);
+	g_mutex_clear (&self->mutex);
+
+	G_OBJECT_CLASS (gfu_recorder_parent_class)->finalize (object);
+}
+
+static void
+gfu_recorder_class_init (GfuRecorderClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gfu_recorder_finalize;
+
+	signals[SIGNAL_MESSAGE_DISPATCHED] =
+		g_signal_new ("message-dispatched",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_generic,
+			      G_TYPE_NONE, 3, G_TYPE_DBUS_MESSAGE, G_TYPE_STRING,
+			      G_TYPE_UINT64);
+}
+
+static void
+gfu_recorder_init (GfuRecorder *self)
+{
+	g_mutex_init (&self->mutex);
+	self->serials = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+}
+
+GfuRecorder *
+gfu_recorder_new (void)
+{
+	GfuRecorder *self;
+	self = g_object_new (GFU_TYPE_RECORDER, NULL);
+	return GFU_RECORDER (self);
+}
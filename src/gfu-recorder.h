@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GFU_TYPE_RECORDER (gfu_recorder_get_type ())
+
+G_DECLARE_FINAL_TYPE (GfuRecorder, gfu_recorder, GFU, RECORDER, GObject)
+
+typedef struct {
+	guint64		 timestamp;	/* µs since the recording started */
+	GDBusMessage	*message;
+} GfuRecorderEvent;
+
+GfuRecorder	*gfu_recorder_new			(void);
+gboolean	 gfu_recorder_set_filename		(GfuRecorder	*self,
+							 const gchar	*filename,
+							 GError		**error);
+void		 gfu_recorder_set_measure		(GfuRecorder	*self,
+							 gboolean	 measure);
+void		 gfu_recorder_set_name_owner		(GfuRecorder	*self,
+							 const gchar	*name_owner);
+void		 gfu_recorder_attach			(GfuRecorder	*self,
+							 GDBusConnection *connection,
+							 const gchar	*name_owner);
+gboolean	 gfu_recorder_close			(GfuRecorder	*self,
+							 GError		**error);
+GPtrArray	*gfu_recorder_load			(const gchar	*filename,
+							 GError		**error);
+
+G_END_DECLS
@@ -6,6 +6,7 @@
 
 #include "config.h"
 
+#include "gfu-common.h"
 #include "gfu-release-row.h"
 
 typedef struct {
@@ -14,6 +15,8 @@ typedef struct {
 	GtkWidget	*name;
 	GtkWidget	*version;
 	guint		 pending_refresh_id;
+	gchar		*name_shown;		/* see gfu_common_shown_update() */
+	gchar		*version_shown;
 } GfuReleaseRowPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GfuReleaseRow, gfu_release_row, GTK_TYPE_LIST_BOX_ROW)
@@ -21,17 +24,16 @@ G_DEFINE_TYPE_WITH_PRIVATE (GfuReleaseRow, gfu_release_row, GTK_TYPE_LIST_BOX_RO
 static void
 gfu_release_row_refresh (GfuReleaseRow *self)
 {
-	const gchar *tmp;
-
 	GfuReleaseRowPrivate *priv = gfu_release_row_get_instance_private (self);
 	if (priv->release == NULL)
 		return;
 
-	tmp = fwupd_release_get_name (priv->release);
-	gtk_label_set_label (GTK_LABEL (priv->name), tmp);
-	tmp = fwupd_release_get_version (priv->release);
-	gtk_label_set_label (GTK_LABEL (priv->version), tmp);
-	gtk_widget_set_visible (priv->version, TRUE);
+	if (gfu_common_shown_update (&priv->name_shown, fwupd_release_get_name (priv->release)))
+		gtk_label_set_label (GTK_LABEL (priv->name), priv->name_shown);
+	if (gfu_common_shown_update (&priv->version_shown, fwupd_release_get_version (priv->release))) {
+		gtk_label_set_label (GTK_LABEL (priv->version), priv->version_shown);
+		gtk_widget_set_visible (priv->version, TRUE);
+	}
 
 	/* TODO: set icon, e.g. security-high */
 }
@@ -60,19 +62,29 @@ gfu_release_row_notify_props_changed_cb (FwupdRelease *release,
 				        GfuReleaseRow *self)
 {
 	GfuReleaseRowPrivate *priv = gfu_release_row_get_instance_private (self);
+
+	/* many properties change at once, so only refresh when idle */
 	if (priv->pending_refresh_id > 0)
 		return;
 	priv->pending_refresh_id = g_idle_add (gfu_release_row_refresh_idle_cb, self);
 }
 
-static void
+void
 gfu_release_row_set_release (GfuReleaseRow *self, FwupdRelease *release)
 {
 	GfuReleaseRowPrivate *priv = gfu_release_row_get_instance_private (self);
 
-	priv->release = g_object_ref (release);
+	g_return_if_fail (GFU_IS_RELEASE_ROW (self));
+	g_return_if_fail (FWUPD_IS_RELEASE (release));
+
+	/* rows are reused when the same device is shown again */
+	if (priv->release == release)
+		return;
+	if (priv->release != NULL)
+		g_signal_handlers_disconnect_by_func (priv->release, gfu_release_row_notify_props_changed_cb, self);
+	g_set_object (&priv->release, release);
 
-	g_signal_connect_object (priv->release, "notify::state",
+	g_signal_connect_object (priv->release, "notify",
 				 G_CALLBACK (gfu_release_row_notify_props_changed_cb),
 				 self, 0);
 	gfu_release_row_refresh (self);
@@ -88,6 +100,8 @@ gfu_release_row_destroy (GtkWidget *object)
 		g_signal_handlers_disconnect_by_func (priv->release, gfu_release_row_notify_props_changed_cb, self);
 
 	g_clear_object (&priv->release);
+	g_clear_pointer (&priv->name_shown, g_free);
+	g_clear_pointer (&priv->version_shown, g_free);
 	if (priv->pending_refresh_id != 0) {
 		g_source_remove (priv->pending_refresh_id);
 		priv->pending_refresh_id = 0;
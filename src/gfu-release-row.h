@@ -22,5 +22,7 @@ struct _GfuReleaseRowClass
 
 GtkWidget	*gfu_release_row_new			(FwupdRelease	*release);
 FwupdRelease	*gfu_release_row_get_release		(GfuReleaseRow	*self);
+void		 gfu_release_row_set_release		(GfuReleaseRow	*self,
+							 FwupdRelease	*release);
 
 G_END_DECLS
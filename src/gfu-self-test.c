@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <locale.h>
+
+#include "gfu-common.h"
+#include "gfu-device-store.h"
+
+static void
+gfu_common_flag_bit_func (void)
+{
+	for (guint j = 0; j < 64; j++) {
+		guint64 flag = (guint64) 1 << j;
+		g_assert_cmpuint (GFU_FLAG_BIT (flag), ==, j);
+		/* only the lowest bit counts */
+		g_assert_cmpuint (GFU_FLAG_BIT (flag | G_GUINT64_CONSTANT (0x8000000000000000)), ==, j);
+	}
+}
+
+/* flags the library knows the name of, but that the table does not cover */
+static guint
+gfu_common_flag_table_missing (const gchar *(*to_string) (guint64),
+			       const GfuFlagInfo *(*get_info) (guint))
+{
+	guint missing = 0;
+	for (guint j = 0; j < 64; j++) {
+		const gchar *tmp = to_string ((guint64) 1 << j);
+		if (tmp == NULL || g_strcmp0 (tmp, "unknown") == 0)
+			continue;
+		if (get_info (j) != NULL)
+			continue;
+		g_test_message ("no table entry for %s, bit %u", tmp, j);
+		missing++;
+	}
+	return missing;
+}
+
+static void
+gfu_common_device_flag_table_func (void)
+{
+	g_assert_cmpuint (gfu_common_flag_table_missing (fwupd_device_flag_to_string,
+							 gfu_common_device_flag_get_info), ==, 0);
+}
+
+static void
+gfu_common_release_flag_table_func (void)
+{
+	g_assert_cmpuint (gfu_common_flag_table_missing (fwupd_release_flag_to_string,
+							 gfu_common_release_flag_get_info), ==, 0);
+}
+
+static void
+gfu_common_xml_to_markup_func (void)
+{
+	g_autofree gchar *markup = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* the outer list carries on counting after the nested one */
+	markup = gfu_common_xml_to_markup ("<p>Changes:</p>"
+					   "<ol><li>One<ul><li>a</li><li>b</li></ul></li>"
+					   "<li>Two</li></ol>", &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (markup, ==, "Changes:\n\n"
+				     " 1. One\n"
+				     "    • a\n"
+				     "    • b\n"
+				     " 2. Two");
+}
+
+static FwupdDevice *
+gfu_device_store_test_device_new (const gchar *id, const gchar *version)
+{
+	FwupdDevice *device = fwupd_device_new ();
+	fwupd_device_set_id (device, id);
+	fwupd_device_set_name (device, "ColorHug2");
+	fwupd_device_set_version (device, version);
+	fwupd_device_add_guid (device, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	fwupd_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	return device;
+}
+
+static void
+gfu_device_store_changed_cb (GfuDeviceStore *store, FwupdDevice *device, guint *cnt)
+{
+	(*cnt)++;
+}
+
+static void
+gfu_device_store_update_func (void)
+{
+	FwupdDevice *device;
+	guint cnt = 0;
+	g_autoptr(FwupdDevice) device1 = NULL;
+	g_autoptr(FwupdDevice) device2 = NULL;
+	g_autoptr(GfuDeviceStore) store = gfu_device_store_new ();
+	g_autoptr(GPtrArray) devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GPtrArray) group = NULL;
+	g_autoptr(GPtrArray) group2 = NULL;
+	g_autoptr(GPtrArray) group3 = NULL;
+
+	g_signal_connect (store, "device-changed",
+			  G_CALLBACK (gfu_device_store_changed_cb), &cnt);
+	g_ptr_array_add (devices, gfu_device_store_test_device_new ("aaa", "1.2.3"));
+	g_ptr_array_add (devices, gfu_device_store_test_device_new ("bbb", "1.2.3"));
+	gfu_device_store_set_devices (store, devices);
+	device = gfu_device_store_lookup (store, "aaa");
+	g_assert_nonnull (device);
+	group = gfu_device_store_get_group (store, device);
+	g_assert_cmpuint (group->len, ==, 2);
+
+	/* the same properties again */
+	device1 = gfu_device_store_test_device_new ("aaa", "1.2.3");
+	g_assert_true (gfu_device_store_update (store, device1) == device);
+	g_assert_cmpuint (cnt, ==, 0);
+	g_assert_true (gfu_device_store_get_groups_valid (store));
+
+	/* a different summary does not change the group array */
+	fwupd_device_set_summary (device1, "Colorimeter");
+	gfu_device_store_update (store, device1);
+	g_assert_cmpuint (cnt, ==, 1);
+	g_assert_true (gfu_device_store_get_groups_valid (store));
+
+	/* a new version splits the group */
+	device2 = gfu_device_store_test_device_new ("bbb", "1.2.4");
+	gfu_device_store_update (store, device2);
+	g_assert_cmpuint (cnt, ==, 2);
+	g_assert_false (gfu_device_store_get_groups_valid (store));
+	group2 = gfu_device_store_get_group (store, device);
+	g_assert_cmpuint (group2->len, ==, 1);
+
+	/* the group of the device that did not change is kept */
+	fwupd_device_set_version (device2, "1.2.5");
+	gfu_device_store_update (store, device2);
+	g_assert_cmpuint (cnt, ==, 3);
+	g_assert_false (gfu_device_store_get_groups_valid (store));
+	group3 = gfu_device_store_get_group (store, device);
+	g_assert_true (group3 == group2);
+}
+
+static void
+gfu_device_store_items_changed_cb (GListModel *model,
+				   guint position,
+				   guint removed,
+				   guint added,
+				   guint *cnt)
+{
+	(*cnt)++;
+}
+
+static void
+gfu_device_store_set_devices_func (void)
+{
+	const gchar *ids[] = { "aaa", "bbb", "ccc", "ddd", "eee", NULL };
+	guint cnt = 0;
+	g_autoptr(GfuDeviceStore) store = gfu_device_store_new ();
+	g_autoptr(GPtrArray) devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GPtrArray) devices2 = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	for (guint i = 0; ids[i] != NULL; i++)
+		g_ptr_array_add (devices, gfu_device_store_test_device_new (ids[i], "1.2.3"));
+	gfu_device_store_set_devices (store, devices);
+	g_assert_cmpuint (g_list_model_get_n_items (gfu_device_store_get_model (store)), ==, 5);
+
+	/* two runs of vanished devices, and nothing added */
+	g_signal_connect (gfu_device_store_get_model (store), "items-changed",
+			  G_CALLBACK (gfu_device_store_items_changed_cb), &cnt);
+	g_ptr_array_add (devices2, g_object_ref (g_ptr_array_index (devices, 2)));
+	g_ptr_array_add (devices2, g_object_ref (g_ptr_array_index (devices, 3)));
+	gfu_device_store_set_devices (store, devices2);
+	g_assert_cmpuint (cnt, ==, 2);
+	g_assert_cmpuint (g_list_model_get_n_items (gfu_device_store_get_model (store)), ==, 2);
+	g_assert_nonnull (gfu_device_store_lookup (store, "ccc"));
+	g_assert_null (gfu_device_store_lookup (store, "aaa"));
+}
+
+int
+main (int argc, char **argv)
+{
+	setlocale (LC_ALL, "");
+	g_test_init (&argc, &argv, NULL);
+
+	/* only critical and error are fatal */
+	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
+	g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
+
+	g_test_add_func ("/gfu/common/flag-bit", gfu_common_flag_bit_func);
+	g_test_add_func ("/gfu/common/device-flag-table", gfu_common_device_flag_table_func);
+	g_test_add_func ("/gfu/common/release-flag-table", gfu_common_release_flag_table_func);
+	g_test_add_func ("/gfu/common/xml-to-markup", gfu_common_xml_to_markup_func);
+	g_test_add_func ("/gfu/device-store/update", gfu_device_store_update_func);
+	g_test_add_func ("/gfu/device-store/set-devices", gfu_device_store_set_devices_func);
+	return g_test_run ();
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <fwupd.h>
+
+#include "gfu-common.h"
+#include "gfu-stats.h"
+
+/*
+ * Everything here is updated from the hot paths without taking a lock, so
+ * the values are pointer-sized to be used with g_atomic_pointer_add().
+ * A report may be a sample or two behind, which is fine for a human.
+ */
+
+static gsize gfu_stats_counters[GFU_STATS_COUNTER_LAST];
+static gsize gfu_stats_buckets[GFU_STATS_HISTOGRAM_LAST][GFU_STATS_BUCKETS];
+static gsize gfu_stats_sums[GFU_STATS_HISTOGRAM_LAST];
+
+static const struct {
+	const gchar		*name;
+	const gchar		*unit;
+} gfu_stats_histograms[] = {
+	{ "GetDevices",		"ms" },
+	{ "GetReleases",	"ms" },
+	{ "GetRemotes",		"ms" },
+	{ "Install",		"ms" },
+	{ "Verify",		"ms" },
+	{ "VerifyUpdate",	"ms" },
+	{ "Time to first byte",	"ms" },
+	{ "Throughput",		"KiB/s" },
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (gfu_stats_histograms) == GFU_STATS_HISTOGRAM_LAST);
+
+/* method calls that are timed from being sent to the reply arriving */
+static const struct {
+	const gchar		*member;
+	GfuStatsHistogram	 histogram;
+} gfu_stats_methods[] = {
+	{ "GetDevices",		GFU_STATS_HISTOGRAM_GET_DEVICES },
+	{ "GetReleases",	GFU_STATS_HISTOGRAM_GET_RELEASES },
+	{ "GetRemotes",		GFU_STATS_HISTOGRAM_GET_REMOTES },
+	{ "Install",		GFU_STATS_HISTOGRAM_INSTALL },
+	{ "Verify",		GFU_STATS_HISTOGRAM_VERIFY },
+	{ "VerifyUpdate",	GFU_STATS_HISTOGRAM_VERIFY_UPDATE },
+};
+
+typedef struct {
+	GfuStatsHistogram	 histogram;
+	gint64			 sent;
+} GfuStatsCall;
+
+/* serial : GfuStatsCall, only ever used by the GDBus worker thread */
+static GHashTable *gfu_stats_calls = NULL;
+
+static gsize
+gfu_stats_get (gsize *atomic)
+{
+	return GPOINTER_TO_SIZE (g_atomic_pointer_get (atomic));
+}
+
+void
+gfu_stats_add (GfuStatsCounter counter, gsize value)
+{
+	g_return_if_fail (counter < GFU_STATS_COUNTER_LAST);
+	g_atomic_pointer_add (&gfu_stats_counters[counter], value);
+}
+
+void
+gfu_stats_add_sample (GfuStatsHistogram histogram, gsize value)
+{
+	guint idx = 0;
+
+	g_return_if_fail (histogram < GFU_STATS_HISTOGRAM_LAST);
+
+	if (value > 0)
+		idx = MIN (g_bit_storage (value), GFU_STATS_BUCKETS - 1);
+	g_atomic_pointer_add (&gfu_stats_buckets[histogram][idx], 1);
+	g_atomic_pointer_add (&gfu_stats_sums[histogram], value);
+}
+
+/* outgoing calls and their replies are both seen by the worker thread */
+static GDBusMessage *
+gfu_stats_filter_cb (GDBusConnection *connection,
+		     GDBusMessage *message,
+		     gboolean incoming,
+		     gpointer user_data)
+{
+	GfuStatsCall *call;
+	guint32 serial;
+
+	if (!incoming) {
+		const gchar *member;
+		if (g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL)
+			return message;
+		if (g_strcmp0 (g_dbus_message_get_interface (message), FWUPD_DBUS_INTERFACE) != 0)
+			return message;
+		member = g_dbus_message_get_member (message);
+		for (guint i = 0; i < G_N_ELEMENTS (gfu_stats_methods); i++) {
+			if (g_strcmp0 (member, gfu_stats_methods[i].member) != 0)
+				continue;
+			call = g_new0 (GfuStatsCall, 1);
+			call->histogram = gfu_stats_methods[i].histogram;
+			call->sent = g_get_monotonic_time ();
+			serial = g_dbus_message_get_serial (message);
+			g_hash_table_insert (gfu_stats_calls, GUINT_TO_POINTER (serial), call);
+			break;
+		}
+		return message;
+	}
+
+	/* errors are included, as a slow failure is just as interesting */
+	serial = g_dbus_message_get_reply_serial (message);
+	if (serial == 0)
+		return message;
+	call = g_hash_table_lookup (gfu_stats_calls, GUINT_TO_POINTER (serial));
+	if (call == NULL)
+		return message;
+	gfu_stats_add_sample (call->histogram,
+			      (g_get_monotonic_time () - call->sent) / 1000);
+	g_hash_table_remove (gfu_stats_calls, GUINT_TO_POINTER (serial));
+	return message;
+}
+
+/* this is the round trip to the daemon, not including the main loop dispatch */
+void
+gfu_stats_watch_connection (GDBusConnection *connection)
+{
+	static gsize watched = 0;
+
+	g_return_if_fail (G_IS_DBUS_CONNECTION (connection));
+
+	if (g_once_init_enter (&watched)) {
+		gfu_stats_calls = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							 NULL, g_free);
+		g_dbus_connection_add_filter (connection, gfu_stats_filter_cb, NULL, NULL);
+		g_once_init_leave (&watched, 1);
+	}
+}
+
+/* the upper limit of the bucket, so "<8ms" */
+static void
+gfu_stats_bucket_append (GString *str, guint idx, const gchar *unit)
+{
+	if (idx == GFU_STATS_BUCKETS - 1) {
+		g_string_append_printf (str, ">=%" G_GSIZE_FORMAT "%s",
+					(gsize) 1 << (idx - 1), unit);
+		return;
+	}
+	g_string_append_printf (str, "<%" G_GSIZE_FORMAT "%s", (gsize) 1 << idx, unit);
+}
+
+static guint
+gfu_stats_percentile (const gsize *buckets, gsize count, guint pct)
+{
+	gsize needed = (count * pct + 99) / 100;
+	gsize seen = 0;
+
+	for (guint i = 0; i < GFU_STATS_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= needed)
+			return i;
+	}
+	return GFU_STATS_BUCKETS - 1;
+}
+
+static void
+gfu_stats_histogram_append (GString *str, GfuStatsHistogram histogram)
+{
+	const gchar *unit = gfu_stats_histograms[histogram].unit;
+	gsize buckets[GFU_STATS_BUCKETS];
+	gsize count = 0;
+	gsize highest = 0;
+	guint first = GFU_STATS_BUCKETS;
+	guint last = 0;
+
+	/* take a copy, so the bars agree with the totals */
+	for (guint i = 0; i < GFU_STATS_BUCKETS; i++) {
+		buckets[i] = gfu_stats_get (&gfu_stats_buckets[histogram][i]);
+		if (buckets[i] == 0)
+			continue;
+		count += buckets[i];
+		highest = MAX (highest, buckets[i]);
+		first = MIN (first, i);
+		last = i;
+	}
+	g_string_append_printf (str, "%s: ", gfu_stats_histograms[histogram].name);
+	if (count == 0) {
+		g_string_append (str, "no samples\n\n");
+		return;
+	}
+	g_string_append_printf (str, "%" G_GSIZE_FORMAT " samples, mean %" G_GSIZE_FORMAT "%s, p50 ",
+				count, gfu_stats_get (&gfu_stats_sums[histogram]) / count, unit);
+	gfu_stats_bucket_append (str, gfu_stats_percentile (buckets, count, 50), unit);
+	g_string_append (str, ", p99 ");
+	gfu_stats_bucket_append (str, gfu_stats_percentile (buckets, count, 99), unit);
+	g_string_append_c (str, '\n');
+
+	/* only the range that has samples, with the longest bar 30 wide */
+	for (guint i = first; i <= last; i++) {
+		gsize width = (buckets[i] * 30 + highest - 1) / highest;
+		gsize start = str->len;
+		g_string_append (str, "  ");
+		gfu_stats_bucket_append (str, i, unit);
+		while (str->len - start < 16)
+			g_string_append_c (str, ' ');
+		for (gsize j = 0; j < width; j++)
+			g_string_append_c (str, '#');
+		g_string_append_printf (str, " %" G_GSIZE_FORMAT "\n", buckets[i]);
+	}
+	g_string_append_c (str, '\n');
+}
+
+static void
+gfu_stats_ratio_append (GString *str, const gchar *title,
+			GfuStatsCounter counter_hits, GfuStatsCounter counter_misses)
+{
+	gsize hits = gfu_stats_get (&gfu_stats_counters[counter_hits]);
+	gsize misses = gfu_stats_get (&gfu_stats_counters[counter_misses]);
+
+	g_string_append_printf (str, "%s: %" G_GSIZE_FORMAT " hits, %" G_GSIZE_FORMAT " misses",
+				title, hits, misses);
+	if (hits + misses > 0)
+		g_string_append_printf (str, " (%.0f%% hit rate)", 100.f * hits / (hits + misses));
+	g_string_append_c (str, '\n');
+}
+
+/* plain text, so it can be copied into a bug report */
+gchar *
+gfu_stats_to_string (void)
+{
+	gchar buf[32];
+	GString *str = g_string_new (NULL);
+
+	for (guint i = 0; i < GFU_STATS_HISTOGRAM_LAST; i++)
+		gfu_stats_histogram_append (str, i);
+
+	gfu_stats_ratio_append (str, "Download cache",
+				GFU_STATS_COUNTER_CACHE_HITS,
+				GFU_STATS_COUNTER_CACHE_MISSES);
+	g_string_append_printf (str, "Bytes saved: %s\n",
+				gfu_common_format_size (gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_BYTES_SAVED]),
+							buf, sizeof(buf)));
+	g_string_append_printf (str, "Bytes downloaded: %s\n",
+				gfu_common_format_size (gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_BYTES_DOWNLOADED]),
+							buf, sizeof(buf)));
+	gfu_stats_ratio_append (str, "Release cache",
+				GFU_STATS_COUNTER_RELEASE_CACHE_HITS,
+				GFU_STATS_COUNTER_RELEASE_CACHE_MISSES);
+	g_string_append_printf (str, "Signals: %" G_GSIZE_FORMAT " received, %" G_GSIZE_FORMAT " coalesced\n",
+				gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_SIGNALS]),
+				gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_SIGNALS_COALESCED]));
+	g_string_append_printf (str, "Objects: %" G_GSIZE_FORMAT " devices and %" G_GSIZE_FORMAT " releases decoded\n",
+				gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_DEVICES_DECODED]),
+				gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_RELEASES_DECODED]));
+	g_string_append_printf (str, "Rows: %" G_GSIZE_FORMAT " created, %" G_GSIZE_FORMAT " reused\n",
+				gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_ROWS_CREATED]),
+				gfu_stats_get (&gfu_stats_counters[GFU_STATS_COUNTER_ROWS_REUSED]));
+	return g_string_free (str, FALSE);
+}
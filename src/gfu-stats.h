@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	GFU_STATS_HISTOGRAM_GET_DEVICES,	/* ms */
+	GFU_STATS_HISTOGRAM_GET_RELEASES,	/* ms */
+	GFU_STATS_HISTOGRAM_GET_REMOTES,	/* ms */
+	GFU_STATS_HISTOGRAM_INSTALL,		/* ms */
+	GFU_STATS_HISTOGRAM_VERIFY,		/* ms */
+	GFU_STATS_HISTOGRAM_VERIFY_UPDATE,	/* ms */
+	GFU_STATS_HISTOGRAM_FIRST_BYTE,		/* ms */
+	GFU_STATS_HISTOGRAM_THROUGHPUT,		/* KiB/s */
+	GFU_STATS_HISTOGRAM_LAST
+} GfuStatsHistogram;
+
+typedef enum {
+	GFU_STATS_COUNTER_CACHE_HITS,
+	GFU_STATS_COUNTER_CACHE_MISSES,
+	GFU_STATS_COUNTER_BYTES_SAVED,
+	GFU_STATS_COUNTER_BYTES_DOWNLOADED,
+	GFU_STATS_COUNTER_RELEASE_CACHE_HITS,
+	GFU_STATS_COUNTER_RELEASE_CACHE_MISSES,
+	GFU_STATS_COUNTER_SIGNALS,
+	GFU_STATS_COUNTER_SIGNALS_COALESCED,
+	GFU_STATS_COUNTER_DEVICES_DECODED,
+	GFU_STATS_COUNTER_RELEASES_DECODED,
+	GFU_STATS_COUNTER_ROWS_CREATED,
+	GFU_STATS_COUNTER_ROWS_REUSED,
+	GFU_STATS_COUNTER_LAST
+} GfuStatsCounter;
+
+/* bucket 0 is everything under 1, then each one is twice the last */
+#define GFU_STATS_BUCKETS		20
+
+void		 gfu_stats_add				(GfuStatsCounter counter,
+							 gsize		 value);
+void		 gfu_stats_add_sample			(GfuStatsHistogram histogram,
+							 gsize		 value);
+void		 gfu_stats_watch_connection		(GDBusConnection *connection);
+gchar		*gfu_stats_to_string			(void);
+
+#define gfu_stats_inc(counter)	gfu_stats_add (counter, 1)
+
+G_END_DECLS
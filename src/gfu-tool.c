@@ -0,0 +1,535 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <json-glib/json-glib.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <fwupd.h>
+
+#include "gfu-common.h"
+#include "gfu-device-store.h"
+#include "gfu-engine.h"
+#include "gfu-trace.h"
+
+/* the same as fwupdmgr, so scripts can treat both alike */
+#define GFU_TOOL_EXIT_NOTHING_TO_DO	2
+
+typedef struct {
+	GfuEngine		*engine;
+	FwupdClient		*client;		/* owned by the engine */
+	GCancellable		*cancellable;
+	JsonBuilder		*builder;		/* NULL unless --json */
+	FwupdInstallFlags	 flags;
+} GfuTool;
+
+typedef gboolean (*GfuToolCmdFunc)	(GfuTool	*self,
+					 gchar		**values,
+					 GError		**error);
+
+typedef struct {
+	const gchar		*name;
+	const gchar		*arguments;
+	const gchar		*description;
+	GfuToolCmdFunc		 func;
+} GfuToolCmd;
+
+static void
+gfu_tool_free (GfuTool *self)
+{
+	if (self->engine != NULL)
+		g_object_unref (self->engine);
+	if (self->cancellable != NULL)
+		g_object_unref (self->cancellable);
+	if (self->builder != NULL)
+		g_object_unref (self->builder);
+	g_free (self);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuTool, gfu_tool_free)
+
+static void
+gfu_tool_status_changed_cb (GfuEngine *engine, const gchar *text, GfuTool *self)
+{
+	/* progress never goes to stdout so the output can be parsed */
+	if (self->builder == NULL)
+		g_printerr ("%s\n", text);
+}
+
+/* output helpers */
+
+static void
+gfu_tool_add_string (GfuTool *self, const gchar *key, const gchar *value)
+{
+	if (value == NULL)
+		return;
+	json_builder_set_member_name (self->builder, key);
+	json_builder_add_string_value (self->builder, value);
+}
+
+static void
+gfu_tool_add_device (GfuTool *self, FwupdDevice *device)
+{
+	GPtrArray *guids = fwupd_device_get_guids (device);
+	guint64 flags = fwupd_device_get_flags (device);
+
+	json_builder_begin_object (self->builder);
+	gfu_tool_add_string (self, "DeviceId", fwupd_device_get_id (device));
+	gfu_tool_add_string (self, "ParentDeviceId", fwupd_device_get_parent_id (device));
+	gfu_tool_add_string (self, "Name", fwupd_device_get_name (device));
+	gfu_tool_add_string (self, "Vendor", fwupd_device_get_vendor (device));
+	gfu_tool_add_string (self, "Version", fwupd_device_get_version (device));
+	gfu_tool_add_string (self, "Serial", fwupd_device_get_serial (device));
+	json_builder_set_member_name (self->builder, "Guids");
+	json_builder_begin_array (self->builder);
+	for (guint i = 0; i < guids->len; i++)
+		json_builder_add_string_value (self->builder, g_ptr_array_index (guids, i));
+	json_builder_end_array (self->builder);
+	json_builder_set_member_name (self->builder, "Flags");
+	json_builder_begin_array (self->builder);
+	for (guint64 tmp = flags; tmp != 0; tmp &= tmp - 1) {
+		guint64 flag = tmp & -tmp;
+		json_builder_add_string_value (self->builder, fwupd_device_flag_to_string (flag));
+	}
+	json_builder_end_array (self->builder);
+	json_builder_end_object (self->builder);
+}
+
+static void
+gfu_tool_add_result (GfuTool *self,
+		     FwupdDevice *device,
+		     FwupdRelease *release,
+		     const GError *error)
+{
+	const gchar *version = release != NULL ? fwupd_release_get_version (release) : NULL;
+
+	if (self->builder == NULL) {
+		g_print ("%s\t%s\t%s\n",
+			 fwupd_device_get_id (device),
+			 version != NULL ? version : "-",
+			 error != NULL ? error->message : "ok");
+		return;
+	}
+	json_builder_begin_object (self->builder);
+	gfu_tool_add_string (self, "DeviceId", fwupd_device_get_id (device));
+	gfu_tool_add_string (self, "Version", version);
+	if (error != NULL)
+		gfu_tool_add_string (self, "Error", error->message);
+	json_builder_end_object (self->builder);
+}
+
+static FwupdDevice *
+gfu_tool_get_device (GfuTool *self, const gchar *device_id, GError **error)
+{
+	return fwupd_client_get_device_by_id (self->client, device_id,
+					      self->cancellable, error);
+}
+
+/* picks the newest upgrade, or the release with the version asked for */
+static FwupdRelease *
+gfu_tool_get_release (GfuTool *self,
+		      FwupdDevice *device,
+		      const gchar *version,
+		      GError **error)
+{
+	g_autoptr(GPtrArray) releases = NULL;
+
+	if (version == NULL) {
+		releases = fwupd_client_get_upgrades (self->client,
+						      fwupd_device_get_id (device),
+						      self->cancellable,
+						      error);
+		if (releases == NULL)
+			return NULL;
+		return g_object_ref (g_ptr_array_index (releases, 0));
+	}
+	releases = fwupd_client_get_releases (self->client,
+					      fwupd_device_get_id (device),
+					      self->cancellable,
+					      error);
+	if (releases == NULL)
+		return NULL;
+	for (guint i = 0; i < releases->len; i++) {
+		FwupdRelease *release = g_ptr_array_index (releases, i);
+		if (g_strcmp0 (fwupd_release_get_version (release), version) == 0)
+			return g_object_ref (release);
+	}
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_NOT_FOUND,
+		     "no release %s for %s",
+		     version, fwupd_device_get_id (device));
+	return NULL;
+}
+
+static gboolean
+gfu_tool_install_release (GfuTool *self,
+			  FwupdDevice *device,
+			  FwupdRelease *release,
+			  GError **error)
+{
+	FwupdInstallFlags flags = self->flags;
+	g_autofree gchar *fn = NULL;
+
+	if (fwupd_release_has_flag (release, FWUPD_RELEASE_FLAG_IS_DOWNGRADE))
+		flags |= FWUPD_INSTALL_FLAG_ALLOW_OLDER;
+	if (g_strcmp0 (fwupd_release_get_version (release),
+		       fwupd_device_get_version (device)) == 0)
+		flags |= FWUPD_INSTALL_FLAG_ALLOW_REINSTALL;
+	fn = gfu_engine_fetch_release (self->engine, release, error);
+	if (fn == NULL)
+		return FALSE;
+	return gfu_engine_install (self->engine, device, fn, flags, error);
+}
+
+/* subcommands */
+
+static gboolean
+gfu_tool_get_devices (GfuTool *self, gchar **values, GError **error)
+{
+	g_autoptr(GPtrArray) devices = NULL;
+
+	devices = fwupd_client_get_devices (self->client, self->cancellable, error);
+	if (devices == NULL)
+		return FALSE;
+	if (self->builder == NULL) {
+		for (guint i = 0; i < devices->len; i++) {
+			FwupdDevice *device = g_ptr_array_index (devices, i);
+			const gchar *version = fwupd_device_get_version (device);
+			g_print ("%s\t%s\t%s\t%s\n",
+				 fwupd_device_get_id (device),
+				 version != NULL ? version : "-",
+				 fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE) ?
+					"updatable" : "-",
+				 fwupd_device_get_name (device));
+		}
+		return TRUE;
+	}
+	json_builder_set_member_name (self->builder, "Devices");
+	json_builder_begin_array (self->builder);
+	for (guint i = 0; i < devices->len; i++)
+		gfu_tool_add_device (self, g_ptr_array_index (devices, i));
+	json_builder_end_array (self->builder);
+	return TRUE;
+}
+
+static gboolean
+gfu_tool_refresh (GfuTool *self, gchar **values, GError **error)
+{
+	return gfu_engine_refresh_metadata (self->engine, 0, error);
+}
+
+static gboolean
+gfu_tool_download (GfuTool *self, gchar **values, GError **error)
+{
+	g_autofree gchar *fn = NULL;
+	g_autoptr(FwupdDevice) device = NULL;
+	g_autoptr(FwupdRelease) release = NULL;
+
+	device = gfu_tool_get_device (self, values[0], error);
+	if (device == NULL)
+		return FALSE;
+	release = gfu_tool_get_release (self, device, values[1], error);
+	if (release == NULL)
+		return FALSE;
+	fn = gfu_engine_fetch_release (self->engine, release, error);
+	if (fn == NULL)
+		return FALSE;
+	if (self->builder == NULL) {
+		g_print ("%s\n", fn);
+		return TRUE;
+	}
+	gfu_tool_add_string (self, "Filename", fn);
+	gfu_tool_add_string (self, "Version", fwupd_release_get_version (release));
+	return TRUE;
+}
+
+static gboolean
+gfu_tool_install (GfuTool *self, gchar **values, GError **error)
+{
+	g_autoptr(FwupdDevice) device = NULL;
+	g_autoptr(FwupdDevice) device_new = NULL;
+	g_autoptr(FwupdRelease) release = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	device = gfu_tool_get_device (self, values[0], error);
+	if (device == NULL)
+		return FALSE;
+	release = gfu_tool_get_release (self, device, values[1], error);
+	if (release == NULL)
+		return FALSE;
+	if (!gfu_tool_install_release (self, device, release, error))
+		return FALSE;
+	if (self->builder == NULL)
+		return TRUE;
+
+	/* the daemon only sets needs-reboot once the update is staged */
+	device_new = gfu_tool_get_device (self, values[0], &error_local);
+	if (device_new == NULL) {
+		g_debug ("using the device from before the install: %s", error_local->message);
+		device_new = g_object_ref (device);
+	}
+	gfu_tool_add_string (self, "DeviceId", fwupd_device_get_id (device_new));
+	gfu_tool_add_string (self, "Version", fwupd_release_get_version (release));
+	json_builder_set_member_name (self->builder, "NeedsReboot");
+	json_builder_add_boolean_value (self->builder,
+					fwupd_device_has_flag (device_new, FWUPD_DEVICE_FLAG_NEEDS_REBOOT));
+	return TRUE;
+}
+
+static gboolean
+gfu_tool_update_all (GfuTool *self, gchar **values, GError **error)
+{
+	guint failed = 0;
+	g_autoptr(GfuDeviceStore) store = gfu_device_store_new ();
+	g_autoptr(GHashTable) releases = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							       NULL, g_object_unref);
+	g_autoptr(GHashTable) installed = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) order = NULL;
+	g_autoptr(GPtrArray) updatable = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	devices = fwupd_client_get_devices (self->client, self->cancellable, error);
+	if (devices == NULL)
+		return FALSE;
+	gfu_device_store_set_devices (store, devices);
+
+	/* the newest upgrade for each device */
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *device = gfu_device_store_lookup (store,
+							       fwupd_device_get_id (g_ptr_array_index (devices, i)));
+		g_autoptr(GError) error_local = NULL;
+		FwupdRelease *release;
+
+		if (device == NULL || !fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+			continue;
+		release = gfu_tool_get_release (self, device, NULL, &error_local);
+		if (release == NULL) {
+			if (!g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO))
+				g_debug ("ignoring %s: %s", fwupd_device_get_id (device), error_local->message);
+			continue;
+		}
+		g_hash_table_insert (releases, device, release);
+		g_ptr_array_add (updatable, g_object_ref (device));
+	}
+	if (updatable->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     /* TRANSLATORS: there are no upgrades for any device */
+				     _("All devices are up to date"));
+		return FALSE;
+	}
+
+	/* parents and children of composite devices go in the right order */
+	order = gfu_device_store_get_install_order (store, updatable);
+	if (self->builder != NULL) {
+		json_builder_set_member_name (self->builder, "Results");
+		json_builder_begin_array (self->builder);
+	}
+	for (guint i = 0; i < order->len; i++) {
+		FwupdDevice *device = g_ptr_array_index (order, i);
+		FwupdDevice *ancestor = gfu_device_store_get_ancestor (store, device, updatable);
+		FwupdRelease *release = g_hash_table_lookup (releases, device);
+		g_autoptr(GError) error_local = NULL;
+
+		/* the composite update of the parent may have done this already */
+		if (ancestor != NULL && g_hash_table_contains (installed, ancestor) &&
+		    g_strcmp0 (fwupd_device_get_version (device),
+			       fwupd_release_get_version (release)) == 0) {
+			g_debug ("%s already updated by parent", fwupd_device_get_id (device));
+			g_hash_table_add (installed, device);
+			gfu_tool_add_result (self, device, release, NULL);
+			continue;
+		}
+
+		/* the daemon flashes one device at a time, so keep going on failure */
+		if (!gfu_tool_install_release (self, device, release, &error_local)) {
+			failed++;
+			gfu_tool_add_result (self, device, release, error_local);
+			continue;
+		}
+		g_hash_table_add (installed, device);
+		gfu_tool_add_result (self, device, release, NULL);
+
+		/* pick up versions changed by a composite update */
+		g_clear_pointer (&devices, g_ptr_array_unref);
+		devices = fwupd_client_get_devices (self->client, self->cancellable, &error_local);
+		if (devices != NULL)
+			gfu_device_store_set_devices (store, devices);
+	}
+	if (self->builder != NULL)
+		json_builder_end_array (self->builder);
+	if (failed > 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "%u of %u devices failed to update",
+			     failed, order->len);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static const GfuToolCmd cmds[] = {
+	/* TRANSLATORS: command description */
+	{ "get-devices",	NULL,			N_("List all devices"),				gfu_tool_get_devices },
+	/* TRANSLATORS: command description */
+	{ "refresh",		NULL,			N_("Download new metadata from all remotes"),	gfu_tool_refresh },
+	/* TRANSLATORS: command description */
+	{ "download",		"DEVICE-ID [VERSION]",	N_("Download and verify the firmware"),		gfu_tool_download },
+	/* TRANSLATORS: command description */
+	{ "install",		"DEVICE-ID [VERSION]",	N_("Install the newest or a specific firmware"),	gfu_tool_install },
+	/* TRANSLATORS: command description */
+	{ "update-all",		NULL,			N_("Install all the available updates"),	gfu_tool_update_all },
+};
+
+static gchar *
+gfu_tool_get_description (void)
+{
+	GString *str = g_string_new (NULL);
+	for (guint i = 0; i < G_N_ELEMENTS (cmds); i++) {
+		g_autofree gchar *tmp = g_strdup_printf ("%s %s", cmds[i].name,
+							 cmds[i].arguments != NULL ? cmds[i].arguments : "");
+		g_string_append_printf (str, "  %-28s%s\n", tmp, _(cmds[i].description));
+	}
+	return g_string_free (str, FALSE);
+}
+
+static const GfuToolCmd *
+gfu_tool_get_cmd (const gchar *name)
+{
+	for (guint i = 0; i < G_N_ELEMENTS (cmds); i++) {
+		if (g_strcmp0 (cmds[i].name, name) == 0)
+			return &cmds[i];
+	}
+	return NULL;
+}
+
+static gint
+gfu_tool_exit_code (const GError *error)
+{
+	if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO))
+		return GFU_TOOL_EXIT_NOTHING_TO_DO;
+	return EXIT_FAILURE;
+}
+
+int
+main (int argc, char **argv)
+{
+	const GfuToolCmd *cmd;
+	gboolean as_json = FALSE;
+	gboolean ret;
+	gboolean verbose = FALSE;
+	GfuTraceSpan *span;
+	gchar *values[2] = { NULL, NULL };
+	g_autofree gchar *bus = NULL;
+	g_autofree gchar *description = NULL;
+	g_autofree gchar *trace = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_trace = NULL;
+	g_autoptr(GfuTool) self = g_new0 (GfuTool, 1);
+	g_autoptr(GOptionContext) context = NULL;
+	const GOptionEntry options[] = {
+		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+			/* TRANSLATORS: command line option */
+			_("Show extra debugging information"), NULL },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &as_json,
+			/* TRANSLATORS: command line option */
+			_("Output in JSON format"), NULL },
+		{ "bus", '\0', 0, G_OPTION_ARG_STRING, &bus,
+			/* TRANSLATORS: command line option */
+			_("Talk to fwupd on system, session or a bus address"), NULL },
+		{ "trace", '\0', 0, G_OPTION_ARG_FILENAME, &trace,
+			/* TRANSLATORS: command line option */
+			_("Write a trace that can be opened in a trace viewer"), _("FILENAME") },
+		{ NULL}
+	};
+
+	setlocale (LC_ALL, "");
+
+	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	/* TRANSLATORS: command description */
+	context = g_option_context_new (_("COMMAND"));
+	description = gfu_tool_get_description ();
+	g_option_context_set_description (context, description);
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		/* TRANSLATORS: the user has sausages for fingers */
+		g_printerr ("%s: %s\n", _("Failed to parse command line options"),
+			    error->message);
+		return EXIT_FAILURE;
+	}
+	if (verbose)
+		g_setenv ("G_MESSAGES_DEBUG", "all", FALSE);
+	if (!gfu_common_set_bus (bus, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	/* find the subcommand */
+	cmd = argc > 1 ? gfu_tool_get_cmd (argv[1]) : NULL;
+	if (cmd == NULL) {
+		g_autofree gchar *help = g_option_context_get_help (context, TRUE, NULL);
+		g_printerr ("%s", help);
+		return EXIT_FAILURE;
+	}
+	if (cmd->arguments != NULL && argc < 3) {
+		/* TRANSLATORS: a device ID is needed */
+		g_printerr ("%s: %s %s\n", _("Invalid arguments"), cmd->name, cmd->arguments);
+		return EXIT_FAILURE;
+	}
+	for (gint i = 2; i < argc && i < 4; i++)
+		values[i - 2] = argv[i];
+
+	self->cancellable = g_cancellable_new ();
+	self->engine = gfu_engine_new ();
+	self->client = gfu_engine_get_client (self->engine);
+	g_signal_connect (self->engine, "status-changed",
+			  G_CALLBACK (gfu_tool_status_changed_cb), self);
+	if (as_json) {
+		self->builder = json_builder_new ();
+		json_builder_begin_object (self->builder);
+	}
+
+	/* run, recording any error in the output as well */
+	if (trace != NULL && !gfu_trace_start (trace, &error_trace)) {
+		g_printerr ("Failed to start trace: %s\n", error_trace->message);
+		return EXIT_FAILURE;
+	}
+	span = gfu_trace_span_begin ("tool", cmd->name);
+	ret = cmd->func (self, values, &error);
+	gfu_trace_span_end (span);
+	if (!gfu_trace_stop (&error_trace))
+		g_printerr ("Failed to save trace: %s\n", error_trace->message);
+	if (!ret) {
+		g_printerr ("%s\n", error->message);
+		if (self->builder == NULL)
+			return gfu_tool_exit_code (error);
+		gfu_tool_add_string (self, "Error", error->message);
+		json_builder_set_member_name (self->builder, "ErrorCode");
+		json_builder_add_int_value (self->builder, error->code);
+	}
+
+	/* print everything at once */
+	if (self->builder != NULL) {
+		g_autoptr(JsonGenerator) generator = json_generator_new ();
+		g_autoptr(JsonNode) root = NULL;
+		g_autofree gchar *data = NULL;
+		json_builder_end_object (self->builder);
+		root = json_builder_get_root (self->builder);
+		json_generator_set_pretty (generator, TRUE);
+		json_generator_set_root (generator, root);
+		data = json_generator_to_data (generator, NULL);
+		g_print ("%s\n", data);
+	}
+	return error != NULL ? gfu_tool_exit_code (error) : EXIT_SUCCESS;
+}
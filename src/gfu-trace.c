@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <unistd.h>
+
+#include "gfu-trace.h"
+
+/*
+ * Events are written as they happen using the JSON array flavor of the
+ * Chrome trace event format, which allows the closing bracket to be missing
+ * if the process crashes. Spans are written as one complete ("X") event when
+ * they end, so nesting is implied by the timestamps on each thread.
+ */
+
+struct _GfuTraceSpan {
+	const gchar		*category;	/* static */
+	const gchar		*name;		/* static */
+	gint64			 start;
+	GString			*args;		/* NULL if none */
+};
+
+gboolean gfu_trace_enabled = FALSE;
+
+static GMutex gfu_trace_mutex;
+static GOutputStream *gfu_trace_stream = NULL;
+static gint64 gfu_trace_start_time = 0;
+static gboolean gfu_trace_first = TRUE;
+static gint gfu_trace_tid_next = 0;
+static GPrivate gfu_trace_tid_private;
+
+/* small numbers are easier to read in the viewer than thread pointers */
+static gint
+gfu_trace_get_tid (void)
+{
+	gint tid = GPOINTER_TO_INT (g_private_get (&gfu_trace_tid_private));
+	if (tid == 0) {
+		tid = g_atomic_int_add (&gfu_trace_tid_next, 1) + 1;
+		g_private_set (&gfu_trace_tid_private, GINT_TO_POINTER (tid));
+	}
+	return tid;
+}
+
+static void
+gfu_trace_append_escaped (GString *str, const gchar *value)
+{
+	g_string_append_c (str, '"');
+	for (const gchar *p = value; *p != '\0'; p++) {
+		if (*p == '"' || *p == '\\') {
+			g_string_append_c (str, '\\');
+			g_string_append_c (str, *p);
+		} else if ((guchar) *p < 0x20) {
+			g_string_append_printf (str, "\\u%04x", (guint) *p);
+		} else {
+			g_string_append_c (str, *p);
+		}
+	}
+	g_string_append_c (str, '"');
+}
+
+/* @fields is everything apart from the common pid, tid and ts members */
+static void
+gfu_trace_write (const gchar *ph, gint64 ts, const gchar *fields)
+{
+	g_autoptr(GString) str = g_string_new (NULL);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&gfu_trace_mutex);
+
+	if (gfu_trace_stream == NULL)
+		return;
+	g_string_append_printf (str,
+				"%s{\"ph\":\"%s\",\"pid\":%i,\"tid\":%i,\"ts\":%" G_GINT64_FORMAT ",%s}",
+				gfu_trace_first ? "[\n" : ",\n",
+				ph, (gint) getpid (), gfu_trace_get_tid (),
+				ts - gfu_trace_start_time, fields);
+	gfu_trace_first = FALSE;
+	if (!g_output_stream_write_all (gfu_trace_stream, str->str, str->len,
+					NULL, NULL, &error)) {
+		g_warning ("failed to write trace, stopping: %s", error->message);
+		gfu_trace_enabled = FALSE;
+		g_clear_object (&gfu_trace_stream);
+	}
+}
+
+/* @category and @name must be static strings */
+GfuTraceSpan *
+gfu_trace_span_begin_real (const gchar *category, const gchar *name)
+{
+	GfuTraceSpan *span = g_slice_new0 (GfuTraceSpan);
+	span->category = category;
+	span->name = name;
+	span->start = g_get_monotonic_time ();
+	return span;
+}
+
+void
+gfu_trace_span_add_arg (GfuTraceSpan *span, const gchar *key, const gchar *value)
+{
+	if (span == NULL || value == NULL)
+		return;
+	if (span->args == NULL)
+		span->args = g_string_new (NULL);
+	else
+		g_string_append_c (span->args, ',');
+	gfu_trace_append_escaped (span->args, key);
+	g_string_append_c (span->args, ':');
+	gfu_trace_append_escaped (span->args, value);
+}
+
+void
+gfu_trace_span_end (GfuTraceSpan *span)
+{
+	g_autoptr(GString) fields = g_string_new (NULL);
+
+	if (span == NULL)
+		return;
+	g_string_append_printf (fields,
+				"\"cat\":\"%s\",\"name\":\"%s\",\"dur\":%" G_GINT64_FORMAT,
+				span->category, span->name,
+				g_get_monotonic_time () - span->start);
+	if (span->args != NULL) {
+		g_string_append_printf (fields, ",\"args\":{%s}", span->args->str);
+		g_string_free (span->args, TRUE);
+	}
+	gfu_trace_write ("X", span->start, fields->str);
+	g_slice_free (GfuTraceSpan, span);
+}
+
+/* @category and @name must be static strings */
+void
+gfu_trace_instant_real (const gchar *category, const gchar *name)
+{
+	g_autofree gchar *fields = NULL;
+	fields = g_strdup_printf ("\"cat\":\"%s\",\"name\":\"%s\",\"s\":\"t\"",
+				  category, name);
+	gfu_trace_write ("i", g_get_monotonic_time (), fields);
+}
+
+/* @name must be a static string */
+void
+gfu_trace_counter_real (const gchar *name, gint64 value)
+{
+	g_autofree gchar *fields = NULL;
+	fields = g_strdup_printf ("\"name\":\"%s\",\"args\":{\"value\":%" G_GINT64_FORMAT "}",
+				  name, value);
+	gfu_trace_write ("C", g_get_monotonic_time (), fields);
+}
+
+/* all events from now on are written to @filename, replacing it */
+gboolean
+gfu_trace_start (const gchar *filename, GError **error)
+{
+	g_autoptr(GFile) file = g_file_new_for_path (filename);
+	g_autoptr(GFileOutputStream) stream = NULL;
+
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return FALSE;
+
+	g_mutex_lock (&gfu_trace_mutex);
+	g_clear_object (&gfu_trace_stream);
+	/* unbuffered, so that a crash does not lose the events leading up to it */
+	gfu_trace_stream = G_OUTPUT_STREAM (g_steal_pointer (&stream));
+	gfu_trace_start_time = g_get_monotonic_time ();
+	gfu_trace_first = TRUE;
+	gfu_trace_enabled = TRUE;
+	g_mutex_unlock (&gfu_trace_mutex);
+
+	/* the thread that started tracing is assumed to be the main thread */
+	gfu_trace_write ("M", gfu_trace_start_time,
+			 "\"name\":\"thread_name\",\"args\":{\"name\":\"main\"}");
+	return TRUE;
+}
+
+gboolean
+gfu_trace_stop (GError **error)
+{
+	g_autoptr(GOutputStream) stream = NULL;
+
+	g_mutex_lock (&gfu_trace_mutex);
+	gfu_trace_enabled = FALSE;
+	stream = g_steal_pointer (&gfu_trace_stream);
+	g_mutex_unlock (&gfu_trace_mutex);
+	if (stream == NULL)
+		return TRUE;
+	if (!g_output_stream_write_all (stream, "\n]\n", 3, NULL, NULL, error))
+		return FALSE;
+	return g_output_stream_close (stream, NULL, error);
+}
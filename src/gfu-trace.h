@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GfuTraceSpan GfuTraceSpan;
+
+/* read without locking, only ever changed by gfu_trace_start() and _stop() */
+extern gboolean gfu_trace_enabled;
+
+gboolean	 gfu_trace_start			(const gchar	*filename,
+							 GError		**error);
+gboolean	 gfu_trace_stop				(GError		**error);
+GfuTraceSpan	*gfu_trace_span_begin_real		(const gchar	*category,
+							 const gchar	*name);
+void		 gfu_trace_span_add_arg			(GfuTraceSpan	*span,
+							 const gchar	*key,
+							 const gchar	*value);
+void		 gfu_trace_span_end			(GfuTraceSpan	*span);
+void		 gfu_trace_instant_real			(const gchar	*category,
+							 const gchar	*name);
+void		 gfu_trace_counter_real			(const gchar	*name,
+							 gint64		 value);
+
+/* these only cost a branch when tracing is not enabled */
+#define gfu_trace_span_begin(category, name) \
+	(G_UNLIKELY (gfu_trace_enabled) ? gfu_trace_span_begin_real (category, name) : NULL)
+#define gfu_trace_instant(category, name) \
+	G_STMT_START { \
+		if (G_UNLIKELY (gfu_trace_enabled)) \
+			gfu_trace_instant_real (category, name); \
+	} G_STMT_END
+#define gfu_trace_counter(name, value) \
+	G_STMT_START { \
+		if (G_UNLIKELY (gfu_trace_enabled)) \
+			gfu_trace_counter_real (name, value); \
+	} G_STMT_END
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GfuTraceSpan, gfu_trace_span_end)
+
+G_END_DECLS
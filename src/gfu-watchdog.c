@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include "gfu-watchdog.h"
+
+/* each bucket is twice as long as the last, starting at the threshold */
+#define GFU_WATCHDOG_BUCKETS		6
+
+typedef struct {
+	const gchar		*name;		/* static */
+	gint64			 start;
+} GfuWatchdogScope;
+
+struct _GfuWatchdog {
+	GObject			 parent_instance;
+	GMutex			 mutex;		/* everything below */
+	GCond			 cond;
+	GThread			*thread;
+	GMainContext		*context;
+	gint64			 threshold;	/* µs */
+	gboolean		 running;
+	gboolean		 stalled;
+	gint64			 ping_sent;	/* 0 when answered */
+	gint64			 ping_next;
+	GSource			*ping_source;	/* NULL when answered */
+	GArray			*scopes;	/* of GfuWatchdogScope */
+	guint			 histogram[GFU_WATCHDOG_BUCKETS];
+	gint64			 stall_total;
+	gint64			 stall_max;
+};
+
+G_DEFINE_TYPE (GfuWatchdog, gfu_watchdog, G_TYPE_OBJECT)
+
+/* called with the mutex held */
+static gchar *
+gfu_watchdog_scopes_to_string (GfuWatchdog *self, gint64 now)
+{
+	GString *str;
+	GfuWatchdogScope *scope;
+
+	if (self->scopes->len == 0)
+		return g_strdup ("no known operation");
+	str = g_string_new (NULL);
+	for (guint i = 0; i < self->scopes->len; i++) {
+		scope = &g_array_index (self->scopes, GfuWatchdogScope, i);
+		if (str->len > 0)
+			g_string_append (str, " > ");
+		g_string_append (str, scope->name);
+	}
+	scope = &g_array_index (self->scopes, GfuWatchdogScope, self->scopes->len - 1);
+	g_string_append_printf (str, ", started %.0fms ago",
+				(now - scope->start) / 1000.f);
+	return g_string_free (str, FALSE);
+}
+
+/* runs in the main context, so only gets called once it is iterating again */
+static gboolean
+gfu_watchdog_pong_cb (gpointer user_data)
+{
+	GfuWatchdog *self = GFU_WATCHDOG (user_data);
+	gint64 now = g_get_monotonic_time ();
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+
+	if (self->stalled) {
+		gint64 duration = now - self->ping_sent;
+		guint idx = 0;
+		for (gint64 limit = self->threshold * 2;
+		     duration >= limit && idx < GFU_WATCHDOG_BUCKETS - 1;
+		     limit *= 2)
+			idx++;
+		self->histogram[idx]++;
+		self->stall_total += duration;
+		self->stall_max = MAX (self->stall_max, duration);
+		self->stalled = FALSE;
+		g_warning ("main loop was blocked for %.0fms", duration / 1000.f);
+	}
+	g_clear_pointer (&self->ping_source, g_source_unref);
+	self->ping_sent = 0;
+	self->ping_next = now + self->threshold;
+	g_cond_signal (&self->cond);
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer
+gfu_watchdog_thread_cb (gpointer user_data)
+{
+	GfuWatchdog *self = GFU_WATCHDOG (user_data);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+
+	while (self->running) {
+		gint64 now = g_get_monotonic_time ();
+
+		/* the last ping was answered, wait before sending another */
+		if (self->ping_sent == 0) {
+			GSource *source;
+			if (now < self->ping_next) {
+				g_cond_wait_until (&self->cond, &self->mutex, self->ping_next);
+				continue;
+			}
+			self->ping_sent = now;
+
+			/* never invoked inline, and attached without the lock as
+			 * the pong takes it; dispose joins before destroying it */
+			source = g_idle_source_new ();
+			g_source_set_priority (source, G_PRIORITY_HIGH);
+			g_source_set_callback (source, gfu_watchdog_pong_cb, self, NULL);
+			self->ping_source = g_source_ref (source);
+			g_mutex_unlock (&self->mutex);
+			g_source_attach (source, self->context);
+			g_source_unref (source);
+			g_mutex_lock (&self->mutex);
+			continue;
+		}
+
+		/* only logged once for each stall, the duration comes with the pong */
+		if (!self->stalled && now - self->ping_sent >= self->threshold) {
+			g_autofree gchar *scopes = gfu_watchdog_scopes_to_string (self, now);
+			self->stalled = TRUE;
+			g_warning ("main loop blocked for more than %.0fms in %s",
+				   self->threshold / 1000.f, scopes);
+		}
+		g_cond_wait_until (&self->cond, &self->mutex,
+				   self->stalled ? now + G_USEC_PER_SEC :
+						   self->ping_sent + self->threshold);
+	}
+	return NULL;
+}
+
+/* @name must be a static string, as it is read by the watchdog thread */
+void
+gfu_watchdog_push (GfuWatchdog *self, const gchar *name)
+{
+	GfuWatchdogScope scope = { name, g_get_monotonic_time () };
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+	g_return_if_fail (GFU_IS_WATCHDOG (self));
+	g_array_append_val (self->scopes, scope);
+}
+
+void
+gfu_watchdog_pop (GfuWatchdog *self)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+	g_return_if_fail (GFU_IS_WATCHDOG (self));
+	g_return_if_fail (self->scopes->len > 0);
+	g_array_set_size (self->scopes, self->scopes->len - 1);
+}
+
+/* a histogram of the stalls so far, suitable for the debug output */
+gchar *
+gfu_watchdog_to_string (GfuWatchdog *self)
+{
+	guint n_stalls = 0;
+	GString *str = g_string_new (NULL);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+
+	g_return_val_if_fail (GFU_IS_WATCHDOG (self), NULL);
+
+	for (guint i = 0; i < GFU_WATCHDOG_BUCKETS; i++)
+		n_stalls += self->histogram[i];
+	g_string_append_printf (str, "%u stalls, %.0fms in total, longest %.0fms",
+				n_stalls, self->stall_total / 1000.f,
+				self->stall_max / 1000.f);
+	for (guint i = 0; i < GFU_WATCHDOG_BUCKETS; i++) {
+		gint64 lower = self->threshold << i;
+		if (i == GFU_WATCHDOG_BUCKETS - 1) {
+			g_string_append_printf (str, "\n%6.0fms+        %u",
+						lower / 1000.f, self->histogram[i]);
+			continue;
+		}
+		g_string_append_printf (str, "\n%6.0fms-%-6.0fms %u",
+					lower / 1000.f, (lower * 2) / 1000.f,
+					self->histogram[i]);
+	}
+	return g_string_free (str, FALSE);
+}
+
+static void
+gfu_watchdog_dispose (GObject *object)
+{
+	GfuWatchdog *self = GFU_WATCHDOG (object);
+
+	/* no more pings once the thread has gone, and the last is not needed */
+	g_mutex_lock (&self->mutex);
+	self->running = FALSE;
+	g_cond_signal (&self->cond);
+	g_mutex_unlock (&self->mutex);
+	g_clear_pointer (&self->thread, g_thread_join);
+	if (self->ping_source != NULL) {
+		g_source_destroy (self->ping_source);
+		g_clear_pointer (&self->ping_source, g_source_unref);
+	}
+
+	G_OBJECT_CLASS (gfu_watchdog_parent_class)->dispose (object);
+}
+
+static void
+gfu_watchdog_finalize (GObject *object)
+{
+	GfuWatchdog *self = GFU_WATCHDOG (object);
+
+	if (self->context != NULL)
+		g_main_context_unref (self->context);
+	g_array_unref (self->scopes);
+	g_cond_clear (&self->cond);
+	g_mutex_clear (&self->mutex);
+
+	G_OBJECT_CLASS (gfu_watchdog_parent_class)->finalize (object);
+}
+
+static void
+gfu_watchdog_class_init (GfuWatchdogClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->dispose = gfu_watchdog_dispose;
+	object_class->finalize = gfu_watchdog_finalize;
+}
+
+static void
+gfu_watchdog_init (GfuWatchdog *self)
+{
+	g_mutex_init (&self->mutex);
+	g_cond_init (&self->cond);
+	self->scopes = g_array_new (FALSE, FALSE, sizeof(GfuWatchdogScope));
+}
+
+/* watches the thread-default main context, @threshold is in ms */
+GfuWatchdog *
+gfu_watchdog_new (guint threshold)
+{
+	GfuWatchdog *self;
+
+	g_return_val_if_fail (threshold > 0, NULL);
+
+	self = g_object_new (GFU_TYPE_WATCHDOG, NULL);
+	self->threshold = (gint64) threshold * 1000;
+	self->context = g_main_context_ref_thread_default ();
+	self->running = TRUE;
+	self->thread = g_thread_new ("gfu-watchdog", gfu_watchdog_thread_cb, self);
+	return GFU_WATCHDOG (self);
+}
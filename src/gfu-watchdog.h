@@ -0,0 +1,23 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GFU_TYPE_WATCHDOG (gfu_watchdog_get_type ())
+
+G_DECLARE_FINAL_TYPE (GfuWatchdog, gfu_watchdog, GFU, WATCHDOG, GObject)
+
+GfuWatchdog	*gfu_watchdog_new			(guint		 threshold);
+void		 gfu_watchdog_push			(GfuWatchdog	*self,
+							 const gchar	*name);
+void		 gfu_watchdog_pop			(GfuWatchdog	*self);
+gchar		*gfu_watchdog_to_string			(GfuWatchdog	*self);
+
+G_END_DECLS